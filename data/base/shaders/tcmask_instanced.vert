@@ -0,0 +1,67 @@
+// Version directive is set by Warzone when loading the shader
+// (This shader supports GLSL 1.20 - 1.50 core.)
+
+// Same as tcmask.vert, but the model view matrix, normal matrix and team colour come from each instance.
+
+//#pragma debug(on)
+
+uniform float stretch;
+uniform mat4 ProjectionMatrix;
+
+uniform vec4 lightPosition;
+
+#if (!defined(GL_ES) && (__VERSION__ >= 130)) || (defined(GL_ES) && (__VERSION__ >= 300))
+in vec4 vertex;
+in vec3 vertexNormal;
+in vec2 vertexTexCoord;
+in mat4 instanceModelViewMatrix;
+in mat4 instanceNormalMatrix;
+in vec4 instanceTeamColour;
+#else
+attribute vec4 vertex;
+attribute vec3 vertexNormal;
+attribute vec2 vertexTexCoord;
+attribute mat4 instanceModelViewMatrix;
+attribute mat4 instanceNormalMatrix;
+attribute vec4 instanceTeamColour;
+#endif
+
+#if (!defined(GL_ES) && (__VERSION__ >= 130)) || (defined(GL_ES) && (__VERSION__ >= 300))
+out float vertexDistance;
+out vec3 normal, lightDir, eyeVec;
+out vec2 texCoord;
+out vec4 teamcolour;
+#else
+varying float vertexDistance;
+varying vec3 normal, lightDir, eyeVec;
+varying vec2 texCoord;
+varying vec4 teamcolour;
+#endif
+
+void main()
+{
+	vec3 vVertex = (instanceModelViewMatrix * vertex).xyz;
+	vec4 position = vertex;
+
+	// Pass texture coordinates and team colour to fragment shader
+	texCoord = vertexTexCoord;
+	teamcolour = instanceTeamColour;
+
+	// Lighting -- we pass these to the fragment shader
+	normal = (instanceNormalMatrix * vec4(vertexNormal, 0.0)).xyz;
+	lightDir = lightPosition.xyz - vVertex;
+	eyeVec = -vVertex;
+
+	// Implement building stretching to accommodate terrain
+	if (vertex.y <= 0.0) // use vertex here directly to help shader compiler optimization
+	{
+		position.y -= stretch;
+	}
+
+	// Translate every vertex according to the Model View and Projection Matrix
+	vec4 gposition = ProjectionMatrix * (instanceModelViewMatrix * position);
+	gl_Position = gposition;
+
+	// Remember vertex distance
+	vertexDistance = gposition.z;
+}
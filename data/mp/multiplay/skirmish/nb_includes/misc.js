@@ -4,6 +4,10 @@
  *
  */
 
+// we only read a few properties of the objects we enumerate,
+// so let the game compute them when read
+setLazyObjects(true);
+
 var baseLocation = startPositions[me];
 
 function distanceToBase(loc) {
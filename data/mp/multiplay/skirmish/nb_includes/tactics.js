@@ -414,7 +414,7 @@ _global.fallBack = function(droid, threat) {
 }
 
 _global.dangerLevel = function(loc) {
-	return enumRange(loc.x, loc.y, baseScale / 2, ENEMIES, false).length;
+	return countRange(loc.x, loc.y, baseScale / 2, ENEMIES, false);
 }
 
 _global.checkAttack = function() {
@@ -451,9 +451,9 @@ _global.pushVtols = function(object) {
 
 _global.inPanic = function() {
 	function uncached() {
-		var badGuys = enumRange(baseLocation.x, baseLocation.y, baseScale, ENEMIES).length;
-		var goodGuys = enumRange(baseLocation.x, baseLocation.y, baseScale, ALLIES).filter(function(object) {
-			return object.type === DROID && (object.droidType === DROID_WEAPON || object.droidType === DROID_CYBORG);
+		var badGuys = countRange(baseLocation.x, baseLocation.y, baseScale, ENEMIES);
+		var goodGuys = enumRange(baseLocation.x, baseLocation.y, baseScale, ALLIES, true, DROID).filter(function(object) {
+			return object.droidType === DROID_WEAPON || object.droidType === DROID_CYBORG;
 		}).length;
 		return 3 * badGuys > 2 * goodGuys;
 	}
@@ -536,7 +536,7 @@ function placeOilDrum()
 	var y = syncRandom(mapHeight - 20) + 10;
 
 	// see if the random position is valid
-	var occupied = (enumRange(x, y, 2, ALL_PLAYERS, false).length > 0);
+	var occupied = (countRange(x, y, 2, ALL_PLAYERS, false) > 0);
 	var unreachable = true;
 	for (var i = 0; i < maxPlayers; ++i)
 	{
@@ -0,0 +1,80 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2005-2017  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+/*!
+ * \file
+ * \brief Sorting by integer keys, in linear time.
+ */
+
+#ifndef RADIXSORT_H
+#define RADIXSORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+/// Stably sorts items in increasing order of key(item), which must be a uint64_t, using scratch as temporary storage.
+/// Sorts a byte at a time, skipping bytes which are the same in every key, so keys only cost as much as the bytes which differ.
+/// Works best on small items, such as a key with an index to sort the real items by.
+template<typename T, typename Key>
+void radixSort(std::vector<T> &items, std::vector<T> &scratch, Key const &key)
+{
+	if (items.size() < 2)
+	{
+		return;  // Already sorted.
+	}
+
+	uint64_t allOr = 0, allAnd = ~(uint64_t)0;
+	for (T const &item : items)
+	{
+		uint64_t k = key(item);
+		allOr |= k;
+		allAnd &= k;
+	}
+	uint64_t differ = allOr ^ allAnd;
+
+	scratch.resize(items.size());
+	for (unsigned shift = 0; shift < 64; shift += 8)
+	{
+		if ((differ >> shift & 0xFF) == 0)
+		{
+			continue;  // Every item would end up where it already is.
+		}
+
+		size_t offsets[256] = {0};
+		for (T const &item : items)
+		{
+			++offsets[key(item) >> shift & 0xFF];
+		}
+		size_t offset = 0;
+		for (size_t &count : offsets)
+		{
+			size_t n = count;
+			count = offset;
+			offset += n;
+		}
+		for (T &item : items)
+		{
+			scratch[offsets[key(item) >> shift & 0xFF]++] = std::move(item);
+		}
+		items.swap(scratch);
+	}
+}
+
+#endif // RADIXSORT_H
@@ -0,0 +1,165 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2005-2017  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+/** @file wzthreadpool.cpp
+ *  The shared pool of worker threads.
+ */
+
+#include "frame.h"
+#include "math_ext.h"
+#include "wzapp.h"
+#include "wzthreadpool.h"
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#define MAX_POOL_THREADS 16
+
+static std::vector<WZ_THREAD *> poolThreads;
+static WZ_MUTEX *poolMutex = nullptr;
+static WZ_SEMAPHORE *poolSemaphore = nullptr;      ///< Posted once for each job queued, and once for each thread when quitting.
+static std::deque<std::function<void ()>> poolJobs;  ///< Protected by poolMutex.
+static std::atomic<bool> poolQuit(false);
+
+/** This runs in a separate thread, one for each worker in the pool */
+static int poolThreadFunc(void *)
+{
+	while (true)
+	{
+		wzSemaphoreWait(poolSemaphore);  // Go to sleep until needed.
+		wzMutexLock(poolMutex);
+		if (poolJobs.empty())
+		{
+			wzMutexUnlock(poolMutex);
+			if (poolQuit)
+			{
+				break;
+			}
+			continue;
+		}
+		std::function<void ()> job = std::move(poolJobs.front());
+		poolJobs.pop_front();
+		wzMutexUnlock(poolMutex);
+		job();  // Do the actual work
+	}
+	return 0;
+}
+
+unsigned wzThreadPoolSize()
+{
+	if (poolThreads.empty())
+	{
+		poolQuit = false;
+		poolMutex = wzMutexCreate();
+		poolSemaphore = wzSemaphoreCreate(0);
+		// The main thread does its share of the parallel work too, so leave it a core.
+		int numThreads = clip(wzGetCPUCount() - 1, 1, MAX_POOL_THREADS);
+		for (int i = 0; i < numThreads; ++i)
+		{
+			WZ_THREAD *thread = wzThreadCreate(poolThreadFunc, nullptr);
+			wzThreadStart(thread);
+			poolThreads.push_back(thread);
+		}
+		debug(LOG_INFO, "Started %d worker threads", numThreads);
+	}
+	return poolThreads.size();
+}
+
+void wzThreadPoolRun(std::function<void ()> job)
+{
+	wzThreadPoolSize();  // Make sure the threads are running.
+	wzMutexLock(poolMutex);
+	poolJobs.push_back(std::move(job));
+	wzMutexUnlock(poolMutex);
+	wzSemaphorePost(poolSemaphore);  // Wake up a thread.
+}
+
+namespace
+{
+struct ParallelFor
+{
+	ParallelFor(unsigned count, std::function<void (unsigned, unsigned)> const &job) : count(count), job(&job), allDone(wzSemaphoreCreate(0)) {}
+	~ParallelFor()
+	{
+		wzSemaphoreDestroy(allDone);
+	}
+
+	/// Calls job for indices nobody has taken yet, until there are none left. Whoever finishes the last one posts allDone.
+	void work(unsigned worker)
+	{
+		unsigned finished = 0;
+		for (unsigned index; (index = next.fetch_add(1)) < count; ++finished)
+		{
+			(*job)(index, worker);
+		}
+		if (finished != 0 && done.fetch_add(finished) + finished == count)
+		{
+			wzSemaphorePost(allDone);
+		}
+	}
+
+	std::atomic<unsigned> next{0};
+	std::atomic<unsigned> done{0};
+	unsigned count;
+	std::function<void (unsigned, unsigned)> const *job;  ///< Only used while indices are left, so never after wzParallelFor returns.
+	WZ_SEMAPHORE *allDone;
+};
+}
+
+void wzParallelFor(unsigned count, std::function<void (unsigned index, unsigned worker)> const &job)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	// Workers which only get to run once the others are done find nothing left, and just drop their reference.
+	auto state = std::make_shared<ParallelFor>(count, job);
+	unsigned numHelpers = std::min(wzThreadPoolSize(), count - 1);
+	for (unsigned worker = 1; worker <= numHelpers; ++worker)
+	{
+		wzThreadPoolRun([state, worker]() { state->work(worker); });
+	}
+	state->work(0);
+	wzSemaphoreWait(state->allDone);
+}
+
+void wzThreadPoolShutdown()
+{
+	if (poolThreads.empty())
+	{
+		return;
+	}
+	poolQuit = true;
+	for (size_t i = 0; i < poolThreads.size(); ++i)
+	{
+		wzSemaphorePost(poolSemaphore);  // Wake up threads.
+	}
+	for (WZ_THREAD *thread : poolThreads)
+	{
+		wzThreadJoin(thread);
+	}
+	poolThreads.clear();
+	wzMutexDestroy(poolMutex);
+	poolMutex = nullptr;
+	wzSemaphoreDestroy(poolSemaphore);
+	poolSemaphore = nullptr;
+}
@@ -0,0 +1,42 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2005-2017  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+/*!
+ * \file
+ * \brief One pool of worker threads, shared by everything which does work in the background or in parallel.
+ */
+
+#ifndef WZTHREADPOOL_H
+#define WZTHREADPOOL_H
+
+#include <functional>
+
+/// Number of worker threads, which leaves a core for the main thread, but is at least 1. Starts them, if not started yet.
+unsigned wzThreadPoolSize();
+
+/// Queues job to run on one of the worker threads. Jobs may run in any order, and at the same time as each other.
+void wzThreadPoolRun(std::function<void ()> job);
+
+/// Calls job(index, worker) for each index < count, spread over the worker threads and the calling thread, and returns once all calls have returned.
+/// worker is 0 on the calling thread, and up to wzThreadPoolSize() on the worker threads, so that it can pick per-thread scratch space.
+void wzParallelFor(unsigned count, std::function<void (unsigned index, unsigned worker)> const &job);
+
+/// Runs the jobs still queued, and stops the worker threads. Only call from the main thread, once nothing else can queue jobs.
+void wzThreadPoolShutdown();
+
+#endif // WZTHREADPOOL_H
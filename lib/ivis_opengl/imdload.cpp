@@ -33,6 +33,7 @@
 #include "lib/framework/fixedpoint.h"
 #include "lib/framework/file.h"
 #include "lib/framework/physfs_ext.h"
+#include "lib/ivis_opengl/piedef.h"
 #include "lib/ivis_opengl/piematrix.h"
 #include "lib/ivis_opengl/piestate.h"
 
@@ -56,6 +57,7 @@ iIMDShape::~iIMDShape()
 
 void modelShutdown()
 {
+	pie_ClearShadowCache();
 	models.clear();
 }
 
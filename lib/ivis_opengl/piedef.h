@@ -59,11 +59,16 @@ struct iIMDShape;
 /***************************************************************************/
 bool pie_Draw3DShape(iIMDShape *shape, int frame, int team, PIELIGHT colour, int pieFlag, int pieFlagData, const glm::mat4 &modelView);
 
-void pie_GetResetCounts(unsigned int *pPieCount, unsigned int *pPolyCount);
+/// Gets the counts since last time, and starts counting again. Draw calls saved are how many more there would have been without instancing.
+void pie_GetResetCounts(unsigned int *pPieCount, unsigned int *pPolyCount, unsigned int *pDrawCallCount, unsigned int *pDrawCallsSaved);
 
 /** Setup stencil shadows and OpenGL lighting. */
 void pie_BeginLighting(const Vector3f &light);
 void pie_setShadows(bool drawShadows);
+/** Forget the cached shadow silhouettes, must be called before freeing any shapes. */
+void pie_ClearShadowCache();
+/** Draw identical opaque shapes with one instanced draw call, if the driver supports it. Returns whether instancing is now on. */
+bool pie_setInstancing(bool enable);
 
 /** Set light parameters */
 void pie_InitLighting();
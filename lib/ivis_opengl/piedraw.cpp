@@ -26,6 +26,8 @@
 
 #include "lib/framework/frame.h"
 #include "lib/framework/opengl.h"
+#include "lib/framework/radixsort.h"
+#include "lib/framework/wzthreadpool.h"
 #include "lib/ivis_opengl/ivisdef.h"
 #include "lib/ivis_opengl/imd.h"
 #include "lib/ivis_opengl/piefunc.h"
@@ -63,10 +65,18 @@ static GLenum ss_op_depth_pass_back = GL_DECR;
 
 static unsigned int pieCount = 0;
 static unsigned int polyCount = 0;
+static unsigned int drawCallCount = 0;
+static unsigned int drawCallsSaved = 0;
 static bool shadows = false;
+static bool instancingSupported = false;
+static bool instancing = false;
+static GLuint instanceBuffer = 0;
 static GLfloat lighting0[LIGHT_MAX][4];
 
 static std::vector<GLint> enabledAttribArrays;
+static std::vector<GLint> instancedAttribArrays;
+static const iIMDShape *enabledArraysShape = nullptr;  // If the enabled arrays are a shape's, for drawing it again.
+static const pie_internal::SHADER_PROGRAM *enabledArraysProgram = nullptr;
 
 
 void enableArray(GLint buffer, GLint loc, GLint size, GLenum type, GLboolean normalised, GLsizei stride, std::size_t offset)
@@ -82,14 +92,46 @@ void enableArray(GLint buffer, GLint loc, GLint size, GLenum type, GLboolean nor
 	enabledAttribArrays.push_back(loc);
 }
 
+static void pie_VertexAttribDivisor(GLuint index, GLuint divisor)
+{
+	if (GLEW_VERSION_3_3)
+	{
+		glVertexAttribDivisor(index, divisor);
+	}
+	else
+	{
+		glVertexAttribDivisorARB(index, divisor);
+	}
+}
+
+/// Like enableArray, but the attribute advances once per instance instead of once per vertex.
+static void enableInstancedArray(GLint buffer, GLint loc, GLint size, GLsizei stride, std::size_t offset)
+{
+	if (loc == -1)
+	{
+		return;
+	}
+
+	enableArray(buffer, loc, size, GL_FLOAT, false, stride, offset);
+	pie_VertexAttribDivisor(loc, 1);
+	instancedAttribArrays.push_back(loc);
+}
+
 void disableArrays()
 {
 	for (GLint loc : enabledAttribArrays)
 	{
 		glDisableVertexAttribArray(loc);
 	}
+	for (GLint loc : instancedAttribArrays)
+	{
+		pie_VertexAttribDivisor(loc, 0);  // Other programs might use the same location for something per vertex.
+	}
 
 	enabledAttribArrays.clear();
+	instancedAttribArrays.clear();
+	enabledArraysShape = nullptr;
+	enabledArraysProgram = nullptr;
 }
 
 /*
@@ -170,6 +212,7 @@ static void pie_Draw3DButton(iIMDShape *shape, PIELIGHT teamcolour, const glm::m
 	glDrawElements(GL_TRIANGLES, shape->polys.size() * 3, GL_UNSIGNED_SHORT, nullptr);
 	disableArrays();
 	polyCount += shape->polys.size();
+	drawCallCount++;
 	pie_DeactivateShader();
 	pie_SetDepthBufferStatus(DEPTH_CMP_ALWAYS_WRT_ON);
 }
@@ -234,14 +277,21 @@ static void pie_Draw3DShape2(const iIMDShape *shape, int frame, PIELIGHT colour,
 
 	frame %= std::max<int>(1, shape->numFrames);
 
-	enableArray(shape->buffers[VBO_VERTEX], program.locVertex, 3, GL_FLOAT, false, 0, 0);
-	enableArray(shape->buffers[VBO_NORMAL], program.locNormal, 3, GL_FLOAT, false, 0, 0);
-	enableArray(shape->buffers[VBO_TEXCOORD], program.locTexCoord, 2, GL_FLOAT, false, 0, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, shape->buffers[VBO_INDEX]);
+	// Leave the arrays enabled afterwards, in case the next shape drawn is the same, and use the ones already enabled if this shape is.
+	if (shape != enabledArraysShape || &program != enabledArraysProgram)
+	{
+		disableArrays();
+		enableArray(shape->buffers[VBO_VERTEX], program.locVertex, 3, GL_FLOAT, false, 0, 0);
+		enableArray(shape->buffers[VBO_NORMAL], program.locNormal, 3, GL_FLOAT, false, 0, 0);
+		enableArray(shape->buffers[VBO_TEXCOORD], program.locTexCoord, 2, GL_FLOAT, false, 0, 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, shape->buffers[VBO_INDEX]);
+		enabledArraysShape = shape;
+		enabledArraysProgram = &program;
+	}
 	glDrawElements(GL_TRIANGLES, shape->polys.size() * 3, GL_UNSIGNED_SHORT, BUFFER_OFFSET(frame * shape->polys.size() * 3 * sizeof(uint16_t)));
-	disableArrays();
 
 	polyCount += shape->polys.size();
+	drawCallCount++;
 
 	pie_SetShaderEcmEffect(false);
 	// NOTE: Do *not* call pie_DeactivateShader() here, to avoid unecessary state transitions.
@@ -249,6 +299,77 @@ static void pie_Draw3DShape2(const iIMDShape *shape, int frame, PIELIGHT colour,
 	// (activateShader handles changing the active shader *if necessary*.)
 }
 
+struct InstanceData
+{
+	glm::mat4	modelView;
+	glm::mat4	normalMatrix;
+	glm::vec4	teamColour;
+};
+
+/// Draws an opaque, lit shape once for each of the matrices and team colours, with one draw call. Everything else must be the same for each instance.
+static void pie_Draw3DShapeInstanced(const iIMDShape *shape, int frame, PIELIGHT colour, int pieFlag, std::vector<InstanceData> const &instances)
+{
+	pie_SetFogStatus(true);
+	pie_SetRendMode(REND_OPAQUE);
+
+	glm::vec4 sceneColor(lighting0[LIGHT_EMISSIVE][0], lighting0[LIGHT_EMISSIVE][1], lighting0[LIGHT_EMISSIVE][2], lighting0[LIGHT_EMISSIVE][3]);
+	glm::vec4 ambient(lighting0[LIGHT_AMBIENT][0], lighting0[LIGHT_AMBIENT][1], lighting0[LIGHT_AMBIENT][2], lighting0[LIGHT_AMBIENT][3]);
+	glm::vec4 diffuse(lighting0[LIGHT_DIFFUSE][0], lighting0[LIGHT_DIFFUSE][1], lighting0[LIGHT_DIFFUSE][2], lighting0[LIGHT_DIFFUSE][3]);
+	glm::vec4 specular(lighting0[LIGHT_SPECULAR][0], lighting0[LIGHT_SPECULAR][1], lighting0[LIGHT_SPECULAR][2], lighting0[LIGHT_SPECULAR][3]);
+
+	// The model view matrix is per instance, so an identity model view matrix makes the projection matrix get set.
+	pie_internal::SHADER_PROGRAM &program = pie_ActivateShaderDeprecated(SHADER_COMPONENT_INSTANCED, shape, WZCOL_WHITE, colour, glm::mat4(1.f), pie_PerspectiveGet(),
+		glm::vec4(currentSunPosition, 0.f), sceneColor, ambient, diffuse, specular);
+
+	if (program.locations.size() >= 9)
+		glUniform1i(program.locations[8], (pieFlag & pie_PREMULTIPLIED) == 0);
+
+	pie_SetTexturePage(shape->texpage);
+
+	frame %= std::max<int>(1, shape->numFrames);
+
+	if (instanceBuffer == 0)
+	{
+		glGenBuffers(1, &instanceBuffer);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(InstanceData) * instances.size(), instances.data(), GL_STREAM_DRAW);
+
+	disableArrays();
+	enableArray(shape->buffers[VBO_VERTEX], program.locVertex, 3, GL_FLOAT, false, 0, 0);
+	enableArray(shape->buffers[VBO_NORMAL], program.locNormal, 3, GL_FLOAT, false, 0, 0);
+	enableArray(shape->buffers[VBO_TEXCOORD], program.locTexCoord, 2, GL_FLOAT, false, 0, 0);
+	for (int column = 0; column < 4; ++column)
+	{
+		enableInstancedArray(instanceBuffer, program.locInstanceModelView + column, 4, sizeof(InstanceData), offsetof(InstanceData, modelView) + column * sizeof(glm::vec4));
+		enableInstancedArray(instanceBuffer, program.locInstanceNormalMatrix + column, 4, sizeof(InstanceData), offsetof(InstanceData, normalMatrix) + column * sizeof(glm::vec4));
+	}
+	enableInstancedArray(instanceBuffer, program.locInstanceTeamColour, 4, sizeof(InstanceData), offsetof(InstanceData, teamColour));
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, shape->buffers[VBO_INDEX]);
+
+	const GLvoid *indices = BUFFER_OFFSET(frame * shape->polys.size() * 3 * sizeof(uint16_t));
+	if (GLEW_VERSION_3_1)
+	{
+		glDrawElementsInstanced(GL_TRIANGLES, shape->polys.size() * 3, GL_UNSIGNED_SHORT, indices, (GLsizei)instances.size());
+	}
+	else
+	{
+		glDrawElementsInstancedARB(GL_TRIANGLES, shape->polys.size() * 3, GL_UNSIGNED_SHORT, indices, (GLsizei)instances.size());
+	}
+	disableArrays();
+
+	polyCount += shape->polys.size() * instances.size();
+	drawCallCount++;
+	drawCallsSaved += instances.size() - 1;
+}
+
+/// Whether two queued opaque shapes can be drawn by the same instanced draw call.
+static bool pie_CanInstance(SHAPE const &a, SHAPE const &b)
+{
+	return a.shape == b.shape && a.frame == b.frame && a.flag == b.flag && a.colour.rgba == b.colour.rgba && a.stretch == b.stretch &&
+	       a.shape->shaderProgram == SHADER_NONE && !(a.flag & pie_ECM);
+}
+
 static inline bool edgeLessThan(EDGE const &e1, EDGE const &e2)
 {
 	if (e1.from != e2.from)
@@ -337,254 +458,304 @@ inline void hash_combine(std::size_t& seed, const T& v, Rest... rest) {
 	hash_combine(seed, rest...);
 }
 
-std::size_t hash_vec4(const glm::vec4& vec)
-{
-	std::size_t h=0;
-	hash_combine(h, vec[0], vec[1], vec[2], vec[3]);
-	return h;
-}
+// Light directions are rounded to this many steps per unit, so casters lit from nearly the same direction share a silhouette
+#define SHADOW_LIGHT_STEPS 64
+// silhouettes of casters no longer being drawn are forgotten, oldest first, once the cache uses more memory than this
+#define SHADOW_CACHE_MAX_BYTES (8 * 1024 * 1024)
+// number of silhouettes or shadow casters a worker thread handles at a time
+#define SHADOW_ITEMS_PER_JOB 16
 
-struct ShadowDrawParameters {
+/// What the silhouette of a shadow caster depends on.
+struct ShadowEdgeKey
+{
+	iIMDShape *shape;
 	int flag;
 	int flag_data;
-	//		glm::mat4 modelViewMatrix; // the modelViewMatrix doesn't change any of the vertex / buffer calculations
-	glm::vec4 light;
+	int8_t light[3];  ///< Light direction relative to the shape, normalised and rounded to SHADOW_LIGHT_STEPS.
 
-	ShadowDrawParameters(int flag, int flag_data, const glm::vec4 &light)
-	: flag(flag)
-	, flag_data(flag_data)
-	, light(light)
-	{ }
-
-	bool operator ==(const ShadowDrawParameters &b) const
+	bool operator ==(const ShadowEdgeKey &b) const
 	{
-		return (flag == b.flag) && (flag_data == b.flag_data) && (light == b.light);
+		return shape == b.shape && flag == b.flag && flag_data == b.flag_data && light[0] == b.light[0] && light[1] == b.light[1] && light[2] == b.light[2];
 	}
 };
 
 namespace std {
 	template <>
-	struct hash<ShadowDrawParameters>
+	struct hash<ShadowEdgeKey>
 	{
-		std::size_t operator()(const ShadowDrawParameters& k) const
+		std::size_t operator()(const ShadowEdgeKey& k) const
 		{
 			std::size_t h = 0;
-			hash_combine(h, k.flag, k.flag_data, hash_vec4(k.light));
+			hash_combine(h, k.shape, k.flag, k.flag_data, (uint8_t)k.light[0] | (uint8_t)k.light[1] << 8 | (uint8_t)k.light[2] << 16);
 			return h;
 		}
 	};
 }
 
-struct ShadowCache {
-
-	struct CachedShadowData {
-		uint64_t lastQueriedFrameCount = 0;
-		std::vector<Vector3f> vertexes;
-
-		CachedShadowData() { }
+/// Silhouette edges of shadow casters, kept across frames until the cache is over SHADOW_CACHE_MAX_BYTES.
+/// Only the silhouette depends on the rounded light direction, the shadow volume is still extruded along the exact light.
+class ShadowEdgeCache
+{
+public:
+	struct Entry
+	{
+		std::vector<EDGE> edges;
+		uint64_t lastUsedFrame = 0;
 	};
 
-	typedef std::unordered_map<ShadowDrawParameters, CachedShadowData> ShadowDrawParametersToCachedDataMap;
-	typedef std::unordered_map<iIMDShape *, ShadowDrawParametersToCachedDataMap, std::hash<iIMDShape *>> ShapeMap;
+	/// Returns the entry for key, marked as used this frame. If isNew is set, the caller must find its edges, then call added().
+	Entry &find(const ShadowEdgeKey &key, bool &isNew)
+	{
+		auto result = entries.emplace(key, Entry());
+		result.first->second.lastUsedFrame = currentFrame;
+		isNew = result.second;
+		return result.first->second;
+	}
 
-	const CachedShadowData* findCacheForShadowDraw(iIMDShape *shape, int flag, int flag_data, const glm::vec4 &light)
+	void added(const Entry &entry)
 	{
-		auto it = shapeMap.find(shape);
-		if (it == shapeMap.end()) {
-			return nullptr;
-		}
-		auto it_cachedData = it->second.find(ShadowDrawParameters(flag, flag_data, light));
-		if (it_cachedData == it->second.end()) {
-			return nullptr;
-		}
-		// update the frame in which we requested this shadow cache
-		it_cachedData->second.lastQueriedFrameCount = _currentFrame;
-		return &(it_cachedData->second);
+		bytes += entryBytes(entry);
 	}
 
-	CachedShadowData& createCacheForShadowDraw(iIMDShape *shape, int flag, int flag_data, const glm::vec4 &light)
+	void setCurrentFrame(uint64_t frame)
 	{
-		auto result = shapeMap[shape].emplace(ShadowDrawParameters(flag, flag_data, light), CachedShadowData());
-		result.first->second.lastQueriedFrameCount = _currentFrame;
-		return result.first->second;
+		currentFrame = frame;
 	}
 
-	void addPremultipliedVertexes(const CachedShadowData& cachedData, const glm::mat4 &modelViewMatrix)
+	/// Forgets the least recently used silhouettes until the cache fits in SHADOW_CACHE_MAX_BYTES, but never ones used this frame.
+	void trim()
 	{
-		for (auto &vertex : cachedData.vertexes)
+		if (bytes <= SHADOW_CACHE_MAX_BYTES)
+		{
+			return;
+		}
+		std::vector<Map::iterator> unused;
+		for (auto it = entries.begin(); it != entries.end(); ++it)
+		{
+			if (it->second.lastUsedFrame != currentFrame)
+			{
+				unused.push_back(it);
+			}
+		}
+		std::sort(unused.begin(), unused.end(), [](Map::iterator const &a, Map::iterator const &b) { return a->second.lastUsedFrame < b->second.lastUsedFrame; });
+		for (auto it = unused.begin(); it != unused.end() && bytes > SHADOW_CACHE_MAX_BYTES; ++it)
 		{
-			vertexes.emplace_back(modelViewMatrix * glm::vec4(vertex, 1.0));
+			bytes -= entryBytes((*it)->second);
+			entries.erase(*it);
 		}
 	}
 
-	const std::vector<Vector3f>& getPremultipliedVertexes()
+	/// Forgets everything, for when shapes are freed, since their addresses may be reused.
+	void clear()
 	{
-		return vertexes;
+		entries.clear();
+		bytes = 0;
 	}
 
-	void clearPremultipliedVertexes()
-	{
-		vertexes.clear();
-	}
+private:
+	typedef std::unordered_map<ShadowEdgeKey, Entry> Map;
 
-	void setCurrentFrame(uint64_t currentFrame)
+	static size_t entryBytes(const Entry &entry)
 	{
-		_currentFrame = currentFrame;
+		return sizeof(Map::value_type) + entry.edges.capacity() * sizeof(EDGE);
 	}
 
-	size_t removeUnused()
+	uint64_t currentFrame = 0;
+	size_t bytes = 0;
+	Map entries;
+};
+
+/// A silhouette not in the cache, to be found by the worker threads.
+struct ShadowEdgeMiss
+{
+	ShadowEdgeCache::Entry *entry;
+	iIMDShape *shape;
+	int flag;
+	int flag_data;
+	glm::vec3 light;
+};
+
+/// Where the shadow volume of the shadow caster with the same index in scshapes comes from, and goes.
+struct ShadowVolume
+{
+	const ShadowEdgeCache::Entry *entry;  ///< nullptr if using the shape's static shadow edges.
+	const EDGE *edges;
+	unsigned edgeCount;
+	size_t firstVertex;
+};
+
+static ShadowEdgeCache shadowEdgeCache;
+static std::vector<ShadowEdgeMiss> shadowMisses;
+static std::vector<ShadowVolume> shadowVolumes;
+static std::vector<Vector3f> shadowVertexes;  ///< Shadow volumes of this frame, already multiplied by the modelView matrix of their caster.
+
+
+/// Finds the edges between polygons facing the light and polygons facing away from it.
+static void pie_FindSilhouette(std::vector<EDGE> &silhouette, std::vector<EDGE> &edgelist, std::vector<EDGE> &edgelistFlipped, const iIMDShape *shape, int flag, int flag_data, const glm::vec3 &light)
+{
+	const Vector3f *pVertices = shape->points.data();
+	edgelist.clear();
+	glm::vec3 p[3];
+	for (const iIMDPoly &poly : shape->polys)
 	{
-		std::vector<ShapeMap::iterator> unusedShapes;
-		size_t oldItemsRemoved = 0;
-		for (auto it_shape = shapeMap.begin(); it_shape != shapeMap.end(); ++it_shape)
+		for (int j = 0; j < 3; ++j)
 		{
-			std::vector<ShadowDrawParametersToCachedDataMap::iterator> unusedBuffersForShape;
-			for (auto it_shadowDrawParams = it_shape->second.begin(); it_shadowDrawParams != it_shape->second.end(); ++it_shadowDrawParams)
-			{
-				if (it_shadowDrawParams->second.lastQueriedFrameCount != _currentFrame)
-				{
-					unusedBuffersForShape.push_back(it_shadowDrawParams);
-				}
-			}
-			for (auto &item : unusedBuffersForShape)
-			{
-				it_shape->second.erase(item);
-				++oldItemsRemoved;
-			}
-			if (it_shape->second.empty())
+			int current = poly.pindex[j];
+			p[j] = glm::vec3(pVertices[current].x, scale_y(pVertices[current].y, flag, flag_data), pVertices[current].z);
+		}
+		if (glm::dot(glm::cross(p[2] - p[0], p[1] - p[0]), light) > 0.0f)
+		{
+			for (int n = 0; n < 3; ++n)
 			{
-				// remove from the root shapeMap
-				unusedShapes.push_back(it_shape);
+				// Add the edges
+				edgelist.push_back({poly.pindex[n], poly.pindex[(n + 1)%3]});
 			}
 		}
-		for (auto &item : unusedShapes)
+	}
+
+	// Remove duplicate pairs from the edge list. For example, in the list ((1 2), (2 6), (6 2), (3, 4)), remove (2 6) and (6 2).
+	edgelistFlipped = edgelist;
+	std::for_each(edgelistFlipped.begin(), edgelistFlipped.end(), flipEdge);
+	std::sort(edgelist.begin(), edgelist.end(), edgeLessThan);
+	std::sort(edgelistFlipped.begin(), edgelistFlipped.end(), edgeLessThan);
+	silhouette.resize(edgelist.size());
+	silhouette.erase(std::set_difference(edgelist.begin(), edgelist.end(), edgelistFlipped.begin(), edgelistFlipped.end(), silhouette.begin(), edgeLessThan), silhouette.end());
+	silhouette.shrink_to_fit();
+}
+
+static void pie_FindMissingSilhouettes(unsigned begin, unsigned end)
+{
+	std::vector<EDGE> edgelist, edgelistFlipped;
+	for (unsigned i = begin; i < end; ++i)
+	{
+		ShadowEdgeMiss const &miss = shadowMisses[i];
+		pie_FindSilhouette(miss.entry->edges, edgelist, edgelistFlipped, miss.shape, miss.flag, miss.flag_data, miss.light);
+	}
+}
+
+/// Makes a quad from each silhouette edge to the edge moved along the light, in view coordinates.
+static void pie_ExtrudeShadowVolumes(unsigned begin, unsigned end)
+{
+	for (unsigned i = begin; i < end; ++i)
+	{
+		ShadowcastingShape const &caster = scshapes[i];
+		ShadowVolume const &volume = shadowVolumes[i];
+		const Vector3f *pVertices = caster.shape->points.data();
+		const glm::vec3 light(caster.matrix * glm::vec4(glm::vec3(caster.light), 0.f));
+		Vector3f *vertex = &shadowVertexes[volume.firstVertex];
+		for (unsigned n = 0; n < volume.edgeCount; ++n)
 		{
-			shapeMap.erase(item);
+			const Vector3f &a = pVertices[volume.edges[n].from];
+			const Vector3f &b = pVertices[volume.edges[n].to];
+			const glm::vec3 v1(caster.matrix * glm::vec4(b.x, scale_y(b.y, caster.flag, caster.flag_data), b.z, 1.f));
+			const glm::vec3 v4(caster.matrix * glm::vec4(a.x, scale_y(a.y, caster.flag, caster.flag_data), a.z, 1.f));
+			const glm::vec3 v3 = v4 + light;
+
+			*vertex++ = v1;
+			*vertex++ = v1 + light; //v2
+			*vertex++ = v3;
+
+			*vertex++ = v3;
+			*vertex++ = v4;
+			*vertex++ = v1;
 		}
-		return oldItemsRemoved;
 	}
-private:
-	uint64_t _currentFrame = 0;
-	ShapeMap shapeMap;
-	std::vector<Vector3f> vertexes;
-};
+}
 
-enum DrawShadowResult {
-	DRAW_SUCCESS_CACHED,
-	DRAW_SUCCESS_UNCACHED
-};
+/// Calls job for items [0, count), spread over the worker threads and this one. Returns once all items are done.
+static void pie_RunShadowJobs(unsigned count, void (*job)(unsigned begin, unsigned end))
+{
+	unsigned numJobs = (count + SHADOW_ITEMS_PER_JOB - 1) / SHADOW_ITEMS_PER_JOB;
+	wzParallelFor(numJobs, [count, job](unsigned index, unsigned) {
+		unsigned begin = index * SHADOW_ITEMS_PER_JOB;
+		job(begin, std::min<unsigned>(begin + SHADOW_ITEMS_PER_JOB, count));
+	});
+}
 
-/// Draw the shadow for a shape
-/// Prequisite:
-///		Caller must call the following before all calls to pie_DrawShadow():
-///			const auto &program = pie_ActivateShader(SHADER_GENERIC_COLOR, pie_PerspectiveGet(), glm::vec4());
-///			glEnableVertexAttribArray(program.locVertex);
-///		and must call the following after all calls to pie_DrawShadow():
-///			glDisableVertexAttribArray(program.locVertex);
-///			pie_DeactivateShader();
-///		The only place this is currently called is pie_ShadowDrawLoop(), which handles this properly.
-static inline DrawShadowResult pie_DrawShadow(ShadowCache &shadowCache, iIMDShape *shape, int flag, int flag_data, const glm::vec4 &light, const glm::mat4 &modelViewMatrix)
-{
-	static std::vector<EDGE> edgelist;  // Static, to save allocations.
-	static std::vector<EDGE> edgelistFlipped;  // Static, to save allocations.
-	static std::vector<EDGE> edgelistFiltered;  // Static, to save allocations.
-	EDGE *drawlist = nullptr;
-
-	unsigned edge_count;
-	DrawShadowResult result;
-
-	// Find cached data (if available)
-	// Note: The modelViewMatrix is not used for calculating the sorted / filtered vertices, so it's not included
-	const ShadowCache::CachedShadowData *pCached = shadowCache.findCacheForShadowDraw(shape, flag, flag_data, light);
-	if (pCached == nullptr)
-	{
-		const Vector3f *pVertices = shape->points.data();
-		if (flag & pie_STATIC_SHADOW && shape->shadowEdgeList)
+void pie_ClearShadowCache()
+{
+	shadowEdgeCache.clear();
+}
+
+/// Builds the shadow volumes of all the shadow casters of this frame into shadowVertexes.
+/// Silhouettes not already cached are found as a batch, then the volumes are extruded, both spread over the worker threads.
+static void pie_BuildShadowVolumes(uint64_t currentGameFrame)
+{
+	shadowEdgeCache.setCurrentFrame(currentGameFrame);
+	shadowMisses.clear();
+	shadowVolumes.resize(scshapes.size());
+	for (unsigned i = 0; i < scshapes.size(); ++i)
+	{
+		ShadowcastingShape const &caster = scshapes[i];
+		ShadowVolume &volume = shadowVolumes[i];
+		volume.entry = nullptr;
+		if (caster.flag & pie_STATIC_SHADOW && caster.shape->shadowEdgeList)
 		{
-			drawlist = shape->shadowEdgeList;
-			edge_count = shape->nShadowEdges;
+			continue;
 		}
-		else
+		const glm::vec3 direction = glm::normalize(glm::vec3(caster.light));
+		ShadowEdgeKey key;
+		key.shape = caster.shape;
+		key.flag = caster.flag;
+		key.flag_data = caster.flag_data;
+		for (int n = 0; n < 3; ++n)
 		{
-			edgelist.clear();
-			glm::vec3 p[3];
-			for (const iIMDPoly &poly : shape->polys)
-			{
-				for (int j = 0; j < 3; ++j)
-				{
-					int current = poly.pindex[j];
-					p[j] = glm::vec3(pVertices[current].x, scale_y(pVertices[current].y, flag, flag_data), pVertices[current].z);
-				}
-				if (glm::dot(glm::cross(p[2] - p[0], p[1] - p[0]), glm::vec3(light)) > 0.0f)
-				{
-					for (int n = 0; n < 3; ++n)
-					{
-						// Add the edges
-						edgelist.push_back({poly.pindex[n], poly.pindex[(n + 1)%3]});
-					}
-				}
-			}
-
-			// Remove duplicate pairs from the edge list. For example, in the list ((1 2), (2 6), (6 2), (3, 4)), remove (2 6) and (6 2).
-			edgelistFlipped = edgelist;
-			std::for_each(edgelistFlipped.begin(), edgelistFlipped.end(), flipEdge);
-			std::sort(edgelist.begin(), edgelist.end(), edgeLessThan);
-			std::sort(edgelistFlipped.begin(), edgelistFlipped.end(), edgeLessThan);
-			edgelistFiltered.resize(edgelist.size());
-			edgelistFiltered.erase(std::set_difference(edgelist.begin(), edgelist.end(), edgelistFlipped.begin(), edgelistFlipped.end(), edgelistFiltered.begin(), edgeLessThan), edgelistFiltered.end());
+			key.light[n] = (int8_t)roundf(direction[n] * SHADOW_LIGHT_STEPS);
+		}
+		bool isNew;
+		ShadowEdgeCache::Entry &entry = shadowEdgeCache.find(key, isNew);
+		if (isNew)
+		{
+			// Find the silhouette for the rounded direction, so it doesn't depend on which caster happened to be first.
+			shadowMisses.push_back({&entry, caster.shape, caster.flag, caster.flag_data, glm::vec3(key.light[0], key.light[1], key.light[2])});
+		}
+		volume.entry = &entry;
+	}
 
-			drawlist = &edgelistFiltered[0];
-			edge_count = edgelistFiltered.size();
-			//debug(LOG_WARNING, "we have %i edges", edge_count);
+	pie_RunShadowJobs(shadowMisses.size(), pie_FindMissingSilhouettes);
 
-			if (flag & pie_STATIC_SHADOW)
+	size_t vertexCount = 0;
+	for (unsigned i = 0; i < scshapes.size(); ++i)
+	{
+		iIMDShape *shape = scshapes[i].shape;
+		ShadowVolume &volume = shadowVolumes[i];
+		if (volume.entry == nullptr)
+		{
+			volume.edges = shape->shadowEdgeList;
+			volume.edgeCount = shape->nShadowEdges;
+		}
+		else
+		{
+			volume.edges = volume.entry->edges.data();
+			volume.edgeCount = volume.entry->edges.size();
+			if (scshapes[i].flag & pie_STATIC_SHADOW && !shape->shadowEdgeList)
 			{
 				// then store it in the imd
-				shape->nShadowEdges = edge_count;
-				shape->shadowEdgeList = (EDGE *)realloc(shape->shadowEdgeList, sizeof(EDGE) * shape->nShadowEdges);
-				std::copy(drawlist, drawlist + edge_count, shape->shadowEdgeList);
+				shape->nShadowEdges = volume.edgeCount;
+				shape->shadowEdgeList = (EDGE *)malloc(sizeof(EDGE) * shape->nShadowEdges);
+				std::copy(volume.edges, volume.edges + volume.edgeCount, shape->shadowEdgeList);
 			}
 		}
-
-		static std::vector<Vector3f> vertexes;
-		vertexes.clear();
-		vertexes.reserve(edge_count * 6);
-		for (unsigned i = 0; i < edge_count; i++)
-		{
-			int a = drawlist[i].from, b = drawlist[i].to;
-
-			glm::vec3 v1(pVertices[b].x, scale_y(pVertices[b].y, flag, flag_data), pVertices[b].z);
-			glm::vec3 v3(pVertices[a].x + light[0], scale_y(pVertices[a].y, flag, flag_data) + light[1], pVertices[a].z + light[2]);
-
-			vertexes.push_back(v1);
-			vertexes.push_back(glm::vec3(pVertices[b].x + light[0], scale_y(pVertices[b].y, flag, flag_data) + light[1], pVertices[b].z + light[2])); //v2
-			vertexes.push_back(v3);
-
-			vertexes.push_back(v3);
-			vertexes.push_back(glm::vec3(pVertices[a].x, scale_y(pVertices[a].y, flag, flag_data), pVertices[a].z)); //v4
-			vertexes.push_back(v1);
-		}
-
-		ShadowCache::CachedShadowData& cache = shadowCache.createCacheForShadowDraw(shape, flag, flag_data, light);
-		cache.vertexes = vertexes;
-		result = DRAW_SUCCESS_UNCACHED;
-		pCached = &cache;
+		volume.firstVertex = vertexCount;
+		vertexCount += volume.edgeCount * 6;
 	}
-	else
+	for (ShadowEdgeMiss const &miss : shadowMisses)
 	{
-		result = DRAW_SUCCESS_CACHED;
+		shadowEdgeCache.added(*miss.entry);
 	}
 
-	// Aggregate the vertexes (pre-computed with the modelViewMatrix)
-	shadowCache.addPremultipliedVertexes(*pCached, modelViewMatrix);
-
-	return result;
+	shadowVertexes.resize(vertexCount);
+	pie_RunShadowJobs(scshapes.size(), pie_ExtrudeShadowVolumes);
 }
 
 void pie_SetUp()
 {
 	// initialise pie engine
 
+	instancingSupported = GLEW_VERSION_3_3 || (GLEW_ARB_instanced_arrays && (GLEW_VERSION_3_1 || GLEW_ARB_draw_instanced));
+	instancing = instancingSupported;
+	debug(LOG_3D, "Instanced drawing %s supported", instancingSupported ? "is" : "is NOT");
+
 	if (GLEW_EXT_stencil_wrap)
 	{
 		ss_op_depth_pass_front = GL_INCR_WRAP;
@@ -614,6 +785,18 @@ void pie_CleanUp()
 	tshapes.clear();
 	shapes.clear();
 	scshapes.clear();
+	shadowEdgeCache.clear();
+	if (instanceBuffer != 0)
+	{
+		glDeleteBuffers(1, &instanceBuffer);
+		instanceBuffer = 0;
+	}
+}
+
+bool pie_setInstancing(bool enable)
+{
+	instancing = enable && instancingSupported;
+	return instancing;
 }
 
 bool pie_Draw3DShape(iIMDShape *shape, int frame, int team, PIELIGHT colour, int pieFlag, int pieFlagData, const glm::mat4 &modelView)
@@ -688,31 +871,16 @@ bool pie_Draw3DShape(iIMDShape *shape, int frame, int team, PIELIGHT colour, int
 	return true;
 }
 
-static void pie_ShadowDrawLoop(ShadowCache &shadowCache)
+static void pie_ShadowDrawLoop()
 {
 	// Use several buffers and a round-robin algorithm to attempt to avoid implicit synchronization
 	static std::vector<glBufferWrapper> buffers(10);
 	static std::vector<size_t> priorBufferSize(10, 0);
 	static size_t currBuffer = 0;
 
-	size_t cachedShadowDraws = 0;
-	size_t uncachedShadowDraws = 0;
-	for (unsigned i = 0; i < scshapes.size(); i++)
-	{
-		DrawShadowResult result = pie_DrawShadow(shadowCache, scshapes[i].shape, scshapes[i].flag, scshapes[i].flag_data, scshapes[i].light, scshapes[i].matrix);
-		if (result == DRAW_SUCCESS_CACHED)
-		{
-			++cachedShadowDraws;
-		}
-		else
-		{
-			++uncachedShadowDraws;
-		}
-	}
-
 	// Draw the shadow volume
-	const auto &premultipliedVertexes = shadowCache.getPremultipliedVertexes();
-	// The vertexes returned by shadowCache.getPremultipliedVertexes() are pre-multiplied by the modelViewMatrix
+	const auto &premultipliedVertexes = shadowVertexes;
+	// The vertexes built by pie_BuildShadowVolumes() are pre-multiplied by the modelViewMatrix
 	// Thus we only need to include the perspective matrix
 	const auto &program = pie_ActivateShader(SHADER_GENERIC_COLOR, pie_PerspectiveGet() /** modelViewMatrix*/, glm::vec4());
 	glBindBuffer(GL_ARRAY_BUFFER, buffers[currBuffer].id);
@@ -727,25 +895,21 @@ static void pie_ShadowDrawLoop(ShadowCache &shadowCache)
 	for (GLint startingIndex = 0; startingIndex < vertex_count; startingIndex += SHADOW_BATCH_MAX)
 	{
 		glDrawArrays(GL_TRIANGLES, startingIndex, std::min(vertex_count - startingIndex, SHADOW_BATCH_MAX));
+		drawCallCount++;
 	}
 
-	shadowCache.clearPremultipliedVertexes();
-
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glDisableVertexAttribArray(program.locVertex);
 	pie_DeactivateShader();
-//	debug(LOG_INFO, "Cached shadow draws: %lu, uncached shadow draws: %lu", cachedShadowDraws, uncachedShadowDraws);
 	++currBuffer;
 	if (currBuffer >= buffers.size()) { currBuffer = 0; }
 }
 
-static ShadowCache shadowCache;
-
 static void pie_DrawShadows(uint64_t currentGameFrame)
 {
 	const float width = pie_GetVideoBufferWidth();
 	const float height = pie_GetVideoBufferHeight();
-	shadowCache.setCurrentFrame(currentGameFrame);
+	pie_BuildShadowVolumes(currentGameFrame);
 
 	pie_SetTexturePage(TEXPAGE_NONE);
 
@@ -773,19 +937,68 @@ static void pie_DrawShadows(uint64_t currentGameFrame)
 	glDepthMask(GL_TRUE);
 
 	scshapes.resize(0);
-	shadowCache.removeUnused();
+	shadowVertexes.clear();
+	shadowEdgeCache.trim();
+}
+
+/// Orders opaque shapes by the state needed to draw them: shader, then texture page, then shape, then frame. ECM shapes are blended, so they go last.
+static uint64_t pie_ShapeStateKey(SHAPE const &shape)
+{
+	SHADER_MODE mode = shape.shape->shaderProgram == SHADER_NONE ? SHADER_COMPONENT : shape.shape->shaderProgram;
+	return (uint64_t)((shape.flag & pie_ECM) != 0) << 63 |
+	       (uint64_t)(mode & 0x7F) << 56 |
+	       (uint64_t)(shape.shape->texpage & 0xFFFF) << 40 |
+	       (uint64_t)((uintptr_t)shape.shape >> 4 & 0xFFFFFF) << 16 |
+	       (uint64_t)(shape.frame & 0xFFFF);
 }
 
+struct ShapeOrder
+{
+	uint64_t key;
+	unsigned index;
+};
+
 void pie_RemainingPasses(uint64_t currentGameFrame)
 {
-	// Draw models
-	// TODO, sort list to reduce state changes
+	// Draw models, sorted to reduce state changes
 	GL_DEBUG("Remaining passes - opaque models");
-	for (SHAPE const &shape : shapes)
+	static std::vector<ShapeOrder> order, orderScratch;  // Static, to save allocations.
+	order.resize(shapes.size());
+	for (unsigned i = 0; i < shapes.size(); ++i)
+	{
+		order[i].key = pie_ShapeStateKey(shapes[i]);
+		order[i].index = i;
+	}
+	radixSort(order, orderScratch, [](ShapeOrder const &o) { return o.key; });
+	static std::vector<InstanceData> instances;  // Static, to save allocations.
+	for (size_t i = 0; i < order.size();)
 	{
+		SHAPE const &shape = shapes[order[i].index];
+		size_t count = 1;
+		while (instancing && i + count < order.size() && pie_CanInstance(shape, shapes[order[i + count].index]))
+		{
+			++count;
+		}
 		pie_SetShaderStretchDepth(shape.stretch);
-		pie_Draw3DShape2(shape.shape, shape.frame, shape.colour, shape.teamcolour, shape.flag, shape.flag_data, shape.matrix);
+		if (count == 1)
+		{
+			pie_Draw3DShape2(shape.shape, shape.frame, shape.colour, shape.teamcolour, shape.flag, shape.flag_data, shape.matrix);
+		}
+		else
+		{
+			instances.resize(count);
+			for (size_t n = 0; n < count; ++n)
+			{
+				SHAPE const &instance = shapes[order[i + n].index];
+				instances[n].modelView = instance.matrix;
+				instances[n].normalMatrix = glm::transpose(glm::inverse(instance.matrix));
+				instances[n].teamColour = pal_PIELIGHTtoVec4(instance.teamcolour);
+			}
+			pie_Draw3DShapeInstanced(shape.shape, shape.frame, shape.colour, shape.flag, instances);
+		}
+		i += count;
 	}
+	disableArrays();
 	GL_DEBUG("Remaining passes - shadows");
 	// Draw shadows
 	if (shadows)
@@ -800,6 +1013,7 @@ void pie_RemainingPasses(uint64_t currentGameFrame)
 		pie_SetShaderStretchDepth(shape.stretch);
 		pie_Draw3DShape2(shape.shape, shape.frame, shape.colour, shape.teamcolour, shape.flag, shape.flag_data, shape.matrix);
 	}
+	disableArrays();
 	pie_SetShaderStretchDepth(0);
 	pie_DeactivateShader();
 	tshapes.clear();
@@ -807,13 +1021,17 @@ void pie_RemainingPasses(uint64_t currentGameFrame)
 	GL_DEBUG("Remaining passes - done");
 }
 
-void pie_GetResetCounts(unsigned int *pPieCount, unsigned int *pPolyCount)
+void pie_GetResetCounts(unsigned int *pPieCount, unsigned int *pPolyCount, unsigned int *pDrawCallCount, unsigned int *pDrawCallsSaved)
 {
 	*pPieCount  = pieCount;
 	*pPolyCount = polyCount;
+	*pDrawCallCount = drawCallCount;
+	*pDrawCallsSaved = drawCallsSaved;
 
 	pieCount = 0;
 	polyCount = 0;
+	drawCallCount = 0;
+	drawCallsSaved = 0;
 }
 
 // GL 2.0 1-pass version
@@ -825,7 +1043,7 @@ static void ss_GL2_1pass()
 	glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_KEEP, GL_DECR_WRAP);
 	glStencilFunc(GL_ALWAYS, 0, ~0);
 
-	pie_ShadowDrawLoop(shadowCache);
+	pie_ShadowDrawLoop();
 }
 
 // generic 1-pass version
@@ -841,7 +1059,7 @@ static void ss_EXT_1pass()
 	glStencilOp(GL_KEEP, GL_KEEP, ss_op_depth_pass_front);
 	glStencilFunc(GL_ALWAYS, 0, ~0);
 
-	pie_ShadowDrawLoop(shadowCache);
+	pie_ShadowDrawLoop();
 
 	glDisable(GL_STENCIL_TEST_TWO_SIDE_EXT);
 }
@@ -855,7 +1073,7 @@ static void ss_ATI_1pass()
 	glStencilOpSeparateATI(GL_FRONT, GL_KEEP, GL_KEEP, ss_op_depth_pass_front);
 	glStencilFunc(GL_ALWAYS, 0, ~0);
 
-	pie_ShadowDrawLoop(shadowCache);
+	pie_ShadowDrawLoop();
 }
 
 // generic 2-pass version
@@ -869,11 +1087,11 @@ static void ss_2pass()
 	glCullFace(GL_BACK);
 	glStencilOp(GL_KEEP, GL_KEEP, ss_op_depth_pass_front);
 
-	pie_ShadowDrawLoop(shadowCache);
+	pie_ShadowDrawLoop();
 
 	// Setup stencil for back-facing polygons
 	glCullFace(GL_FRONT);
 	glStencilOp(GL_KEEP, GL_KEEP, ss_op_depth_pass_back);
 
-	pie_ShadowDrawLoop(shadowCache);
+	pie_ShadowDrawLoop();
 }
@@ -192,6 +192,9 @@ static void getLocs(pie_internal::SHADER_PROGRAM *program)
 	program->locNormal = glGetAttribLocation(program->program, "vertexNormal");
 	program->locTexCoord = glGetAttribLocation(program->program, "vertexTexCoord");
 	program->locColor = glGetAttribLocation(program->program, "vertexColor");
+	program->locInstanceModelView = glGetAttribLocation(program->program, "instanceModelViewMatrix");
+	program->locInstanceNormalMatrix = glGetAttribLocation(program->program, "instanceNormalMatrix");
+	program->locInstanceTeamColour = glGetAttribLocation(program->program, "instanceTeamColour");
 
 	// Uniforms, these never change.
 	GLint locTex0 = glGetUniformLocation(program->program, "Texture");
@@ -742,6 +745,15 @@ bool pie_LoadShaders()
 		{ "transformationMatrix", "tuv_offset", "tuv_scale", "color", "theTexture" });
 	ASSERT_OR_RETURN(false, result && ++shaderEnum == SHADER_TEXT, "Failed to load text shader");
 
+	// TCMask shader for drawing many copies of the same model at once. The uniforms are in the same order as the component shader's,
+	// but the model view and normal matrices and team colour come from each instance, so it gets the projection matrix instead.
+	debug(LOG_3D, "Loading shader: SHADER_COMPONENT_INSTANCED");
+	result = pie_LoadShader(version, "Component instanced program", "shaders/tcmask_instanced.vert", "shaders/tcmask_instanced.frag",
+		{ "colour", "teamcolour", "stretch", "tcmask", "fogEnabled", "normalmap", "specularmap", "ecmEffect", "alphaTest", "graphicsCycle",
+		"ModelViewMatrix", "ProjectionMatrix", "NormalMatrix", "lightPosition", "sceneColor", "ambient", "diffuse", "specular",
+		"fogEnd", "fogStart", "fogColor" });
+	ASSERT_OR_RETURN(false, result && ++shaderEnum == SHADER_COMPONENT_INSTANCED, "Failed to load component instanced shader");
+
 	pie_internal::currentShaderMode = SHADER_NONE;
 
 	GLbyte rect[] {
@@ -121,6 +121,9 @@ namespace pie_internal
 		GLint locNormal;
 		GLint locTexCoord;
 		GLint locColor;
+		GLint locInstanceModelView;     // mat4, so uses 4 locations
+		GLint locInstanceNormalMatrix;  // mat4, so uses 4 locations
+		GLint locInstanceTeamColour;
 	};
 
 	extern std::vector<SHADER_PROGRAM> shaderProgram;
@@ -105,6 +105,7 @@ enum SHADER_MODE
 	SHADER_GENERIC_COLOR,
 	SHADER_LINE,
 	SHADER_TEXT,
+	SHADER_COMPONENT_INSTANCED,
 	SHADER_MAX
 };
 
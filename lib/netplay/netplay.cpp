@@ -41,6 +41,7 @@
 #include <memory>
 #include <thread>
 #include <atomic>
+#include <QtCore/QElapsedTimer>
 
 #include "netplay.h"
 #include "netlog.h"
@@ -182,7 +183,7 @@ unsigned NET_PlayerConnectionStatus[CONNECTIONSTATUS_NORMAL][MAX_PLAYERS];
 **/
 static char const *versionString = version_getVersionString();
 static int NETCODE_VERSION_MAJOR = 0x1000;
-static int NETCODE_VERSION_MINOR = 0;
+static int NETCODE_VERSION_MINOR = 1;
 
 bool NETisCorrectVersion(uint32_t game_version_major, uint32_t game_version_minor)
 {
@@ -3291,6 +3292,234 @@ struct SyncDebugIntList : public SyncDebugEntry
 	unsigned numInts;
 };
 
+/// A printf conversion specification, such as "%08X" or "%.*s".
+struct SyncDebugConversion
+{
+	/// Finds the first conversion specification in format, and returns where it starts, or nullptr if there is none.
+	char const *find(char const *format)
+	{
+		char const *p = strchr(format, '%');
+		if (p == nullptr)
+		{
+			return nullptr;
+		}
+		begin = p++;
+		numStars = 0;
+		while (*p != '\0' && strchr("-+ #0", *p) != nullptr)
+		{
+			++p;
+		}
+		for (int field = 0; field < 2; ++field)  // Width, then precision.
+		{
+			if (field == 1 && *p == '.')
+			{
+				++p;
+			}
+			else if (field == 1)
+			{
+				break;
+			}
+			if (*p == '*')
+			{
+				++numStars;
+				++p;
+			}
+			while (*p >= '0' && *p <= '9')
+			{
+				++p;
+			}
+		}
+		length = *p == 'h' || *p == 'l' || *p == 'z' || *p == 'j' || *p == 't' || *p == 'L' ? *p++ : '\0';
+		if ((length == 'h' || length == 'l') && *p == length)
+		{
+			length = length == 'h' ? 'H' : 'q';  // "hh" or "ll".
+			++p;
+		}
+		conversion = *p;
+		end = *p != '\0' ? p + 1 : p;
+		return begin;
+	}
+
+	char const *begin;      ///< The '%'.
+	char const *end;        ///< Just after the conversion character.
+	unsigned numStars;      ///< Number of '*' widths and precisions, which take int arguments.
+	char length;            ///< Length modifier, or 'H' for "hh", or 'q' for "ll", or '\0' if none.
+	char conversion;        ///< Conversion character, such as 'd'.
+};
+
+/// A syncDebug() line, stored as its format string and arguments, and only printed if dumping the log.
+struct SyncDebugFormatted : public SyncDebugEntry
+{
+	/// Reads the arguments of format from ap into args and chars, and adds them to the CRC.
+	void set(uint32_t &crc, char const *f, char const *format_, va_list ap, std::vector<int64_t> &args, std::vector<char> &chars)
+	{
+		function = f;
+		format = format_;
+		numArgs = 0;
+		crc = crcSum(crc, function, strlen(function) + 1);
+		crc = crcSum(crc, format,   strlen(format) + 1);
+
+		uint8_t argBytes[8 * 16];  // Arguments in big-endian order, to CRC them all at once.
+		unsigned numArgBytes = 0;
+		auto add = [&](int64_t value) {
+			args.push_back(value);
+			++numArgs;
+			if (numArgBytes == sizeof(argBytes))
+			{
+				crc = crcSum(crc, argBytes, numArgBytes);
+				numArgBytes = 0;
+			}
+			for (int shift = 56; shift >= 0; shift -= 8)
+			{
+				argBytes[numArgBytes++] = value >> shift;
+			}
+		};
+
+		SyncDebugConversion conv;
+		for (char const *p = format; conv.find(p) != nullptr; p = conv.end)
+		{
+			for (unsigned star = 0; star < conv.numStars; ++star)
+			{
+				add(va_arg(ap, int));
+			}
+			switch (conv.conversion)
+			{
+			case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+				switch (conv.length)
+				{
+				case 'l': add(va_arg(ap, long)); break;
+				case 'q': add(va_arg(ap, long long)); break;
+				case 'z': add(va_arg(ap, size_t)); break;
+				case 'j': add(va_arg(ap, intmax_t)); break;
+				case 't': add(va_arg(ap, ptrdiff_t)); break;
+				default:  add(conv.conversion == 'd' || conv.conversion == 'i' ? va_arg(ap, int) : (int64_t)va_arg(ap, unsigned)); break;
+				}
+				break;
+			case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+				{
+					double value = conv.length == 'L' ? (double)va_arg(ap, long double) : va_arg(ap, double);
+					int64_t bits;
+					memcpy(&bits, &value, sizeof(bits));
+					add(bits);
+					break;
+				}
+			case 's':
+				{
+					char const *string = va_arg(ap, char const *);
+					string = string != nullptr ? string : "(null)";
+					size_t len = strlen(string) + 1;
+					add(chars.size());
+					chars.insert(chars.end(), string, string + len);
+					crc = crcSum(crc, string, len);
+					break;
+				}
+			case 'p':
+				add((uintptr_t)va_arg(ap, void *));
+				break;
+			default:
+				break;  // "%%", or something not supported, which takes no argument.
+			}
+		}
+		crc = crcSum(crc, argBytes, numArgBytes);
+	}
+	int snprint(char *buf, size_t bufSize, int64_t const *&args, char const *chars) const
+	{
+		size_t index = 0;
+		auto print = [&](int len) {
+			index += std::max(len, 0);
+			return index < bufSize;
+		};
+		if (!print(snprintf(buf, bufSize, "[%s] ", function)))
+		{
+			args += numArgs;
+			return index;
+		}
+
+		int64_t const *arg = args;
+		SyncDebugConversion conv;
+		char spec[32];
+		char const *p = format;
+		for (; conv.find(p) != nullptr; p = conv.end)
+		{
+			if (!print(snprintf(buf + index, bufSize - index, "%.*s", (int)(conv.begin - p), p)))
+			{
+				break;
+			}
+			sstrcpy(spec, "");
+			if ((size_t)(conv.end - conv.begin) < sizeof(spec))
+			{
+				memcpy(spec, conv.begin, conv.end - conv.begin);
+				spec[conv.end - conv.begin] = '\0';
+			}
+			int stars[2] = {0, 0};
+			for (unsigned star = 0; star < conv.numStars; ++star)
+			{
+				stars[star] = *arg++;
+			}
+			int len = 0;
+			switch (conv.conversion)
+			{
+			case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+				switch (conv.length)
+				{
+				case 'l': len = printArg(buf + index, bufSize - index, spec, stars, conv.numStars, (long)*arg++); break;
+				case 'q': len = printArg(buf + index, bufSize - index, spec, stars, conv.numStars, (long long)*arg++); break;
+				case 'z': len = printArg(buf + index, bufSize - index, spec, stars, conv.numStars, (size_t)*arg++); break;
+				case 'j': len = printArg(buf + index, bufSize - index, spec, stars, conv.numStars, (intmax_t)*arg++); break;
+				case 't': len = printArg(buf + index, bufSize - index, spec, stars, conv.numStars, (ptrdiff_t)*arg++); break;
+				default:  len = printArg(buf + index, bufSize - index, spec, stars, conv.numStars, (int)*arg++); break;
+				}
+				break;
+			case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+				{
+					double value;
+					memcpy(&value, arg++, sizeof(value));
+					len = conv.length == 'L' ? printArg(buf + index, bufSize - index, spec, stars, conv.numStars, (long double)value)
+					                         : printArg(buf + index, bufSize - index, spec, stars, conv.numStars, value);
+					break;
+				}
+			case 's':
+				len = printArg(buf + index, bufSize - index, spec, stars, conv.numStars, chars + *arg++);
+				break;
+			case 'p':
+				len = printArg(buf + index, bufSize - index, spec, stars, conv.numStars, (void *)(uintptr_t)*arg++);
+				break;
+			case '%':
+				len = snprintf(buf + index, bufSize - index, "%%");
+				break;
+			default:
+				len = snprintf(buf + index, bufSize - index, "%s", spec);
+				break;
+			}
+			if (!print(len))
+			{
+				break;
+			}
+		}
+		if (index < bufSize)
+		{
+			print(snprintf(buf + index, bufSize - index, "%s\n", p));  // Text after the last conversion.
+		}
+		args += numArgs;
+		return index;
+	}
+
+	char const *format;
+	unsigned numArgs;
+
+private:
+	template <typename T>
+	static int printArg(char *buf, size_t bufSize, char const *spec, int const *stars, unsigned numStars, T value)
+	{
+		switch (numStars)
+		{
+		case 0:  return snprintf(buf, bufSize, spec, value);
+		case 1:  return snprintf(buf, bufSize, spec, stars[0], value);
+		default: return snprintf(buf, bufSize, spec, stars[0], stars[1], value);
+		}
+	}
+};
+
 struct SyncDebugLog
 {
 	SyncDebugLog() : time(0), crc(0x00000000) {}
@@ -3303,8 +3532,11 @@ struct SyncDebugLog
 		strings.clear();
 		valueChanges.clear();
 		intLists.clear();
+		formatteds.clear();
 		chars.clear();
 		ints.clear();
+		args.clear();
+		argChars.clear();
 	}
 	void string(char const *f, char const *s)
 	{
@@ -3335,13 +3567,22 @@ struct SyncDebugLog
 		intLists.back().set(crc, f, s, buf, num);
 		log.push_back('i');
 	}
+	void formatted(char const *f, char const *format, va_list ap)
+	{
+		formatteds.resize(formatteds.size() + 1);
+		formatteds.back().set(crc, f, format, ap, args, argChars);
+		log.push_back('f');
+	}
 	int snprint(char *buf, size_t bufSize)
 	{
 		SyncDebugString const *stringPtr = strings.empty() ? nullptr : &strings[0]; // .empty() check, since &strings[0] is undefined if strings is empty(), even if it's likely to work, anyway.
 		SyncDebugValueChange const *valueChangePtr = valueChanges.empty() ? nullptr : &valueChanges[0];
 		SyncDebugIntList const *intListPtr = intLists.empty() ? nullptr : &intLists[0];
 		char const *charPtr = chars.empty() ? nullptr : &chars[0];
+		SyncDebugFormatted const *formattedPtr = formatteds.empty() ? nullptr : &formatteds[0];
 		int const *intPtr = ints.empty() ? nullptr : &ints[0];
+		int64_t const *argPtr = args.empty() ? nullptr : &args[0];
+		char const *argCharPtr = argChars.empty() ? nullptr : &argChars[0];
 
 		int index = 0;
 		for (size_t n = 0; n < log.size() && (size_t)index < bufSize; ++n)
@@ -3358,6 +3599,9 @@ struct SyncDebugLog
 			case 'i':
 				index += intListPtr++->snprint(buf + index, bufSize - index, intPtr);
 				break;
+			case 'f':
+				index += formattedPtr++->snprint(buf + index, bufSize - index, argPtr, argCharPtr);
+				break;
 			default:
 				abort();
 				break;
@@ -3394,9 +3638,12 @@ private:
 	std::vector<SyncDebugString> strings;
 	std::vector<SyncDebugValueChange> valueChanges;
 	std::vector<SyncDebugIntList> intLists;
+	std::vector<SyncDebugFormatted> formatteds;
 
 	std::vector<char> chars;
 	std::vector<int> ints;
+	std::vector<int64_t> args;
+	std::vector<char> argChars;  ///< Strings passed to formatted entries, indexed by their args.
 
 private:
 	SyncDebugLog(SyncDebugLog const &)/* = delete*/;
@@ -3423,13 +3670,10 @@ void _syncDebug(const char *function, const char *str, ...)
 #endif
 
 	va_list ap;
-	char outputBuffer[MAX_LEN_LOG_LINE];
 
 	va_start(ap, str);
-	vssprintf(outputBuffer, str, ap);
+	syncDebugLog[syncDebugNext].formatted(function, str, ap);  // Only printed if the log is dumped.
 	va_end(ap);
-
-	syncDebugLog[syncDebugNext].string(function, outputBuffer);
 }
 
 void _syncDebugIntList(const char *function, const char *str, int *ints, size_t numInts)
@@ -3513,6 +3757,77 @@ GameCrcType nextDebugSync()
 	return (GameCrcType)ret;
 }
 
+static void syncDebugBenchmarkPrinted(SyncDebugLog &log, char const *function, char const *str, ...)
+{
+	va_list ap;
+	char outputBuffer[MAX_LEN_LOG_LINE];
+
+	va_start(ap, str);
+	vssprintf(outputBuffer, str, ap);
+	va_end(ap);
+
+	log.string(function, outputBuffer);
+}
+
+static void syncDebugBenchmarkFormatted(SyncDebugLog &log, char const *function, char const *str, ...)
+{
+	va_list ap;
+
+	va_start(ap, str);
+	log.formatted(function, str, ap);
+	va_end(ap);
+}
+
+SYNCDEBUG_BENCHMARK syncDebugBenchmark(unsigned numCalls)
+{
+	SYNCDEBUG_BENCHMARK result;
+	result.calls = numCalls;
+	result.entriesPerTick = syncDebugLog[(syncDebugNext + MAX_SYNC_HISTORY - 1) % MAX_SYNC_HISTORY].getNumEntries();
+
+	// Typical calls, as made by syncDebugDroid(), syncDebugStructure() and friends. Logged to scratch logs, so the real sync debug log is untouched.
+	static SyncDebugLog printedLog, formattedLog;
+	auto calls = [numCalls](void (*call)(SyncDebugLog &, char const *, char const *, ...), SyncDebugLog &log) {
+		QElapsedTimer timer;
+		timer.start();
+		for (unsigned n = 0; n < numCalls; ++n)
+		{
+			switch (n % 4)
+			{
+			case 0: call(log, "syncDebugDroid", "%c droid%d = p%d;pos(%d,%d,%d),rot(%d,%d,%d),order%d(%d,%d)^%d,action%d,secondaryOrder%X,body%d,sMove(status%d,speed%d,moveDir%d,path%d/%d,src(%d,%d),target(%d,%d),destination(%d,%d),bump(%d,%d,%d,%d,(%d,%d),%d)),exp%u", '<', 1000 + n, n % 8, 4160 + n, 2112, 280, 16384, 0, 0, 2, 50, 48, 1, 2, 0x12, 400, 1, 512, 8192, 3, 7, 4160, 2112, 6208, 3136, 6208, 3136, 0, 0, 0, 0, 0, 0, 0, n * 10);
+				break;
+			case 1: call(log, "syncDebugStructure", "%c structure%d = p%d;pos(%d,%d,%d),status%d,type%d,bits%d,body%d", '>', 2000 + n, n % 8, 3200, 2240, 256, 1, 7, 0, 1500);
+				break;
+			case 2: call(log, "orderDroidBase", "%s:%d order %d", "droid", 3000 + n, 4);
+				break;
+			case 3: call(log, "triggerEvent", "Event %d, player %u, CRC %08X", 17, n % 8, n * 2654435761u);
+				break;
+			}
+		}
+		return timer.nsecsElapsed();
+	};
+
+	// Run each way twice, and keep the second, so neither gets penalised for warming up the caches and growing the logs.
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		printedLog.clear();
+		formattedLog.clear();
+		result.printedNanoseconds = calls(syncDebugBenchmarkPrinted, printedLog);
+		result.formattedNanoseconds = calls(syncDebugBenchmarkFormatted, formattedLog);
+	}
+
+	// Both logs should dump the same text.
+	static std::vector<char> printedText, formattedText;
+	printedText.assign(numCalls * MAX_LEN_LOG_LINE + 1, '\0');
+	formattedText.assign(numCalls * MAX_LEN_LOG_LINE + 1, '\0');
+	int printedLen = printedLog.snprint(&printedText[0], printedText.size());
+	int formattedLen = formattedLog.snprint(&formattedText[0], formattedText.size());
+	result.identical = printedLen == formattedLen && printedText == formattedText;
+
+	printedLog.clear();
+	formattedLog.clear();
+	return result;
+}
+
 static void dumpDebugSync(uint8_t *buf, size_t bufLen, uint32_t time, unsigned player)
 {
 	char fname[100];
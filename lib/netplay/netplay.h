@@ -354,4 +354,14 @@ void resetSyncDebug();                                              ///< Resets
 GameCrcType nextDebugSync();                                        ///< Returns a CRC corresponding to all syncDebug() calls since the last nextDebugSync() or resetSyncDebug() call.
 bool checkDebugSync(uint32_t checkGameTime, GameCrcType checkCrc);  ///< Dumps all syncDebug() calls from that gameTime, if the CRC doesn't match.
 
+struct SYNCDEBUG_BENCHMARK
+{
+	unsigned calls;                 ///< Number of syncDebug() calls timed each way.
+	unsigned entriesPerTick;        ///< Number of entries in the last complete sync debug log, for estimating the cost per tick.
+	uint64_t printedNanoseconds;    ///< Time taken, if formatting every call as text.
+	uint64_t formattedNanoseconds;  ///< Time taken, if storing the arguments, and only formatting when dumping.
+	bool identical;                 ///< True if both ways dump the same text.
+};
+SYNCDEBUG_BENCHMARK syncDebugBenchmark(unsigned numCalls);         ///< Times typical syncDebug() calls, without touching the real sync debug log.
+
 #endif
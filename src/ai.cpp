@@ -72,6 +72,10 @@
 #define	WEIGHT_CMD_RANK				(WEIGHT_DIST_TILE * 4)			//A single rank is as important as 4 tiles distance
 #define	WEIGHT_CMD_SAME_TARGET		WEIGHT_DIST_TILE				//Don't want this to be too high, since a commander can have many units assigned
 
+// Droids near each other share the grid search for target candidates. Each search covers a cell, plus the range rounded up to a whole band.
+#define AI_TARGET_CELL_SIZE			(TILE_UNITS * 2)
+#define AI_TARGET_RANGE_BAND		TILE_UNITS
+
 uint8_t alliances[MAX_PLAYER_SLOTS][MAX_PLAYER_SLOTS];
 
 /// A bitfield of vision sharing in alliances, for quick manipulation of vision information
@@ -524,6 +528,40 @@ static SDWORD targetAttackWeight(BASE_OBJECT *psTarget, BASE_OBJECT *psAttacker,
 }
 
 
+static GridSearchCache aiTargetSearches(AI_TARGET_CELL_SIZE, AI_TARGET_RANGE_BAND);
+static uint64_t aiTargetSearchMismatches = 0;
+static bool aiTargetCacheVerify = false;
+
+/// Returns exactly what gridStartIterate(pos.x, pos.y, range) would, but shares the grid search with other droids in the same cell with similar ranges.
+/// The candidates are not filtered by player or visibility, since that can change while droids are updated, and must be checked again for each droid.
+static GridList const &aiTargetCandidatesNear(Vector2i pos, int range)
+{
+	static GridList gridList;  // static to avoid allocations.
+	aiTargetSearches.search(gridList, pos.x, pos.y, range);
+
+	if (aiTargetCacheVerify && gridList != gridStartIterate(pos.x, pos.y, range))
+	{
+		++aiTargetSearchMismatches;
+		ASSERT(false, "Target candidates at (%d, %d) range %d differ from searching the grid.", pos.x, pos.y, range);
+	}
+	return gridList;
+}
+
+AI_TARGET_CACHE_STATISTICS aiTargetCacheStatistics()
+{
+	AI_TARGET_CACHE_STATISTICS stats;
+	stats.lookups = aiTargetSearches.statistics().lookups;
+	stats.hits = aiTargetSearches.statistics().hits;
+	stats.candidates = aiTargetSearches.statistics().candidates;
+	stats.mismatches = aiTargetSearchMismatches;
+	return stats;
+}
+
+void aiTargetCacheSetVerify(bool verify)
+{
+	aiTargetCacheVerify = verify;
+}
+
 // Find the best nearest target for a droid.
 // If extraRange is higher than zero, then this is the range it accepts for movement to target.
 // Returns integer representing target priority, -1 if failed
@@ -565,8 +603,7 @@ int aiBestNearestTarget(DROID *psDroid, BASE_OBJECT **ppsObj, int weapon_slot, i
 	// Range was previously 9*TILE_UNITS. Increasing this doesn't seem to help much, though. Not sure why.
 	int droidRange = std::min(aiDroidRange(psDroid, weapon_slot) + extraRange, objSensorRange(psDroid) + 6 * TILE_UNITS);
 
-	static GridList gridList;  // static to avoid allocations.
-	gridList = gridStartIterate(psDroid->pos.x, psDroid->pos.y, droidRange);
+	GridList const &gridList = aiTargetCandidatesNear(psDroid->pos.xy, droidRange);
 	for (GridIterator gi = gridList.begin(); gi != gridList.end(); ++gi)
 	{
 		BASE_OBJECT *friendlyObj = nullptr;
@@ -67,6 +67,17 @@ void aiUpdateDroid(DROID *psDroid);
 // returns integer representing quality of choice, -1 if failed
 int aiBestNearestTarget(DROID *psDroid, BASE_OBJECT **ppsObj, int weapon_slot, int extraRange = 0);
 
+struct AI_TARGET_CACHE_STATISTICS
+{
+	uint64_t lookups = 0;     ///< Number of times aiBestNearestTarget() looked for target candidates.
+	uint64_t hits = 0;        ///< Number of those which reused a grid search from a nearby droid, this tick.
+	uint64_t candidates = 0;  ///< Number of objects checked for being in range, when filtering the shared searches.
+	uint64_t mismatches = 0;  ///< Number of times the candidates differed from searching the grid directly, while verifying.
+};
+AI_TARGET_CACHE_STATISTICS aiTargetCacheStatistics();
+/// If verifying, aiBestNearestTarget() also searches the grid directly, and checks that it finds the same candidates, in the same order.
+void aiTargetCacheSetVerify(bool verify);
+
 // Are there a lot of bullets heading towards the structure?
 bool aiObjectIsProbablyDoomed(BASE_OBJECT *psObject, bool isDirect);
 
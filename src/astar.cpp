@@ -38,6 +38,23 @@
  *  Up to 30 pathfinding maps from A* are cached, in a LRU list. The PathNode heap con-
  *  tains the  priority-heap-sorted  nodes which are to be explored.  The path back  is
  *  stored in the PathExploredTile 2D array of tiles.
+ *  In hierarchical mode,  the map is split into clusters of 16x16 tiles,  and each cluster
+ *  into the regions of tiles which are connected within the cluster. A* over the graph of
+ *  regions finds  the corridor of regions  the route passes through,  and the tile by tile
+ *  search is then restricted to that corridor.  The region graph is kept for each kind of
+ *  blocking map, and only the clusters where the blocking map changed are rebuilt.
+ *  Blocking maps are packed one bit per tile into 64-bit words.  Instead of regenerating
+ *  them every tick, the latest map of each kind is patched,  re-checking only the tiles
+ *  which the aux maps report as changed.
+ *  In Jump Point Search mode, instead of adding every neighbour of every tile to the open
+ *  list,  the search jumps  along straight and diagonal lines  until reaching a tile with
+ *  neighbours which  cannot be reached as cheaply  some other way.  Tiles near danger and
+ *  near the destination structure have irregular costs or movement rules,  so are expan-
+ *  ded like in the classic search.
+ *  Routes found are also kept in a small cache per lane.  When another droid leaves from
+ *  near a cached route  towards the same destination,  and can walk  straight to a point
+ *  on the route,  it joins the route there  instead of searching.  A cached route is only
+ *  used while the blocking map it was found on is unchanged.
  */
 
 #ifndef WZ_TESTING
@@ -51,7 +68,16 @@
 #include <vector>
 #include <algorithm>
 #include <memory>
+#include <unordered_map>
+#include <atomic>
 
+#include <QtCore/QElapsedTimer>
+
+#if defined(WZ_CC_MSVC)
+#include <intrin.h>
+#endif
+
+#include "lib/framework/math_ext.h"
 #include "lib/netplay/netplay.h"
 
 /// A coordinate.
@@ -100,12 +126,13 @@ struct PathNode
 };
 struct PathExploredTile
 {
-	PathExploredTile() : iteration(0xFFFF), dx(0), dy(0), dist(0), visited(false) {}
+	PathExploredTile() : iteration(0xFFFF), dx(0), dy(0), dist(0), visited(false), expandAll(false) {}
 
 	uint16_t iteration;
 	int8_t   dx, dy;                // Offset from previous point in the route.
 	unsigned dist;                  // Shortest known distance to tile.
 	bool     visited;
+	bool     expandAll;             // Jump Point Search: equally short ways lead here from several directions, so try all directions from here.
 };
 
 struct PathBlockingType
@@ -116,6 +143,185 @@ struct PathBlockingType
 	int owner;
 	FPATH_MOVETYPE moveType;
 };
+#define PATH_CLUSTER_SIZE 16                                            ///< Width and height of a cluster, in tiles.
+#define PATH_CLUSTER_MAX_REGIONS (PATH_CLUSTER_SIZE * PATH_CLUSTER_SIZE / 2)  ///< A checkerboard of free tiles has the most regions.
+
+/// Tiles of a cluster which are connected within the cluster.
+struct PathRegion
+{
+	PathCoord centre;                   ///< Tile of the region closest to its centre.
+	std::vector<uint16_t> neighbours;   ///< Regions in adjacent clusters which can be entered directly from this region.
+};
+
+/// Regions of a cluster. Never changed once built, so clusters can be shared between threads and between hierarchies.
+struct PathCluster
+{
+	uint8_t tileRegion[PATH_CLUSTER_SIZE * PATH_CLUSTER_SIZE];  ///< Region of each tile, counting from 1, or 0 if blocking.
+	std::vector<PathRegion> regions;
+};
+
+/// Graph of the regions of all clusters of a blocking map.
+struct PathHierarchy
+{
+	/// Region containing the tile, or 0 if the tile is blocking.
+	uint16_t regionAt(int x, int y) const
+	{
+		if (x < 0 || y < 0 || x >= mapWidth || y >= mapHeight)
+		{
+			return 0;
+		}
+		int cluster = x / PATH_CLUSTER_SIZE + y / PATH_CLUSTER_SIZE * width;
+		unsigned local = clusters[cluster]->tileRegion[x % PATH_CLUSTER_SIZE + y % PATH_CLUSTER_SIZE * PATH_CLUSTER_SIZE];
+		return local != 0 ? cluster * PATH_CLUSTER_MAX_REGIONS + local : 0;
+	}
+	PathRegion const &region(uint16_t id) const
+	{
+		return clusters[(id - 1) / PATH_CLUSTER_MAX_REGIONS]->regions[(id - 1) % PATH_CLUSTER_MAX_REGIONS];
+	}
+
+	int width = 0, height = 0;          ///< Size of the map, in clusters.
+	std::vector<std::shared_ptr<PathCluster const>> clusters;
+};
+
+/// Index of the lowest set bit, of which there must be at least one.
+static inline int fpathLowestBit(uint64_t bits)
+{
+#if defined(WZ_CC_GNU) || defined(WZ_CC_CLANG)
+	return __builtin_ctzll(bits);
+#elif defined(WZ_CC_MSVC) && defined(_WIN64)
+	unsigned long index;
+	_BitScanForward64(&index, bits);
+	return index;
+#else
+	int index = 0;
+	for (; (bits & 1) == 0; bits >>= 1)
+	{
+		++index;
+	}
+	return index;
+#endif
+}
+
+/// Index of the highest set bit, of which there must be at least one.
+static inline int fpathHighestBit(uint64_t bits)
+{
+#if defined(WZ_CC_GNU) || defined(WZ_CC_CLANG)
+	return 63 - __builtin_clzll(bits);
+#elif defined(WZ_CC_MSVC) && defined(_WIN64)
+	unsigned long index;
+	_BitScanReverse64(&index, bits);
+	return index;
+#else
+	int index = 63;
+	for (; (bits >> 63) == 0; bits <<= 1)
+	{
+		--index;
+	}
+	return index;
+#endif
+}
+
+/// Bits first to first + 63 of a set of bits which are set from begin to end.
+static inline uint64_t fpathRangeBits(int first, int begin, int end)
+{
+	begin = std::max(begin - first, 0);
+	end = std::min(end - first, 64);
+	if (begin >= end)
+	{
+		return 0;
+	}
+	return (end - begin == 64 ? ~0ull : ((1ull << (end - begin)) - 1)) << begin;
+}
+
+/// One bit per tile, packed into 64-bit words. Each row starts at a new word, and the unused bits at the end of each row are set.
+struct PathBitmap
+{
+	void resize(int width_, int height_)
+	{
+		width = width_;
+		height = height_;
+		stride = (width + 63) / 64;
+		bits.assign(stride * height, 0);
+		if (width % 64 != 0)
+		{
+			for (int y = 0; y < height; ++y)
+			{
+				bits[y * stride + stride - 1] = ~0ull << width % 64;
+			}
+		}
+	}
+	bool empty() const
+	{
+		return bits.empty();
+	}
+	bool get(int x, int y) const
+	{
+		return bits[y * stride + x / 64] >> x % 64 & 1;
+	}
+	void set(int x, int y, bool value)
+	{
+		uint64_t &word = bits[y * stride + x / 64];
+		word = (word & ~(1ull << x % 64)) | (uint64_t)value << x % 64;
+	}
+	/// Returns 64 tiles of row y, with bit i set if tile (x + i, y) is set or off the map.
+	uint64_t row64(int x, int y) const
+	{
+		if (y < 0 || y >= height)
+		{
+			return ~0ull;
+		}
+		int wordIndex = x >= 0 ? x / 64 : -1 - (-1 - x) / 64;
+		int offset = x - wordIndex * 64;
+		uint64_t low = wordIndex >= 0 && wordIndex < stride ? bits[y * stride + wordIndex] : ~0ull;
+		if (offset == 0)
+		{
+			return low;
+		}
+		uint64_t high = wordIndex + 1 >= 0 && wordIndex + 1 < stride ? bits[y * stride + wordIndex + 1] : ~0ull;
+		return low >> offset | high << (64 - offset);
+	}
+	/// Returns the 3x3 tiles around (x, y), with bit (dx + 1) + 3*(dy + 1) set if tile (x + dx, y + dy) is set or off the map.
+	unsigned neighbourhood(int x, int y) const
+	{
+		unsigned result = 0;
+		for (int dy = -1; dy <= 1; ++dy)
+		{
+			unsigned row = 7;
+			if (y + dy >= 0 && y + dy < height)
+			{
+				uint64_t const *line = &bits[(y + dy) * stride];
+				if (x % 64 != 0 && x % 64 != 63)
+				{
+					row = line[x / 64] >> (x % 64 - 1) & 7;  // All three tiles in the same word.
+				}
+				else
+				{
+					row = 0;
+					for (int dx = -1; dx <= 1; ++dx)
+					{
+						row |= (x + dx < 0 || x + dx >= width || (line[(x + dx) / 64] >> (x + dx) % 64 & 1)) << (dx + 1);
+					}
+				}
+			}
+			result |= row << 3 * (dy + 1);
+		}
+		return result;
+	}
+	uint32_t checksum() const
+	{
+		uint32_t checksum = 0;
+		for (uint64_t word : bits)
+		{
+			checksum = checksum * 3 + (uint32_t)(word ^ word >> 32);
+		}
+		return checksum;
+	}
+
+	int width = 0, height = 0;  ///< Size, in tiles.
+	int stride = 0;             ///< Words per row.
+	std::vector<uint64_t> bits;
+};
+
 /// Pathfinding blocking map
 struct PathBlockingMap
 {
@@ -127,8 +333,31 @@ struct PathBlockingMap
 	}
 
 	PathBlockingType type;
-	std::vector<bool> map;
-	std::vector<bool> dangerMap;	// using threatBits
+	PathBitmap map;
+	PathBitmap dangerMap;	// using threatBits
+	PathBitmap transposed;  ///< map, with x and y swapped, only generated for Jump Point Searches.
+	std::shared_ptr<PathHierarchy const> hierarchy;  ///< Region graph of map, only generated for hierarchical searches.
+	uint32_t generation = 0;      ///< Changes whenever map changes, and is never the same for different kinds of map.
+	uint32_t dangerChecksum = 0;  ///< Checksum of dangerMap.
+};
+
+/// Region graph for a kind of blocking map, together with the blocking map it was built from.
+struct PathHierarchyCache
+{
+	PathBlockingType type;
+	PathBitmap map;
+	std::shared_ptr<PathHierarchy const> hierarchy;
+};
+
+/// Latest blocking map of a kind, which is patched with the changed tiles for the next tick instead of being regenerated.
+struct PathBlockingCache
+{
+	PathBlockingType type;
+	PathBitmap map;
+	PathBitmap transposed;                      ///< map, with x and y swapped.
+	uint32_t changedTilesEnd = 0;               ///< Serial number of the first change in auxChangedTiles not yet applied to map.
+	uint32_t generation = 0;                    ///< Generation of map, from fpathBlockingGeneration.
+	int scrollMinX = 0, scrollMinY = 0, scrollMaxX = 0, scrollMaxY = 0;  ///< Scroll limits when map was generated.
 };
 
 struct PathNonblockingArea
@@ -147,6 +376,11 @@ struct PathNonblockingArea
 	{
 		return x >= x1 && x < x2 && y >= y1 && y < y2;
 	}
+	/// Whether any tile within radius tiles of (x, y) is nonblocking.
+	bool overlaps(int x, int y, int radius) const
+	{
+		return x1 < x2 && y1 < y2 && x + radius >= x1 && x - radius < x2 && y + radius >= y1 && y - radius < y2;
+	}
 
 	int16_t x1 = 0;
 	int16_t x2 = 0;
@@ -165,22 +399,44 @@ struct PathfindContext
 			return false;  // The path is actually blocked here by a structure, but ignore it since it's where we want to go (or where we came from).
 		}
 		// Not sure whether the out-of-bounds check is needed, can only happen if pathfinding is started on a blocking tile (or off the map).
-		return x < 0 || y < 0 || x >= mapWidth || y >= mapHeight || blockingMap->map[x + y * mapWidth];
+		if (x < 0 || y < 0 || x >= mapWidth || y >= mapHeight || blockingMap->map.get(x, y))
+		{
+			return true;
+		}
+		// In hierarchical searches, tiles outside the corridor are treated as blocking.
+		return !corridor.empty() && !std::binary_search(corridor.begin(), corridor.end(), blockingMap->hierarchy->regionAt(x, y));
+	}
+	/// Returns the 3x3 tiles around p, with bit (dx + 1) + 3*(dy + 1) set if isBlocked(p.x + dx, p.y + dy).
+	unsigned blockedNeighbourhood(PathCoord p) const
+	{
+		if (corridor.empty() && !dstIgnore.overlaps(p.x, p.y, 1))
+		{
+			return blockingMap->map.neighbourhood(p.x, p.y);  // Common case, just a few word operations.
+		}
+		unsigned result = 0;
+		for (int i = 0; i < 9; ++i)
+		{
+			result |= isBlocked(p.x + i % 3 - 1, p.y + i / 3 - 1) << i;
+		}
+		return result;
 	}
 	bool isDangerous(int x, int y) const
 	{
-		return !blockingMap->dangerMap.empty() && blockingMap->dangerMap[x + y * mapWidth];
+		return !blockingMap->dangerMap.empty() && blockingMap->dangerMap.get(x, y);
 	}
-	bool matches(std::shared_ptr<PathBlockingMap> &blockingMap_, PathCoord tileS_, PathNonblockingArea dstIgnore_) const
+	bool matches(std::shared_ptr<PathBlockingMap> &blockingMap_, PathCoord tileS_, PathNonblockingArea dstIgnore_, std::vector<uint16_t> const &corridor_, bool jumpPoints_) const
 	{
 		// Must check myGameTime == blockingMap_->type.gameTime, otherwise blockingMap could be a deleted pointer which coincidentally compares equal to the valid pointer blockingMap_.
-		return myGameTime == blockingMap_->type.gameTime && blockingMap == blockingMap_ && tileS == tileS_ && dstIgnore == dstIgnore_;
+		return myGameTime == blockingMap_->type.gameTime && blockingMap == blockingMap_ && tileS == tileS_ && dstIgnore == dstIgnore_ && corridor == corridor_ && jumpPoints == jumpPoints_;
 	}
-	void assign(std::shared_ptr<PathBlockingMap> &blockingMap_, PathCoord tileS_, PathNonblockingArea dstIgnore_)
+	void assign(std::shared_ptr<PathBlockingMap> &blockingMap_, PathCoord tileS_, PathCoord tileRealS_, PathNonblockingArea dstIgnore_, std::vector<uint16_t> const &corridor_, bool jumpPoints_)
 	{
 		blockingMap = blockingMap_;
 		tileS = tileS_;
+		tileRealS = tileRealS_;
 		dstIgnore = dstIgnore_;
+		corridor = corridor_;
+		jumpPoints = jumpPoints_;
 		myGameTime = blockingMap->type.gameTime;
 		nodes.clear();
 
@@ -194,6 +450,7 @@ struct PathfindContext
 	}
 
 	PathCoord       tileS;                // Start tile for pathfinding. (May be either source or target tile.)
+	PathCoord       tileRealS;            // Tile the search actually started from, the nearest reachable tile to tileS.
 	uint32_t        myGameTime;
 
 	PathCoord       nearestCoord;         // Nearest reachable tile to destination.
@@ -208,15 +465,49 @@ struct PathfindContext
 	std::vector<PathExploredTile> map;  ///< Map, with paths leading back to tileS.
 	std::shared_ptr<PathBlockingMap> blockingMap; ///< Map of blocking tiles for the type of object which needs a path.
 	PathNonblockingArea dstIgnore;      ///< Area of structure at destination which should be considered nonblocking.
+	std::vector<uint16_t> corridor;     ///< Sorted regions the search is restricted to, or empty if not restricted.
+	bool jumpPoints = false;            ///< Whether to use Jump Point Search, which can't continue a search towards a different tile.
 };
 
-/// Last recently used list of contexts.
-static std::list<PathfindContext> fpathContexts;
+/// Last recently used lists of contexts, one list per path-finding lane.
+/// Each lane is only ever processed by one thread at a time, so the lists need no locking.
+static std::list<PathfindContext> fpathContexts[FPATH_LANES];
 
 /// Lists of blocking maps from current tick.
 static std::vector<std::shared_ptr<PathBlockingMap>> fpathBlockingMaps;
 /// Game time for all blocking maps in fpathBlockingMaps.
 static uint32_t fpathCurrentGameTime;
+/// Region graphs for each kind of blocking map, updated from the main thread whenever a new blocking map is needed.
+static std::vector<PathHierarchyCache> fpathHierarchies;
+/// Latest blocking map of each kind, used as the starting point for the blocking maps of later ticks.
+static std::vector<PathBlockingCache> fpathBlockingCaches;
+/// Last generation number given to a blocking map.
+static uint32_t fpathBlockingGeneration = 0;
+
+/// A route found by a search, which later droids going to the same place may join.
+struct PathRoute
+{
+	uint32_t generation;            ///< Generation of the blocking map the route was found on.
+	uint32_t dangerChecksum;        ///< Checksum of the danger map the route was found on.
+	PathNonblockingArea dstIgnore;  ///< Area of structure at destination which was considered nonblocking.
+	Vector2i dest;                  ///< Requested destination, in world coordinates.
+	ASR_RETVAL retval;              ///< Either ASR_OK or ASR_NEAREST.
+	std::vector<Vector2i> path;     ///< Points of the route, from the start to the end.
+};
+
+/// Maximum number of routes cached per lane.
+#define PATH_ROUTES_PER_LANE 16
+/// Maximum distance in tiles from the start of a search to the point where it may join a cached route.
+#define PATH_ROUTE_JOIN_RANGE 3
+
+/// Last recently used lists of routes, one list per path-finding lane, so routes to the same destination are in the same list.
+static std::list<PathRoute> fpathRoutes[FPATH_LANES];
+
+/// Route cache statistics, updated from the path-finding threads.
+static std::atomic<unsigned> fpathRouteLookups(0);
+static std::atomic<unsigned> fpathRouteHits(0);
+static std::atomic<unsigned> fpathRouteMisses(0);
+static std::atomic<uint64_t> fpathRouteMissNodes(0);  ///< Nodes expanded by the searches done because of cache misses.
 
 // Convert a direction into an offset
 // dir 0 => x = 0, y = -1
@@ -234,8 +525,17 @@ static const Vector2i aDirOffset[] =
 
 void fpathHardTableReset()
 {
-	fpathContexts.clear();
+	for (auto &contexts : fpathContexts)
+	{
+		contexts.clear();
+	}
+	for (auto &routes : fpathRoutes)
+	{
+		routes.clear();
+	}
 	fpathBlockingMaps.clear();
+	fpathHierarchies.clear();
+	fpathBlockingCaches.clear();
 }
 
 /** Get the nearest entry in the open list
@@ -352,9 +652,314 @@ static void fpathAStarReestimate(PathfindContext &context, PathCoord tileF)
 	std::make_heap(context.nodes.begin(), context.nodes.end());
 }
 
+/// Jump Point Search: whether the tiles within 2 tiles of (x, y) all have the same cost and movement rules, so that the search can jump over (x, y).
+static inline bool fpathJumpRegular(PathfindContext const &context, int x, int y)
+{
+	if (context.dstIgnore.overlaps(x, y, 2))
+	{
+		return false;  // Corners can be cut near the destination structure.
+	}
+	PathBitmap const &dangerMap = context.blockingMap->dangerMap;
+	if (!dangerMap.empty())
+	{
+		for (int dy = -2; dy <= 2; ++dy)
+			for (int dx = -2; dx <= 2; ++dx)
+			{
+				if (x + dx >= 0 && y + dy >= 0 && x + dx < mapWidth && y + dy < mapHeight && dangerMap.get(x + dx, y + dy))
+				{
+					return false;  // Dangerous tiles cost more.
+				}
+			}
+	}
+	return true;
+}
+
+/// Jump Point Search: whether it is possible to move one step from (x, y) in direction (dx, dy), which is not allowed to cut corners.
+static inline bool fpathJumpCanMove(PathfindContext const &context, int x, int y, int dx, int dy)
+{
+	return !context.isBlocked(x + dx, y + dy) && (dx == 0 || dy == 0 || (!context.isBlocked(x + dx, y) && !context.isBlocked(x, y + dy)));
+}
+
+/// Jump Point Search: records the way along the straight or diagonal line from `from` to `to`, on the tiles where it is shorter than what was known.
+/// dist is the distance to `from`, and is updated to the distance to `to`. Returns whether `to` still needs exploring from this direction.
+static bool fpathJumpMark(PathfindContext &context, PathCoord from, PathCoord to, unsigned &dist)
+{
+	int dx = (to.x > from.x) - (to.x < from.x), dy = (to.y > from.y) - (to.y < from.y);
+	unsigned stepCost = dx != 0 && dy != 0 ? 198 : 140;
+	bool needed = false;
+	for (PathCoord p = from; p != to;)
+	{
+		p = PathCoord(p.x + dx, p.y + dy);
+		dist += stepCost * (context.isDangerous(p.x, p.y) ? 5 : 1);
+		PathExploredTile &expl = context.map[p.x + p.y * mapWidth];
+		if (expl.iteration == context.iteration && (expl.visited || dist >= expl.dist))
+		{
+			// Equally short from another direction, the tile needs exploring in both directions.
+			needed = !expl.visited && dist == expl.dist;
+			if (needed && (expl.dx != dx * 64 || expl.dy != dy * 64))
+			{
+				expl.expandAll = true;
+			}
+			dist = expl.dist;  // Continue along the known way, so the distances always increase along the way back.
+			continue;
+		}
+		expl.iteration = context.iteration;
+		expl.dx = dx * 64;
+		expl.dy = dy * 64;
+		expl.dist = dist;
+		expl.visited = false;
+		expl.expandAll = false;
+		needed = true;
+	}
+	return needed;
+}
+
+/// Jump Point Search: scans along row y of map from tile (x, y) in direction dx, which is 1 or -1, 64 tiles at a time.
+/// Stops at the goal, in the area irregular, or next to a blocking tile behind which there is a nonblocking tile.
+/// Returns the number of tiles it was possible to step, and sets found if the last of them is where it stopped.
+static int fpathJumpScanRow(PathBitmap const &map, int x, int y, int dx, PathCoord goal, PathNonblockingArea const &irregular, bool &found)
+{
+	for (int steps = 0;; steps += 64)
+	{
+		int first = x + dx * (steps + 1);         // Tile which is stepped to first in this chunk.
+		int base = dx > 0 ? first : first - 63;   // Tile of bit 0.
+		int behind = base - dx;                   // Tile of bit 0, for the tiles one step behind.
+		uint64_t blocked = map.row64(base, y);
+		uint64_t interesting = (~map.row64(base, y - 1) & map.row64(behind, y - 1)) | (~map.row64(base, y + 1) & map.row64(behind, y + 1));
+		if (goal.y == y)
+		{
+			interesting |= fpathRangeBits(base, goal.x, goal.x + 1);
+		}
+		if (y >= irregular.y1 && y < irregular.y2)
+		{
+			interesting |= fpathRangeBits(base, irregular.x1, irregular.x2);
+		}
+
+		// Count the steps in scan order, which is from bit 63 down when going backwards.
+		int free = blocked == 0 ? 64 : dx > 0 ? fpathLowestBit(blocked) : 63 - fpathHighestBit(blocked);
+		int stop = interesting == 0 ? 64 : dx > 0 ? fpathLowestBit(interesting) : 63 - fpathHighestBit(interesting);
+		if (stop < free)
+		{
+			found = true;
+			return steps + stop + 1;
+		}
+		if (free < 64)
+		{
+			found = false;
+			return steps + free;
+		}
+	}
+}
+
+/// State of a Jump Point Search exploration.
+struct PathJumpSearch
+{
+	PathJumpSearch(PathfindContext &context_, PathCoord tileF_) : context(context_), tileF(tileF_)
+	{
+		// Straight lines can be scanned a word at a time, as long as there is nothing dangerous anywhere.
+		scanWords = context.blockingMap->dangerMap.empty() && !context.blockingMap->transposed.empty() && context.corridor.empty();
+		PathNonblockingArea const &area = context.dstIgnore;
+		if (area.x1 < area.x2 && area.y1 < area.y2)
+		{
+			// Tiles within 2 tiles of the destination structure are irregular, see fpathJumpRegular.
+			irregular.x1 = area.x1 - 2;
+			irregular.x2 = area.x2 + 2;
+			irregular.y1 = area.y1 - 2;
+			irregular.y2 = area.y2 + 2;
+		}
+		irregularTransposed.x1 = irregular.y1;
+		irregularTransposed.x2 = irregular.y2;
+		irregularTransposed.y1 = irregular.x1;
+		irregularTransposed.y2 = irregular.x2;
+	}
+
+	/// Remembers the tile if it is the nearest to tileF so far, which is reached from node, possibly via corner.
+	void considerNearest(PathCoord tile, PathNode const &node, PathCoord corner)
+	{
+		int distSq = (tile.x - tileF.x) * (tile.x - tileF.x) + (tile.y - tileF.y) * (tile.y - tileF.y);
+		if (distSq < nearestDistSq)
+		{
+			// Record the way there, so the route can be found even if tileF turns out to be unreachable.
+			unsigned dist = node.dist;
+			fpathJumpMark(context, node.p, corner, dist);
+			fpathJumpMark(context, corner, tile, dist);
+			nearestCoord = tile;
+			nearestDistSq = distSq;
+		}
+	}
+
+	/// Steps from corner in the straight direction (dx, dy) until finding a tile which must be expanded, if any. Corner is reached from node.
+	bool jumpStraight(PathNode const &node, PathCoord corner, int dx, int dy, PathCoord &found)
+	{
+		if (scanWords)
+		{
+			bool stopped;
+			int steps = dx != 0 ? fpathJumpScanRow(context.blockingMap->map, corner.x, corner.y, dx, tileF, irregular, stopped)
+			                    : fpathJumpScanRow(context.blockingMap->transposed, corner.y, corner.x, dy, PathCoord(tileF.y, tileF.x), irregularTransposed, stopped);
+			if (steps > 0)
+			{
+				// Consider the tile on the line nearest to tileF.
+				PathCoord last(corner.x + dx * steps, corner.y + dy * steps);
+				considerNearest(PathCoord(clip(tileF.x, std::min<int>(corner.x + dx, last.x), std::max<int>(corner.x + dx, last.x)),
+				                          clip(tileF.y, std::min<int>(corner.y + dy, last.y), std::max<int>(corner.y + dy, last.y))), node, corner);
+				found = last;
+			}
+			return stopped;
+		}
+
+		int x = corner.x, y = corner.y;
+		while (fpathJumpCanMove(context, x, y, dx, dy))
+		{
+			x += dx;
+			y += dy;
+			found = PathCoord(x, y);
+			considerNearest(found, node, corner);
+			if (found == tileF || !fpathJumpRegular(context, x, y))
+			{
+				return true;
+			}
+			// Check for neighbours which can't be reached as cheaply except via (x, y), since the tile behind them is blocked.
+			if (dx != 0 && ((!context.isBlocked(x, y - 1) && context.isBlocked(x - dx, y - 1)) || (!context.isBlocked(x, y + 1) && context.isBlocked(x - dx, y + 1))))
+			{
+				return true;
+			}
+			if (dy != 0 && ((!context.isBlocked(x - 1, y) && context.isBlocked(x - 1, y - dy)) || (!context.isBlocked(x + 1, y) && context.isBlocked(x + 1, y - dy))))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/// Steps from node in direction (dx, dy) until finding a tile which must be expanded, and adds it to the open list.
+	void jump(PathNode const &node, int dx, int dy)
+	{
+		PathCoord found;
+		if (dx == 0 || dy == 0)
+		{
+			if (jumpStraight(node, node.p, dx, dy, found))
+			{
+				addNode(node, found);
+			}
+			return;
+		}
+		// Moving diagonally, (x, y) must be expanded if there is anything of interest along the straight lines from it.
+		int x = node.p.x, y = node.p.y;
+		while (fpathJumpCanMove(context, x, y, dx, dy))
+		{
+			x += dx;
+			y += dy;
+			PathCoord p(x, y);
+			considerNearest(p, node, p);
+			if (p == tileF || !fpathJumpRegular(context, x, y) || jumpStraight(node, p, dx, 0, found) || jumpStraight(node, p, 0, dy, found))
+			{
+				addNode(node, p);
+				return;
+			}
+		}
+	}
+
+	/// Adds p to the open list, if the straight or diagonal line from node is the shortest known way there.
+	void addNode(PathNode const &node, PathCoord p)
+	{
+		unsigned dist = node.dist;
+		if (fpathJumpMark(context, node.p, p, dist))
+		{
+			PathNode newNode;
+			newNode.p = p;
+			newNode.dist = dist;
+			newNode.est = dist + fpathGoodEstimate(p, tileF);
+			context.nodes.push_back(newNode);
+			std::push_heap(context.nodes.begin(), context.nodes.end());
+		}
+	}
+
+	PathfindContext &context;
+	PathCoord tileF;
+	PathCoord nearestCoord = PathCoord(0, 0);
+	int nearestDistSq = INT32_MAX;
+	bool scanWords;                          ///< Whether straight lines can be scanned a word at a time.
+	PathNonblockingArea irregular;           ///< Tiles near the destination structure.
+	PathNonblockingArea irregularTransposed; ///< irregular, with x and y swapped.
+};
+
+/// Jump Point Search version of fpathAStarExplore.
+static PathCoord fpathJumpExplore(PathfindContext &context, PathCoord tileF, unsigned &nodesExpanded)
+{
+	PathJumpSearch search(context, tileF);
+
+	while (!context.nodes.empty())
+	{
+		PathNode node = fpathTakeNode(context.nodes);
+		PathExploredTile &expl = context.map[node.p.x + node.p.y * mapWidth];
+		if (expl.visited)
+		{
+			continue;  // Already been here.
+		}
+		expl.visited = true;
+		++nodesExpanded;
+		bool jumpedOver = node.dist != expl.dist;  // Found to be on a shorter way while jumping over it.
+		node.dist = expl.dist;
+
+		search.considerNearest(node.p, node, node.p);
+		if (node.p == tileF)
+		{
+			break;  // Reached the target. Unlike the classic search, the exploration can't be continued for other targets later, so stop now.
+		}
+
+		int dx = (expl.dx > 0) - (expl.dx < 0), dy = (expl.dy > 0) - (expl.dy < 0);
+		if ((dx == 0 && dy == 0) || jumpedOver || expl.expandAll || !fpathJumpRegular(context, node.p.x, node.p.y))
+		{
+			// The start tile, a tile reached from several directions, or a tile with irregular surroundings. Try all directions, like the classic search.
+			unsigned blocked = context.blockedNeighbourhood(node.p);
+			auto isBlocked = [blocked](Vector2i const &offset) {
+				return (blocked >> ((offset.x + 1) + 3 * (offset.y + 1)) & 1) != 0;
+			};
+			for (unsigned dir = 0; dir < ARRAY_SIZE(aDirOffset); ++dir)
+			{
+				PathCoord p(node.p.x + aDirOffset[dir].x, node.p.y + aDirOffset[dir].y);
+				if (isBlocked(aDirOffset[dir]))
+				{
+					continue;
+				}
+				if (dir % 2 != 0 && !context.dstIgnore.isNonblocking(node.p.x, node.p.y) && !context.dstIgnore.isNonblocking(p.x, p.y)
+				    && (isBlocked(aDirOffset[(dir + 1) % 8]) || isBlocked(aDirOffset[(dir + 7) % 8])))
+				{
+					continue;  // We cannot cut corners
+				}
+				search.addNode(node, p);
+			}
+			continue;
+		}
+
+		// Only try the directions which can't be reached as cheaply without going via this tile.
+		if (dx != 0 && dy != 0)
+		{
+			search.jump(node, dx, 0);
+			search.jump(node, 0, dy);
+			search.jump(node, dx, dy);
+		}
+		else
+		{
+			search.jump(node, dx, dy);
+			search.jump(node, dx + dy, dy + dx);  // Diagonally forwards, to one side.
+			search.jump(node, dx - dy, dy - dx);  // Diagonally forwards, to the other side.
+			search.jump(node, dy, dx);            // Sideways, to one side.
+			search.jump(node, -dy, -dx);          // Sideways, to the other side.
+		}
+	}
+
+	return search.nearestCoord;
+}
+
 /// Returns nearest explored tile to tileF.
-static PathCoord fpathAStarExplore(PathfindContext &context, PathCoord tileF)
+static PathCoord fpathAStarExplore(PathfindContext &context, PathCoord tileF, unsigned &nodesExpanded)
 {
+	if (context.jumpPoints)
+	{
+		return fpathJumpExplore(context, tileF, nodesExpanded);
+	}
+
 	PathCoord       nearestCoord(0, 0);
 	unsigned        nearestDist = 0xFFFFFFFF;
 
@@ -368,6 +973,7 @@ static PathCoord fpathAStarExplore(PathfindContext &context, PathCoord tileF)
 			continue;  // Already been here.
 		}
 		context.map[node.p.x + node.p.y * mapWidth].visited = true;
+		++nodesExpanded;
 
 		// note the nearest node to the target so far
 		if (node.est - node.dist < nearestDist)
@@ -383,6 +989,12 @@ static PathCoord fpathAStarExplore(PathfindContext &context, PathCoord tileF)
 			foundIt = true;  // Break out of loop, but not before inserting neighbour nodes, since the neighbours may be important if the context gets reused.
 		}
 
+		// Look up all the neighbours at once.
+		unsigned blocked = context.blockedNeighbourhood(node.p);
+		auto isBlocked = [blocked](Vector2i const &offset) {
+			return (blocked >> ((offset.x + 1) + 3 * (offset.y + 1)) & 1) != 0;
+		};
+
 		// loop through possible moves in 8 directions to find a valid move
 		for (unsigned dir = 0; dir < ARRAY_SIZE(aDirOffset); ++dir)
 		{
@@ -400,25 +1012,15 @@ static PathCoord fpathAStarExplore(PathfindContext &context, PathCoord tileF)
 			*/
 			if (dir % 2 != 0 && !context.dstIgnore.isNonblocking(node.p.x, node.p.y) && !context.dstIgnore.isNonblocking(x, y))
 			{
-				int x, y;
-
 				// We cannot cut corners
-				x = node.p.x + aDirOffset[(dir + 1) % 8].x;
-				y = node.p.y + aDirOffset[(dir + 1) % 8].y;
-				if (context.isBlocked(x, y))
-				{
-					continue;
-				}
-				x = node.p.x + aDirOffset[(dir + 7) % 8].x;
-				y = node.p.y + aDirOffset[(dir + 7) % 8].y;
-				if (context.isBlocked(x, y))
+				if (isBlocked(aDirOffset[(dir + 1) % 8]) || isBlocked(aDirOffset[(dir + 7) % 8]))
 				{
 					continue;
 				}
 			}
 
 			// See if the node is a blocking tile
-			if (context.isBlocked(x, y))
+			if (isBlocked(aDirOffset[dir]))
 			{
 				// tile is blocked, skip it
 				continue;
@@ -432,16 +1034,280 @@ static PathCoord fpathAStarExplore(PathfindContext &context, PathCoord tileF)
 	return nearestCoord;
 }
 
-static void fpathInitContext(PathfindContext &context, std::shared_ptr<PathBlockingMap> &blockingMap, PathCoord tileS, PathCoord tileRealS, PathCoord tileF, PathNonblockingArea dstIgnore)
+/// Finds the regions of a cluster by flood filling the nonblocking tiles, without the links to other clusters.
+static std::shared_ptr<PathCluster> fpathBuildCluster(PathBitmap const &map, int clusterX, int clusterY)
+{
+	std::shared_ptr<PathCluster> cluster = std::make_shared<PathCluster>();
+	int x0 = clusterX * PATH_CLUSTER_SIZE, y0 = clusterY * PATH_CLUSTER_SIZE;
+	std::fill(std::begin(cluster->tileRegion), std::end(cluster->tileRegion), 0);
+
+	std::vector<PathCoord> stack, tiles;
+	for (int y = 0; y < PATH_CLUSTER_SIZE; ++y)
+		for (int x = 0; x < PATH_CLUSTER_SIZE; ++x)
+		{
+			if (x0 + x >= mapWidth || y0 + y >= mapHeight || map.get(x0 + x, y0 + y) || cluster->tileRegion[x + y * PATH_CLUSTER_SIZE] != 0)
+			{
+				continue;
+			}
+
+			// Found a tile not in any region yet, so flood fill a new region from it. Only orthogonal steps, since we cannot cut corners.
+			uint8_t local = cluster->regions.size() + 1;
+			cluster->tileRegion[x + y * PATH_CLUSTER_SIZE] = local;
+			stack.assign(1, PathCoord(x, y));
+			tiles.clear();
+			Vector2i sum(0, 0);
+			while (!stack.empty())
+			{
+				PathCoord p = stack.back();
+				stack.pop_back();
+				tiles.push_back(p);
+				sum += Vector2i(p.x, p.y);
+				for (unsigned dir = 0; dir < ARRAY_SIZE(aDirOffset); dir += 2)
+				{
+					int nx = p.x + aDirOffset[dir].x, ny = p.y + aDirOffset[dir].y;
+					if (nx < 0 || ny < 0 || nx >= PATH_CLUSTER_SIZE || ny >= PATH_CLUSTER_SIZE || x0 + nx >= mapWidth || y0 + ny >= mapHeight
+					    || map.get(x0 + nx, y0 + ny) || cluster->tileRegion[nx + ny * PATH_CLUSTER_SIZE] != 0)
+					{
+						continue;
+					}
+					cluster->tileRegion[nx + ny * PATH_CLUSTER_SIZE] = local;
+					stack.push_back(PathCoord(nx, ny));
+				}
+			}
+
+			// Use the tile closest to the centre of the region as its representative.
+			Vector2i centre = sum / (int)tiles.size();
+			PathCoord best = tiles.front();
+			int bestDistSq = INT32_MAX;
+			for (PathCoord const &p : tiles)
+			{
+				Vector2i diff = Vector2i(p.x, p.y) - centre;
+				int distSq = diff * diff;
+				if (distSq < bestDistSq || (distSq == bestDistSq && (p.y < best.y || (p.y == best.y && p.x < best.x))))
+				{
+					best = p;
+					bestDistSq = distSq;
+				}
+			}
+			PathRegion region;
+			region.centre = PathCoord(x0 + best.x, y0 + best.y);
+			cluster->regions.push_back(region);
+		}
+	return cluster;
+}
+
+/// Links the regions of a cluster to the regions of the neighbouring clusters in hierarchy, which must already have their tiles assigned.
+static void fpathLinkCluster(PathHierarchy const &hierarchy, PathCluster &cluster, int clusterX, int clusterY)
 {
-	context.assign(blockingMap, tileS, dstIgnore);
+	int x0 = clusterX * PATH_CLUSTER_SIZE, y0 = clusterY * PATH_CLUSTER_SIZE;
+	for (PathRegion &region : cluster.regions)
+	{
+		region.neighbours.clear();
+	}
+	for (int i = 0; i < PATH_CLUSTER_SIZE; ++i)
+	{
+		// Tiles along the left, right, top and bottom edges of the cluster, and the tile across the edge.
+		PathCoord const edge[4][2] =
+		{
+			{PathCoord(x0, y0 + i), PathCoord(x0 - 1, y0 + i)},
+			{PathCoord(x0 + PATH_CLUSTER_SIZE - 1, y0 + i), PathCoord(x0 + PATH_CLUSTER_SIZE, y0 + i)},
+			{PathCoord(x0 + i, y0), PathCoord(x0 + i, y0 - 1)},
+			{PathCoord(x0 + i, y0 + PATH_CLUSTER_SIZE - 1), PathCoord(x0 + i, y0 + PATH_CLUSTER_SIZE)},
+		};
+		for (auto const &e : edge)
+		{
+			if (e[0].x >= mapWidth || e[0].y >= mapHeight)
+			{
+				continue;
+			}
+			unsigned local = cluster.tileRegion[e[0].x - x0 + (e[0].y - y0) * PATH_CLUSTER_SIZE];
+			uint16_t other = hierarchy.regionAt(e[1].x, e[1].y);
+			if (local != 0 && other != 0)
+			{
+				cluster.regions[local - 1].neighbours.push_back(other);
+			}
+		}
+	}
+	for (PathRegion &region : cluster.regions)
+	{
+		std::sort(region.neighbours.begin(), region.neighbours.end());
+		region.neighbours.erase(std::unique(region.neighbours.begin(), region.neighbours.end()), region.neighbours.end());
+	}
+}
+
+/// Call from main thread.
+/// Returns the region graph of blockMap, rebuilding only the clusters where the blocking tiles changed since the last blocking map of the same kind.
+static std::shared_ptr<PathHierarchy const> fpathUpdateHierarchy(PathBlockingMap const &blockMap)
+{
+	auto cache = std::find_if(fpathHierarchies.begin(), fpathHierarchies.end(), [&](PathHierarchyCache const &c) {
+		return fpathIsEquivalentBlocking(c.type.propulsion, c.type.owner, c.type.moveType,
+		                                 blockMap.type.propulsion, blockMap.type.owner, blockMap.type.moveType);
+	});
+	if (cache == fpathHierarchies.end())
+	{
+		fpathHierarchies.push_back(PathHierarchyCache());
+		cache = fpathHierarchies.end() - 1;
+		cache->type = blockMap.type;
+	}
+
+	int width = (mapWidth + PATH_CLUSTER_SIZE - 1) / PATH_CLUSTER_SIZE;
+	int height = (mapHeight + PATH_CLUSTER_SIZE - 1) / PATH_CLUSTER_SIZE;
+	bool rebuildAll = !cache->hierarchy || cache->hierarchy->width != width || cache->hierarchy->height != height || cache->map.bits.size() != blockMap.map.bits.size();
+
+	// Find the clusters where any tile changed, comparing a word at a time.
+	std::vector<bool> changed(width * height, rebuildAll);
+	if (!rebuildAll)
+	{
+		for (size_t i = 0; i < blockMap.map.bits.size(); ++i)
+		{
+			uint64_t diff = cache->map.bits[i] ^ blockMap.map.bits[i];
+			int y = i / blockMap.map.stride;
+			for (int x = i % blockMap.map.stride * 64; diff != 0; diff >>= 1, ++x)
+			{
+				if ((diff & 1) != 0 && x < mapWidth)
+				{
+					changed[x / PATH_CLUSTER_SIZE + y / PATH_CLUSTER_SIZE * width] = true;
+				}
+			}
+		}
+	}
+	if (std::find(changed.begin(), changed.end(), true) == changed.end())
+	{
+		return cache->hierarchy;  // Nothing changed, keep using the same graph.
+	}
+
+	// Copy the graph, since other threads may still be using the old one, and rebuild the changed clusters.
+	std::shared_ptr<PathHierarchy> hierarchy = rebuildAll ? std::make_shared<PathHierarchy>() : std::make_shared<PathHierarchy>(*cache->hierarchy);
+	hierarchy->width = width;
+	hierarchy->height = height;
+	hierarchy->clusters.resize(width * height);
+	std::vector<std::shared_ptr<PathCluster>> rebuilt(width * height);
+	for (int i = 0; i < width * height; ++i)
+	{
+		if (changed[i])
+		{
+			rebuilt[i] = fpathBuildCluster(blockMap.map, i % width, i / width);
+		}
+	}
+	// The links of the neighbours of changed clusters also need updating.
+	for (int i = 0; i < width * height; ++i)
+	{
+		int x = i % width, y = i / width;
+		bool neighbourChanged = (x > 0 && changed[i - 1]) || (x + 1 < width && changed[i + 1]) || (y > 0 && changed[i - width]) || (y + 1 < height && changed[i + width]);
+		if (!rebuilt[i] && neighbourChanged)
+		{
+			rebuilt[i] = std::make_shared<PathCluster>(*hierarchy->clusters[i]);
+		}
+		if (rebuilt[i])
+		{
+			hierarchy->clusters[i] = rebuilt[i];
+		}
+	}
+	for (int i = 0; i < width * height; ++i)
+	{
+		if (rebuilt[i])
+		{
+			fpathLinkCluster(*hierarchy, *rebuilt[i], i % width, i / width);
+		}
+	}
+
+	cache->map = blockMap.map;
+	cache->hierarchy = hierarchy;
+	return cache->hierarchy;
+}
+
+/// A* over the region graph. Returns the sorted list of regions on the way from tileS to tileF, or an empty list if there is no way.
+static std::vector<uint16_t> fpathHierarchyCorridor(PathHierarchy const &hierarchy, PathCoord tileS, PathCoord tileF, unsigned &nodesExpanded)
+{
+	struct RegionNode
+	{
+		bool operator <(RegionNode const &z) const
+		{
+			// Same ordering as PathNode, for a deterministic search.
+			if (est != z.est)
+			{
+				return est > z.est;
+			}
+			if (dist != z.dist)
+			{
+				return dist < z.dist;
+			}
+			return region < z.region;
+		}
+
+		unsigned dist, est;
+		uint16_t region;
+	};
+	struct RegionExplored
+	{
+		unsigned dist;
+		uint16_t prev;
+		bool visited;
+	};
+
+	std::vector<uint16_t> corridor;
+	uint16_t regionS = hierarchy.regionAt(tileS.x, tileS.y);
+	uint16_t regionF = hierarchy.regionAt(tileF.x, tileF.y);
+	if (regionS == 0 || regionF == 0)
+	{
+		return corridor;  // Starting or ending on a blocking tile, probably a structure at the destination.
+	}
+
+	std::unordered_map<uint16_t, RegionExplored> explored;
+	std::vector<RegionNode> nodes;
+	explored[regionS] = RegionExplored{0, 0, false};
+	nodes.push_back(RegionNode{0, fpathGoodEstimate(hierarchy.region(regionS).centre, tileF), regionS});
+	while (!nodes.empty())
+	{
+		std::pop_heap(nodes.begin(), nodes.end());
+		RegionNode node = nodes.back();
+		nodes.pop_back();
+		RegionExplored &nodeExpl = explored[node.region];
+		if (nodeExpl.visited)
+		{
+			continue;
+		}
+		nodeExpl.visited = true;
+		++nodesExpanded;
+
+		if (node.region == regionF)
+		{
+			for (uint16_t region = regionF; region != 0; region = explored[region].prev)
+			{
+				corridor.push_back(region);
+			}
+			std::sort(corridor.begin(), corridor.end());
+			return corridor;
+		}
+
+		PathRegion const &region = hierarchy.region(node.region);
+		for (uint16_t neighbour : region.neighbours)
+		{
+			PathCoord centre = hierarchy.region(neighbour).centre;
+			unsigned dist = node.dist + fpathGoodEstimate(region.centre, centre);
+			auto i = explored.find(neighbour);
+			if (i != explored.end() && (i->second.visited || i->second.dist <= dist))
+			{
+				continue;
+			}
+			explored[neighbour] = RegionExplored{dist, node.region, false};
+			nodes.push_back(RegionNode{dist, dist + fpathGoodEstimate(centre, tileF), neighbour});
+			std::push_heap(nodes.begin(), nodes.end());
+		}
+	}
+	return corridor;  // Not reachable.
+}
+
+static void fpathInitContext(PathfindContext &context, std::shared_ptr<PathBlockingMap> &blockingMap, PathCoord tileS, PathCoord tileRealS, PathCoord tileF, PathNonblockingArea dstIgnore, std::vector<uint16_t> const &corridor, bool jumpPoints)
+{
+	context.assign(blockingMap, tileS, tileRealS, dstIgnore, corridor, jumpPoints);
 
 	// Add the start point to the open list
 	fpathNewNode(context, tileF, tileRealS, 0, tileRealS);
 	ASSERT(!context.nodes.empty(), "fpathNewNode failed to add node.");
 }
 
-ASR_RETVAL fpathAStarRoute(MOVE_CONTROL *psMove, PATHJOB *psJob)
+static ASR_RETVAL fpathAStarRoute(std::list<PathfindContext> &fpathContexts, MOVE_CONTROL *psMove, PATHJOB *psJob, unsigned &nodesExpanded)
 {
 	ASR_RETVAL      retval = ASR_OK;
 
@@ -451,12 +1317,20 @@ ASR_RETVAL fpathAStarRoute(MOVE_CONTROL *psMove, PATHJOB *psJob)
 	const PathCoord tileDest(map_coord(psJob->destX), map_coord(psJob->destY));
 	const PathNonblockingArea dstIgnore(psJob->dstStructure);
 
+	// In hierarchical mode, only search the regions on the way. If there is no way, search everything to find the nearest reachable tile.
+	std::vector<uint16_t> corridor;
+	if (psJob->searchMode == FSM_HIERARCHICAL && psJob->blockingMap->hierarchy)
+	{
+		corridor = fpathHierarchyCorridor(*psJob->blockingMap->hierarchy, tileOrig, tileDest, nodesExpanded);
+	}
+	bool jumpPoints = psJob->searchMode == FSM_JPS;
+
 	PathCoord endCoord;  // Either nearest coord (mustReverse = true) or orig (mustReverse = false).
 
 	std::list<PathfindContext>::iterator contextIterator = fpathContexts.begin();
 	for (contextIterator = fpathContexts.begin(); contextIterator != fpathContexts.end(); ++contextIterator)
 	{
-		if (!contextIterator->matches(psJob->blockingMap, tileDest, dstIgnore))
+		if (!contextIterator->matches(psJob->blockingMap, tileDest, dstIgnore, corridor, jumpPoints))
 		{
 			// This context is not for the same droid type and same destination.
 			continue;
@@ -470,11 +1344,17 @@ ASR_RETVAL fpathAStarRoute(MOVE_CONTROL *psMove, PATHJOB *psJob)
 			// Already know the path from orig to dest.
 			endCoord = tileOrig;
 		}
+		else if (jumpPoints)
+		{
+			// Jump Point Search skips over tiles which did not matter for the previous exploration, so start it again.
+			fpathInitContext(*contextIterator, psJob->blockingMap, contextIterator->tileS, contextIterator->tileRealS, tileOrig, dstIgnore, corridor, jumpPoints);
+			endCoord = fpathAStarExplore(*contextIterator, tileOrig, nodesExpanded);
+		}
 		else
 		{
 			// Need to find the path from orig to dest, continue previous exploration.
 			fpathAStarReestimate(*contextIterator, tileOrig);
-			endCoord = fpathAStarExplore(*contextIterator, tileOrig);
+			endCoord = fpathAStarExplore(*contextIterator, tileOrig, nodesExpanded);
 		}
 
 		if (endCoord != tileOrig)
@@ -499,8 +1379,8 @@ ASR_RETVAL fpathAStarRoute(MOVE_CONTROL *psMove, PATHJOB *psJob)
 
 		// Init a new context, overwriting the oldest one if we are caching too many.
 		// We will be searching from orig to dest, since we don't know where the nearest reachable tile to dest is.
-		fpathInitContext(*contextIterator, psJob->blockingMap, tileOrig, tileOrig, tileDest, dstIgnore);
-		endCoord = fpathAStarExplore(*contextIterator, tileDest);
+		fpathInitContext(*contextIterator, psJob->blockingMap, tileOrig, tileOrig, tileDest, dstIgnore, corridor, jumpPoints);
+		endCoord = fpathAStarExplore(*contextIterator, tileDest, nodesExpanded);
 		contextIterator->nearestCoord = endCoord;
 	}
 
@@ -513,8 +1393,7 @@ ASR_RETVAL fpathAStarRoute(MOVE_CONTROL *psMove, PATHJOB *psJob)
 	}
 
 	// Get route, in reverse order.
-	static std::vector<Vector2i> path;  // Declared static to save allocations.
-	path.clear();
+	std::vector<Vector2i> path;  // Not static, since several lanes may be routing at the same time.
 
 	Vector2i newP;
 	for (Vector2i p(world_coord(endCoord.x) + TILE_UNITS / 2, world_coord(endCoord.y) + TILE_UNITS / 2); true; p = newP)
@@ -564,7 +1443,7 @@ ASR_RETVAL fpathAStarRoute(MOVE_CONTROL *psMove, PATHJOB *psJob)
 	ASSERT(psMove->asPath, "Out of memory");
 	if (!psMove->asPath)
 	{
-		fpathHardTableReset();
+		fpathContexts.clear();  // Only clear our own lane, the other lanes may be in use by other threads.
 		return ASR_FAILED;
 	}
 
@@ -587,7 +1466,7 @@ ASR_RETVAL fpathAStarRoute(MOVE_CONTROL *psMove, PATHJOB *psJob)
 		if (!context.isBlocked(tileOrig.x, tileOrig.y))  // If blocked, searching from tileDest to tileOrig wouldn't find the tileOrig tile.
 		{
 			// Next time, search starting from nearest reachable tile to the destination.
-			fpathInitContext(context, psJob->blockingMap, tileDest, context.nearestCoord, tileOrig, dstIgnore);
+			fpathInitContext(context, psJob->blockingMap, tileDest, context.nearestCoord, tileOrig, dstIgnore, corridor, jumpPoints);
 		}
 	}
 	else
@@ -607,6 +1486,236 @@ ASR_RETVAL fpathAStarRoute(MOVE_CONTROL *psMove, PATHJOB *psJob)
 	return retval;
 }
 
+/// Whether a droid can walk in a straight line between the two tiles, without crossing blocking tiles or squeezing diagonally between them.
+static bool fpathRouteLineClear(PathBlockingMap const &blockingMap, PathNonblockingArea const &dstIgnore, PathCoord from, PathCoord to)
+{
+	auto isBlocked = [&](int x, int y) {
+		return blockingMap.map.get(x, y) && !dstIgnore.isNonblocking(x, y);
+	};
+
+	int dx = abs(to.x - from.x), dy = abs(to.y - from.y);
+	int sx = to.x > from.x ? 1 : -1, sy = to.y > from.y ? 1 : -1;
+	int x = from.x, y = from.y;
+	if (isBlocked(x, y))
+	{
+		return false;
+	}
+	// Step one tile horizontally or vertically at a time, towards whichever side the line leaves the current tile through.
+	for (int ix = 0, iy = 0; ix < dx || iy < dy;)
+	{
+		if ((1 + 2 * ix) * dy < (1 + 2 * iy) * dx)
+		{
+			x += sx;
+			++ix;
+		}
+		else
+		{
+			y += sy;
+			++iy;
+		}
+		if (isBlocked(x, y))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/// Looks for a cached route towards the same destination which passes near the start of psJob, and copies the part from where the droid can join it.
+/// Returns false if there is no such route.
+static bool fpathRouteJoin(std::list<PathRoute> &routes, MOVE_CONTROL *psMove, PATHJOB *psJob, ASR_RETVAL &retval)
+{
+	PathBlockingMap const &blockingMap = *psJob->blockingMap;
+	const PathCoord tileOrig(map_coord(psJob->origX), map_coord(psJob->origY));
+	const PathNonblockingArea dstIgnore(psJob->dstStructure);
+	const Vector2i dest(psJob->destX, psJob->destY);
+
+	for (auto route = routes.begin(); route != routes.end(); ++route)
+	{
+		if (route->generation != blockingMap.generation || route->dangerChecksum != blockingMap.dangerChecksum || route->dstIgnore != dstIgnore || route->dest != dest)
+		{
+			continue;
+		}
+
+		// Join as far along the route as possible, to not walk back along it.
+		for (size_t n = route->path.size(); n-- > 0;)
+		{
+			const PathCoord tileJoin(map_coord(route->path[n].x), map_coord(route->path[n].y));
+			if (abs(tileJoin.x - tileOrig.x) > PATH_ROUTE_JOIN_RANGE || abs(tileJoin.y - tileOrig.y) > PATH_ROUTE_JOIN_RANGE
+			    || !fpathRouteLineClear(blockingMap, dstIgnore, tileOrig, tileJoin))
+			{
+				continue;
+			}
+
+			size_t numPoints = route->path.size() - n;
+			psMove->asPath = static_cast<Vector2i *>(malloc(sizeof(*psMove->asPath) * numPoints));
+			ASSERT_OR_RETURN(false, psMove->asPath, "Out of memory");
+			std::copy(route->path.begin() + n, route->path.end(), psMove->asPath);
+			psMove->numPoints = numPoints;
+			psMove->destination = psMove->asPath[numPoints - 1];
+			retval = route->retval;
+
+			// Move route to beginning of last recently used list.
+			if (route != routes.begin())
+			{
+				routes.splice(routes.begin(), routes, route);
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+ASR_RETVAL fpathAStarRoute(unsigned lane, MOVE_CONTROL *psMove, PATHJOB *psJob)
+{
+	ASSERT_OR_RETURN(ASR_FAILED, lane < FPATH_LANES, "Bad path-finding lane %u", lane);
+
+	// Routes are cached per lane and the jobs of a lane are routed in order, so whether a job joins a cached route is the same on all clients.
+	// Joining routes gives different paths than searching each one, so the classic mode keeps searching every route.
+	std::list<PathRoute> &routes = fpathRoutes[lane];
+	const bool joinRoutes = psJob->searchMode != FSM_CLASSIC;
+	ASR_RETVAL retval;
+	if (joinRoutes)
+	{
+		++fpathRouteLookups;
+		if (fpathRouteJoin(routes, psMove, psJob, retval))
+		{
+			++fpathRouteHits;
+			return retval;
+		}
+	}
+
+	unsigned nodesExpanded = 0;
+	retval = fpathAStarRoute(fpathContexts[lane], psMove, psJob, nodesExpanded);
+	++fpathRouteMisses;
+	fpathRouteMissNodes += nodesExpanded;
+
+	if (joinRoutes && retval != ASR_FAILED && psMove->numPoints > 0)
+	{
+		if (routes.size() >= PATH_ROUTES_PER_LANE)
+		{
+			routes.pop_back();
+		}
+		PathRoute route;
+		route.generation = psJob->blockingMap->generation;
+		route.dangerChecksum = psJob->blockingMap->dangerChecksum;
+		route.dstIgnore = PathNonblockingArea(psJob->dstStructure);
+		route.dest = Vector2i(psJob->destX, psJob->destY);
+		route.retval = retval;
+		route.path.assign(psMove->asPath, psMove->asPath + psMove->numPoints);
+		routes.push_front(std::move(route));
+	}
+	return retval;
+}
+
+ASR_ROUTE_CACHE_STATISTICS fpathAStarRouteCacheStatistics()
+{
+	ASR_ROUTE_CACHE_STATISTICS stats;
+	stats.lookups = fpathRouteLookups;
+	stats.hits = fpathRouteHits;
+	unsigned misses = fpathRouteMisses;
+	stats.avgNodesPerSearch = misses != 0 ? fpathRouteMissNodes / misses : 0;
+	return stats;
+}
+
+/// Call from main thread.
+/// Returns the latest blocking map of the same kind as type, brought up to date by re-checking the tiles which changed since it was last used.
+/// The map is only regenerated from scratch if the changes are unknown, such as after loading a map.
+static PathBlockingCache const &fpathUpdateBlockingCache(PathBlockingType const &type)
+{
+	auto cache = std::find_if(fpathBlockingCaches.begin(), fpathBlockingCaches.end(), [&](PathBlockingCache const &c) {
+		return fpathIsEquivalentBlocking(c.type.propulsion, c.type.owner, c.type.moveType,
+		                                 type.propulsion,   type.owner,   type.moveType);
+	});
+	if (cache == fpathBlockingCaches.end())
+	{
+		fpathBlockingCaches.push_back(PathBlockingCache());
+		cache = fpathBlockingCaches.end() - 1;
+		cache->type = type;  // The map is empty, so will be generated below.
+	}
+
+	PathBitmap &map = cache->map;
+	PathBlockingType const &cacheType = cache->type;  // Equivalent to type, so gives the same map.
+	if (map.width != mapWidth || map.height != mapHeight || cache->changedTilesEnd < auxChangedTilesStart
+	    || cache->scrollMinX != scrollMinX || cache->scrollMinY != scrollMinY || cache->scrollMaxX != scrollMaxX || cache->scrollMaxY != scrollMaxY)
+	{
+		map.resize(mapWidth, mapHeight);
+		cache->transposed.resize(mapHeight, mapWidth);
+		cache->generation = ++fpathBlockingGeneration;
+		for (int y = 0; y < mapHeight; ++y)
+			for (int x = 0; x < mapWidth; ++x)
+			{
+				bool blocking = fpathBaseBlockingTile(x, y, cacheType.propulsion, cacheType.owner, cacheType.moveType);
+				map.set(x, y, blocking);
+				cache->transposed.set(y, x, blocking);
+			}
+		cache->scrollMinX = scrollMinX;
+		cache->scrollMinY = scrollMinY;
+		cache->scrollMaxX = scrollMaxX;
+		cache->scrollMaxY = scrollMaxY;
+	}
+	else
+	{
+		bool changed = false;
+		for (size_t n = cache->changedTilesEnd - auxChangedTilesStart; n < auxChangedTiles.size(); ++n)
+		{
+			int x = auxChangedTiles[n] % mapWidth, y = auxChangedTiles[n] / mapWidth;
+			bool blocking = fpathBaseBlockingTile(x, y, cacheType.propulsion, cacheType.owner, cacheType.moveType);
+			changed = changed || map.get(x, y) != blocking;
+			map.set(x, y, blocking);
+			cache->transposed.set(y, x, blocking);
+		}
+		if (changed)
+		{
+			// Only a real change makes cached routes stale. Changes to the aux bits are also logged when the blocking tiles stay the same.
+			cache->generation = ++fpathBlockingGeneration;
+		}
+	}
+	cache->changedTilesEnd = auxChangedTilesStart + auxChangedTiles.size();
+
+	// Forget the changes which all kinds of blocking map have seen.
+	uint32_t oldestEnd = cache->changedTilesEnd;
+	for (PathBlockingCache const &c : fpathBlockingCaches)
+	{
+		if (c.changedTilesEnd >= auxChangedTilesStart)
+		{
+			oldestEnd = std::min(oldestEnd, c.changedTilesEnd);
+		}
+	}
+	auxChangedTiles.erase(auxChangedTiles.begin(), auxChangedTiles.begin() + (oldestEnd - auxChangedTilesStart));
+	auxChangedTilesStart = oldestEnd;
+
+	return *cache;
+}
+
+/// Fills in blockMap for the given type, and calculates checksums of the blocking and danger maps.
+static void fpathFillBlockingMap(PathBlockingMap &blockMap, PathBlockingType const &type, bool transposed, uint32_t &checksumMap, uint32_t &checksumDangerMap)
+{
+	blockMap.type = type;
+	PathBlockingCache const &cache = fpathUpdateBlockingCache(type);
+	blockMap.map = cache.map;
+	blockMap.generation = cache.generation;
+	if (transposed)
+	{
+		blockMap.transposed = cache.transposed;
+	}
+	checksumMap = blockMap.map.checksum();
+	checksumDangerMap = 0;
+	if (!isHumanPlayer(type.owner) && type.moveType == FMT_MOVE)
+	{
+		// The threat bits change all the time, so there is no point in patching the danger map.
+		PathBitmap &dangerMap = blockMap.dangerMap;
+		dangerMap.resize(mapWidth, mapHeight);
+		for (int y = 0; y < mapHeight; ++y)
+			for (int x = 0; x < mapWidth; ++x)
+			{
+				dangerMap.set(x, y, auxTile(x, y, type.owner) & AUXBITS_THREAT);
+			}
+		checksumDangerMap = dangerMap.checksum();
+	}
+	blockMap.dangerChecksum = checksumDangerMap;
+}
+
 void fpathSetBlockingMap(PATHJOB *psJob)
 {
 	if (fpathCurrentGameTime != gameTime)
@@ -634,26 +1743,12 @@ void fpathSetBlockingMap(PATHJOB *psJob)
 		fpathBlockingMaps.emplace_back(blockMap);
 
 		// blockMap now points to an empty map with no data. Fill the map.
-		blockMap->type = type;
-		std::vector<bool> &map = blockMap->map;
-		map.resize(mapWidth * mapHeight);
-		uint32_t checksumMap = 0, checksumDangerMap = 0, factor = 0;
-		for (int y = 0; y < mapHeight; ++y)
-			for (int x = 0; x < mapWidth; ++x)
-			{
-				map[x + y * mapWidth] = fpathBaseBlockingTile(x, y, type.propulsion, type.owner, type.moveType);
-				checksumMap ^= map[x + y * mapWidth] * (factor = 3 * factor + 1);
-			}
-		if (!isHumanPlayer(type.owner) && type.moveType == FMT_MOVE)
+		uint32_t checksumMap, checksumDangerMap;
+		fpathFillBlockingMap(*blockMap, type, psJob->searchMode == FSM_JPS, checksumMap, checksumDangerMap);
+		if (psJob->searchMode == FSM_HIERARCHICAL)
 		{
-			std::vector<bool> &dangerMap = blockMap->dangerMap;
-			dangerMap.resize(mapWidth * mapHeight);
-			for (int y = 0; y < mapHeight; ++y)
-				for (int x = 0; x < mapWidth; ++x)
-				{
-					dangerMap[x + y * mapWidth] = auxTile(x, y, type.owner) & AUXBITS_THREAT;
-					checksumDangerMap ^= dangerMap[x + y * mapWidth] * (factor = 3 * factor + 1);
-				}
+			// The search mode is the same for the whole game, so the region graph and transposed map are never added to a map already in use.
+			blockMap->hierarchy = fpathUpdateHierarchy(*blockMap);
 		}
 		syncDebug("blockingMap(%d,%d,%d,%d) = %08X %08X", gameTime, psJob->propulsion, psJob->owner, psJob->moveType, checksumMap, checksumDangerMap);
 
@@ -666,3 +1761,107 @@ void fpathSetBlockingMap(PATHJOB *psJob)
 		psJob->blockingMap = *i;
 	}
 }
+
+ASR_BENCHMARK fpathAStarBenchmark(unsigned numRoutes)
+{
+	ASR_BENCHMARK result;
+
+	// Use a private blocking map, to not disturb the path-finding threads or the sync debug log.
+	PathBlockingType type;
+	type.gameTime = gameTime;
+	type.propulsion = PROPULSION_TYPE_WHEELED;
+	type.owner = 0;
+	type.moveType = FMT_BLOCK;
+	std::shared_ptr<PathBlockingMap> blockMap = std::make_shared<PathBlockingMap>();
+	uint32_t checksumMap, checksumDangerMap;
+	fpathFillBlockingMap(*blockMap, type, true, checksumMap, checksumDangerMap);
+	blockMap->hierarchy = fpathUpdateHierarchy(*blockMap);
+
+	// Pick reachable pairs of tiles, the same ones every time for a given map.
+	std::vector<std::pair<Vector2i, Vector2i>> routes;
+	uint32_t random = 12345;
+	auto randomTile = [&random]() {
+		random = random * 1103515245 + 12345;
+		int x = (random >> 8) % mapWidth;
+		random = random * 1103515245 + 12345;
+		int y = (random >> 8) % mapHeight;
+		return Vector2i(x, y);
+	};
+	for (unsigned attempt = 0; attempt < numRoutes * 100 && routes.size() < numRoutes; ++attempt)
+	{
+		Vector2i orig = randomTile(), dest = randomTile();
+		if (!blockMap->map.get(orig.x, orig.y) && !blockMap->map.get(dest.x, dest.y)
+		    && mapTile(orig.x, orig.y)->limitedContinent == mapTile(dest.x, dest.y)->limitedContinent)
+		{
+			routes.push_back(std::make_pair(orig, dest));
+		}
+	}
+	result.routes = routes.size();
+
+	// Searches a route, returning the result and the points of the route.
+	auto search = [&](std::pair<Vector2i, Vector2i> const &route, FPATH_SEARCH_MODE mode, unsigned &nodesExpanded) {
+		PATHJOB job;
+		job.origX = world_coord(route.first.x) + TILE_UNITS / 2;
+		job.origY = world_coord(route.first.y) + TILE_UNITS / 2;
+		job.destX = world_coord(route.second.x) + TILE_UNITS / 2;
+		job.destY = world_coord(route.second.y) + TILE_UNITS / 2;
+		job.dstStructure = getStructureBounds((BASE_OBJECT *)nullptr);
+		job.propulsion = type.propulsion;
+		job.droidType = DROID_WEAPON;
+		job.droidID = 0;
+		job.moveType = type.moveType;
+		job.owner = type.owner;
+		job.blockingMap = blockMap;
+		job.acceptNearest = true;
+		job.deleted = false;
+		job.searchMode = mode;
+
+		// No cached contexts, so that every route is a complete search.
+		std::list<PathfindContext> contexts;
+		MOVE_CONTROL move{};
+		ASR_RETVAL retval = fpathAStarRoute(contexts, &move, &job, nodesExpanded);
+		std::vector<Vector2i> points(move.asPath, move.asPath + move.numPoints);
+		free(move.asPath);
+		return std::make_pair(retval, points);
+	};
+
+	std::vector<std::vector<std::pair<ASR_RETVAL, std::vector<Vector2i>>>> found(FSM_NUM);
+	for (int mode = 0; mode < FSM_NUM; ++mode)
+	{
+		QElapsedTimer timer;
+		timer.start();
+		for (auto const &route : routes)
+		{
+			unsigned nodesExpanded = 0;
+			found[mode].push_back(search(route, (FPATH_SEARCH_MODE)mode, nodesExpanded));
+			result.nodesExpanded[mode] += nodesExpanded;
+		}
+		result.microseconds[mode] = timer.nsecsElapsed() / 1000;
+	}
+
+	for (int mode = 0; mode < FSM_NUM; ++mode)
+	{
+		for (unsigned n = 0; n < routes.size(); ++n)
+		{
+			std::vector<Vector2i> const &points = found[mode][n].second;
+			for (unsigned i = 1; i < points.size(); ++i)
+			{
+				result.pathLength[mode] += iHypot(points[i] - points[i - 1]);
+			}
+
+			// Every mode should reach the same place as the classic search, and should find exactly the same route when searching again.
+			std::vector<Vector2i> const &classicPoints = found[FSM_CLASSIC][n].second;
+			if (found[mode][n].first != found[FSM_CLASSIC][n].first || points.empty() || classicPoints.empty() || points.back() != classicPoints.back())
+			{
+				++result.mismatches[mode];
+			}
+			unsigned nodesExpanded = 0;
+			if (search(routes[n], (FPATH_SEARCH_MODE)mode, nodesExpanded) != found[mode][n])
+			{
+				++result.unstable[mode];
+			}
+		}
+	}
+
+	return result;
+}
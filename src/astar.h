@@ -35,15 +35,47 @@ enum ASR_RETVAL
 };
 
 /** Use the A* algorithm to find a path
+ *
+ *  Cached search state is kept per lane, so a given lane must not be routed from more than one thread at a time.
  *
  *  @ingroup pathfinding
  */
-ASR_RETVAL fpathAStarRoute(MOVE_CONTROL *psMove, PATHJOB *psJob);
+ASR_RETVAL fpathAStarRoute(unsigned lane, MOVE_CONTROL *psMove, PATHJOB *psJob);
+
+/// Statistics of the cache of routes which later searches may join, instead of searching.
+struct ASR_ROUTE_CACHE_STATISTICS
+{
+	unsigned lookups;            ///< Number of routes requested.
+	unsigned hits;               ///< Number of routes copied from the cache.
+	unsigned avgNodesPerSearch;  ///< Average number of nodes expanded by the routes not copied from the cache.
+};
+
+/// Returns the route cache statistics. Function is thread-safe.
+ASR_ROUTE_CACHE_STATISTICS fpathAStarRouteCacheStatistics();
 
 /// Call from main thread.
 /// Sets psJob->blockingMap for later use by pathfinding thread, generating the required map if not already generated.
 void fpathSetBlockingMap(PATHJOB *psJob);
 
+/// Results of fpathAStarBenchmark, for each search mode.
+struct ASR_BENCHMARK
+{
+	unsigned routes = 0;                    ///< Number of routes searched.
+	uint64_t nodesExpanded[FSM_NUM] = {};   ///< Total number of nodes taken from the open list, including cluster graph nodes.
+	uint64_t microseconds[FSM_NUM] = {};    ///< Total time taken.
+	uint64_t pathLength[FSM_NUM] = {};      ///< Total length of the routes found, in world units.
+	unsigned mismatches[FSM_NUM] = {};      ///< Number of routes ending somewhere else than with the classic search.
+	unsigned unstable[FSM_NUM] = {};        ///< Number of routes which came out differently when searched again.
+};
+
+/** Search random routes across the current map in each search mode, without reusing cached searches.
+ *
+ *  Each route is searched twice, to check that the routes are deterministic, and compared with the classic search.
+ *
+ *  Call from main thread. Does not affect the path-finding threads or game state.
+ */
+ASR_BENCHMARK fpathAStarBenchmark(unsigned numRoutes);
+
 /** Clean up the path finding node table.
  *
  *  @note Call this on shutdown to prevent memory from leaking, or if loading/saving, to prevent stale data from being reused.
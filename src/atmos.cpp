@@ -34,6 +34,8 @@
 #include "map.h"
 #include "miscimd.h"
 
+#include <vector>
+
 // -----------------------------------------------------------------------------
 // -----------------------------------------------------------------------------
 // Shift all this gubbins into a .h file if it makes it into game
@@ -51,26 +53,17 @@ enum AP_TYPE
 	AP_SNOW
 };
 
-enum AP_STATUS
-{
-	APS_INACTIVE,
-	APS_ACTIVE
-};
-
-static ATPART	*asAtmosParts = nullptr;
-static UDWORD	freeParticle;
+static std::vector<ATPART> asAtmosParts;  ///< Only the active particles, in no particular order.
 static WT_CLASS	weather = WT_NONE;
 
 /* Setup all the particles */
 void atmosInitSystem()
 {
-	if (!asAtmosParts && weather != WT_NONE)
+	if (weather != WT_NONE)
 	{
-		// calloc sets all to APS_INACTIVE initially
-		asAtmosParts = (ATPART *)calloc(MAX_ATMOS_PARTICLES, sizeof(*asAtmosParts));
+		// Enough for a screen full of weather, so we don't reallocate while it starts falling
+		asAtmosParts.reserve(4096);
 	}
-	/* Start at the beginning */
-	freeParticle = 0;
 }
 
 /*	Makes a particle wrap around - if it goes off the grid, then it returns
@@ -102,8 +95,8 @@ static void testParticleWrap(ATPART *psPart)
 	}
 }
 
-/* Moves one of the particles */
-static void processParticle(ATPART *psPart)
+/* Deals with one of the particles, after it has moved. Returns false if it has died */
+static bool processParticle(ATPART *psPart)
 {
 	SDWORD	groundHeight;
 	Vector3i pos;
@@ -113,11 +106,6 @@ static void processParticle(ATPART *psPart)
 	/* Only move if the game isn't paused */
 	if (!gamePaused())
 	{
-		/* Move the particle - frame rate controlled */
-		psPart->position.x += graphicsTimeAdjustedIncrement(psPart->velocity.x);
-		psPart->position.y += graphicsTimeAdjustedIncrement(psPart->velocity.y);
-		psPart->position.z += graphicsTimeAdjustedIncrement(psPart->velocity.z);
-
 		/* Wrap it around if it's gone off grid... */
 		testParticleWrap(psPart);
 
@@ -127,8 +115,7 @@ static void processParticle(ATPART *psPart)
 		    psPart->position.z > ((mapHeight - 1)*TILE_UNITS))
 		{
 			/* The kill it */
-			psPart->status = APS_INACTIVE;
-			return;
+			return false;
 		}
 
 		/* What height is the ground under it? Only do if low enough...*/
@@ -142,7 +129,6 @@ static void processParticle(ATPART *psPart)
 			    || psPart->position.y < 0.f)
 			{
 				/* Kill it and return */
-				psPart->status = APS_INACTIVE;
 				if (psPart->type == AP_RAIN)
 				{
 					x = map_coord(psPart->position.x);
@@ -157,7 +143,7 @@ static void processParticle(ATPART *psPart)
 						addEffect(&pos, EFFECT_EXPLOSION, EXPLOSION_TYPE_SPECIFIED, true, getImdFromIndex(MI_SPLASH), 0);
 					}
 				}
-				return;
+				return false;
 			}
 		}
 		if (psPart->type == AP_SNOW)
@@ -172,68 +158,50 @@ static void processParticle(ATPART *psPart)
 			}
 		}
 	}
+	return true;
 }
 
 /* Adds a particle to the system if it can */
 static void atmosAddParticle(const Vector3f &pos, AP_TYPE type)
 {
-	UDWORD	activeCount;
-	UDWORD	i;
-
-	for (i = freeParticle, activeCount = 0; asAtmosParts[i].status == APS_ACTIVE && activeCount < MAX_ATMOS_PARTICLES; i++)
-	{
-		activeCount++;
-		/* Check for wrap around */
-		if (i >= (MAX_ATMOS_PARTICLES - 1))
-		{
-			/* Go back to the first one */
-			i = 0;
-		}
-	}
-
-	/* Check the list isn't just full of essential effects */
-	if (activeCount >= MAX_ATMOS_PARTICLES - 1)
+	if (asAtmosParts.size() >= MAX_ATMOS_PARTICLES)
 	{
 		/* All of the particles active!?!? */
 		return;
 	}
-	else
-	{
-		freeParticle = i;
-	}
 
-	/* Record it's type */
-	asAtmosParts[freeParticle].type = (UBYTE)type;
+	asAtmosParts.push_back(ATPART());
+	ATPART &part = asAtmosParts.back();
 
-	/* Make it active */
-	asAtmosParts[freeParticle].status = APS_ACTIVE;
+	/* Record it's type */
+	part.type = (UBYTE)type;
 
 	/* Setup the imd */
 	switch (type)
 	{
 	case AP_SNOW:
-		asAtmosParts[freeParticle].imd = getImdFromIndex(MI_SNOW);
-		asAtmosParts[freeParticle].size = 80;
+		part.imd = getImdFromIndex(MI_SNOW);
+		part.size = 80;
 		break;
 	case AP_RAIN:
-		asAtmosParts[freeParticle].imd = getImdFromIndex(MI_RAIN);
-		asAtmosParts[freeParticle].size = 50;
+		part.imd = getImdFromIndex(MI_RAIN);
+		part.size = 50;
 		break;
 	default:
 		break;
 	}
 
 	/* Setup position */
-	asAtmosParts[freeParticle].position = pos;
+	part.position = pos;
 
 	/* Setup its velocity */
 	if (type == AP_RAIN)
 	{
-		asAtmosParts[freeParticle].velocity = Vector3f(RAIN_SPEED_DRIFT, RAIN_SPEED_FALL, RAIN_SPEED_DRIFT);
+		part.velocity = Vector3f(RAIN_SPEED_DRIFT, RAIN_SPEED_FALL, RAIN_SPEED_DRIFT);
 	}
 	else
 	{
-		asAtmosParts[freeParticle].velocity = Vector3f(SNOW_SPEED_DRIFT, SNOW_SPEED_FALL, SNOW_SPEED_DRIFT);
+		part.velocity = Vector3f(SNOW_SPEED_DRIFT, SNOW_SPEED_FALL, SNOW_SPEED_DRIFT);
 	}
 }
 
@@ -247,12 +215,24 @@ void atmosUpdateSystem()
 	// we don't want to do any of this while paused.
 	if (!gamePaused() && weather != WT_NONE)
 	{
-		for (i = 0; i < MAX_ATMOS_PARTICLES; i++)
+		/* Move the particles - frame rate controlled. Kept apart from the rest, so it is just arithmetic on each particle */
+		const float fraction = graphicsTimeAdjustedIncrement(1.f);
+		for (ATPART &part : asAtmosParts)
+		{
+			part.position += part.velocity * fraction;
+		}
+
+		for (i = 0; i < asAtmosParts.size();)
 		{
-			/* See if it's active */
-			if (asAtmosParts[i].status == APS_ACTIVE)
+			if (processParticle(&asAtmosParts[i]))
+			{
+				++i;
+			}
+			else
 			{
-				processParticle(&asAtmosParts[i]);
+				/* Replace the dead particle with the last one, which still needs processing */
+				asAtmosParts[i] = asAtmosParts.back();
+				asAtmosParts.pop_back();
 			}
 		}
 
@@ -300,16 +280,12 @@ void atmosDrawParticles(const glm::mat4 &viewMatrix)
 	}
 
 	/* Traverse the list */
-	for (i = 0; i < MAX_ATMOS_PARTICLES; i++)
+	for (i = 0; i < asAtmosParts.size(); i++)
 	{
-		/* Don't bother unless it's active */
-		if (asAtmosParts[i].status == APS_ACTIVE)
+		/* Is it visible on the screen? */
+		if (clipXYZ(asAtmosParts[i].position.x, asAtmosParts[i].position.z, asAtmosParts[i].position.y, viewMatrix))
 		{
-			/* Is it visible on the screen? */
-			if (clipXYZ(asAtmosParts[i].position.x, asAtmosParts[i].position.z, asAtmosParts[i].position.y, viewMatrix))
-			{
-				renderParticle(&asAtmosParts[i], viewMatrix);
-			}
+			renderParticle(&asAtmosParts[i], viewMatrix);
 		}
 	}
 }
@@ -339,10 +315,9 @@ void atmosSetWeatherType(WT_CLASS type)
 		weather = type;
 		atmosInitSystem();
 	}
-	if (type == WT_NONE && asAtmosParts)
+	if (type == WT_NONE)
 	{
-		free(asAtmosParts);
-		asAtmosParts = nullptr;
+		std::vector<ATPART>().swap(asAtmosParts);  // Free the memory, not just the particles.
 	}
 }
 
@@ -0,0 +1,295 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2005-2017  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+/**
+ * @file benchmark.cpp
+ * Benchmarks and self-checks of the game internals.
+ */
+
+#include "lib/framework/frame.h"
+#include "lib/gamelib/gtime.h"
+#include "lib/netplay/netplay.h"
+
+#include "benchmark.h"
+#include "ai.h"
+#include "astar.h"
+#include "clparse.h"
+#include "console.h"
+#include "mapgrid.h"
+#include "multiplay.h"
+#include "projectile.h"
+#include "qtscript.h"
+
+#include <stdarg.h>
+
+/// Game time to wait before running the benchmarks given with --bench, so that there are units and fighting to measure.
+#define BENCHMARK_START_TIME (3 * 60 * GAME_TICKS_PER_SEC)
+
+struct BENCHMARK
+{
+	const char *name;
+	void (*start)();  ///< If not nullptr, starts collecting what run() checks. run() starts it too, if needed.
+	bool (*run)();    ///< Prints the results, and returns false if something is wrong.
+};
+
+static void benchPrintf(const char *format, ...) WZ_DECL_FORMAT(printf, 1, 2);
+static void benchPrintf(const char *format, ...)
+{
+	char buf[512];
+	va_list ap;
+	va_start(ap, format);
+	vssprintf(buf, format, ap);
+	va_end(ap);
+
+	addConsoleMessage(buf, DEFAULT_JUSTIFY, SYSTEM_MESSAGE);
+	debug(LOG_INFO, "%s", buf);
+}
+
+/* Compares the path-finding search modes on random routes across the map */
+static bool benchPath()
+{
+	static const char *const modeNames[FSM_NUM] = {"classic", "hierarchical", "jump point"};
+
+	ASR_BENCHMARK bench = fpathAStarBenchmark(200);
+	benchPrintf("Path-finding benchmark, %u routes:", bench.routes);
+	bool ok = true;
+	for (int mode = 0; mode < FSM_NUM; ++mode)
+	{
+		benchPrintf("%s: %llu nodes expanded, %llu us, total length %llu, %u ending elsewhere than classic, %u nondeterministic", modeNames[mode],
+		            (unsigned long long)bench.nodesExpanded[mode], (unsigned long long)bench.microseconds[mode], (unsigned long long)bench.pathLength[mode],
+		            bench.mismatches[mode], bench.unstable[mode]);
+		ok = ok && bench.unstable[mode] == 0;
+	}
+	return ok;
+}
+
+/* Compares formatting syncDebug() calls immediately with formatting them only when dumping */
+static bool benchSyncDebug()
+{
+	SYNCDEBUG_BENCHMARK bench = syncDebugBenchmark(100000);
+	benchPrintf("syncDebug benchmark, %u calls: printed %llu ns/call, formatted on dump %llu ns/call, %s",
+	            bench.calls, (unsigned long long)(bench.printedNanoseconds / bench.calls), (unsigned long long)(bench.formattedNanoseconds / bench.calls),
+	            bench.identical ? "identical dumps" : "DUMPS DIFFER");
+	benchPrintf("Last tick had %u entries: about %llu us printed, %llu us formatted on dump", bench.entriesPerTick,
+	            (unsigned long long)(bench.printedNanoseconds * bench.entriesPerTick / bench.calls / 1000), (unsigned long long)(bench.formattedNanoseconds * bench.entriesPerTick / bench.calls / 1000));
+	return bench.identical;
+}
+
+static void benchGridStart()
+{
+	gridSetCheckRebuild(true);
+}
+
+/* Compares updating the object grid with rebuilding it, since the last grid benchmark, and checks they give the same grid */
+static bool benchGrid()
+{
+	static GRID_STATISTICS last;
+	GRID_STATISTICS stats = gridGetStatistics();
+	if (stats.resets < last.resets)
+	{
+		last = GRID_STATISTICS();  // New game since last time.
+	}
+	benchGridStart();
+
+	uint64_t resets = std::max<uint64_t>(stats.resets - last.resets, 1);
+	uint64_t checks = std::max<uint64_t>(stats.checks - last.checks, 1);
+	benchPrintf("Grid benchmark: %llu ticks, %llu ns/tick updating, %llu ns/tick rebuilding from scratch; per tick %llu layers sorted, %llu inserted, %llu removed, %llu shifted",
+	            (unsigned long long)(stats.resets - last.resets), (unsigned long long)((stats.nanoseconds - last.nanoseconds) / resets), (unsigned long long)((stats.checkNanoseconds - last.checkNanoseconds) / checks),
+	            (unsigned long long)((stats.layerUpdates - last.layerUpdates) / resets), (unsigned long long)((stats.inserted - last.inserted) / resets),
+	            (unsigned long long)((stats.removed - last.removed) / resets), (unsigned long long)((stats.shifted - last.shifted) / resets));
+	benchPrintf("%llu ticks checked against rebuilding the grid, %llu differed", (unsigned long long)(stats.checks - last.checks), (unsigned long long)(stats.mismatches - last.mismatches));
+	bool ok = stats.mismatches == last.mismatches;
+	last = stats;
+	return ok;
+}
+
+/* Searches the object grid from several threads at once, and checks they find the same as searching one at a time */
+static bool benchGridStress()
+{
+	GRID_STRESS_TEST test = gridStressTest(4);
+	benchPrintf("Grid stress test: %u threads each did %u searches in %llu us total, %u found something different from searching one at a time",
+	            test.threads, test.queries, (unsigned long long)test.microseconds, test.mismatches);
+	return test.mismatches == 0;
+}
+
+static void benchTargetCacheStart()
+{
+	aiTargetCacheSetVerify(true);
+}
+
+/* Shows the target candidate searches shared between nearby droids, since the last target cache benchmark, and checks they match searching the grid */
+static bool benchTargetCache()
+{
+	static AI_TARGET_CACHE_STATISTICS last;
+	AI_TARGET_CACHE_STATISTICS stats = aiTargetCacheStatistics();
+	benchTargetCacheStart();
+
+	benchPrintf("Target candidates: %llu lookups, %llu grid searches saved, %llu objects checked, %llu differed from searching the grid",
+	            (unsigned long long)(stats.lookups - last.lookups), (unsigned long long)(stats.hits - last.hits),
+	            (unsigned long long)(stats.candidates - last.candidates), (unsigned long long)(stats.mismatches - last.mismatches));
+	bool ok = stats.mismatches == last.mismatches;
+	last = stats;
+	return ok;
+}
+
+/* Shows the projectile update cost since the last projectile benchmark. Only measures, so never fails. */
+static bool benchProjectile()
+{
+	static PROJECTILE_STATISTICS last;
+	PROJECTILE_STATISTICS stats = proj_GetStatistics();
+	uint64_t updates = std::max<uint64_t>(stats.updates - last.updates, 1);
+	uint64_t projectiles = std::max<uint64_t>(stats.projectilesUpdated - last.projectilesUpdated, 1);
+	benchPrintf("Projectiles since last check: %llu ticks, %llu projectiles/tick (max %llu, room for %llu), %llu ns/tick, %llu ns/projectile",
+	            (unsigned long long)(stats.updates - last.updates), (unsigned long long)((stats.projectilesUpdated - last.projectilesUpdated) / updates),
+	            (unsigned long long)stats.maxProjectiles, (unsigned long long)stats.poolCapacity,
+	            (unsigned long long)((stats.nanoseconds - last.nanoseconds) / updates), (unsigned long long)((stats.nanoseconds - last.nanoseconds) / projectiles));
+	benchPrintf("Neighbour searches: %llu, %llu shared with nearby projectiles. Collision checks: %llu, %llu skipped as not even close",
+	            (unsigned long long)(stats.neighbourSearches - last.neighbourSearches), (unsigned long long)(stats.neighbourSearchesShared - last.neighbourSearchesShared),
+	            (unsigned long long)(stats.collisionChecks - last.collisionChecks), (unsigned long long)(stats.collisionsSkipped - last.collisionsSkipped));
+	last = stats;
+	return true;
+}
+
+/* Compares finding the objects of orders by ID with and without the object ID index, and checks dying objects are still found */
+static bool benchId()
+{
+	ID_LOOKUP_BENCHMARK bench = idLookupBenchmark(10);
+	unsigned orders = std::max(bench.orders, 1u);
+	benchPrintf("Order lookups with %u objects: %u orders, indexed %llu ns/order, searching lists %llu ns/order",
+	            bench.objects, bench.orders, (unsigned long long)(bench.indexedMicroseconds * 1000 / orders), (unsigned long long)(bench.searchedMicroseconds * 1000 / orders));
+	benchPrintf("Checked finding every object by ID, %u of them dying: %u mismatches", bench.dying, bench.mismatches);
+	return bench.mismatches == 0;
+}
+
+/* Compares enumerating droids in a script with every property filled in and with lazily computed properties, and checks they read the same */
+static bool benchLazy()
+{
+	SCRIPT_LAZY_BENCHMARK bench = scriptLazyObjectsBenchmark(10);
+	unsigned droids = std::max(bench.droids * bench.rounds, 1u);
+	benchPrintf("Script enumDroid() of %u droids, %u rounds: eager %llu ns/droid, lazy %llu ns/droid, %u rounds read something different",
+	            bench.droids, bench.rounds, (unsigned long long)(bench.eagerMicroseconds * 1000 / droids), (unsigned long long)(bench.lazyMicroseconds * 1000 / droids),
+	            bench.mismatches);
+	return bench.mismatches == 0;
+}
+
+/* Compares counting objects within range in a script with enumRange() and with countRange() or the type filter, and checks they count the same */
+static bool benchRange()
+{
+	SCRIPT_RANGE_BENCHMARK bench = scriptRangeBenchmark(10);
+	unsigned searches = std::max(bench.searches * bench.rounds, 1u);
+	benchPrintf("Script range searches, %u positions finding %u objects, %u droids: enumRange %llu ns/search, countRange %llu ns/search",
+	            bench.searches, bench.objects, bench.droids, (unsigned long long)(bench.enumMicroseconds * 1000 / searches), (unsigned long long)(bench.countMicroseconds * 1000 / searches));
+	benchPrintf("Droids only: filtering enumRange in script %llu ns/search, enumRange of DROID %llu ns/search, countRange of DROID %llu ns/search, %u searches counted something different",
+	            (unsigned long long)(bench.filterMicroseconds * 1000 / searches), (unsigned long long)(bench.typedMicroseconds * 1000 / searches),
+	            (unsigned long long)(bench.typedCountMicroseconds * 1000 / searches), bench.mismatches);
+	return bench.mismatches == 0;
+}
+
+static const BENCHMARK benchmarks[] =
+{
+	{"path", nullptr, benchPath},  // compare path-finding search modes, and check that each is deterministic
+	{"syncdebug", nullptr, benchSyncDebug},  // compare formatting syncDebug() calls immediately or when dumping, and check they dump the same
+	{"grid", benchGridStart, benchGrid},  // compare updating the object grid with rebuilding it, and check they give the same grid
+	{"gridstress", nullptr, benchGridStress},  // search the object grid from several threads at once
+	{"targetcache", benchTargetCacheStart, benchTargetCache},  // show shared target searches, and check them against searching the grid
+	{"projectile", nullptr, benchProjectile},  // show projectile update cost
+	{"id", nullptr, benchId},  // compare finding objects by ID with and without the object ID index, and check they find the same
+	{"lazy", nullptr, benchLazy},  // compare script enumDroid() with and without setLazyObjects(), and check they read the same
+	{"range", nullptr, benchRange},  // compare script enumRange() with countRange() and the type filter, and check they count the same
+};
+
+/// Calls function for each benchmark in a comma or space separated list of names. Returns false if a name was not recognised.
+template<typename Function>
+static bool forEachBenchmark(const std::string &names, Function const &function)
+{
+	bool ok = true;
+	size_t begin = 0;
+	while (begin < names.size())
+	{
+		size_t end = std::min(names.find_first_of(", ", begin), names.size());
+		std::string name = names.substr(begin, end - begin);
+		begin = end + 1;
+		if (name.empty())
+		{
+			continue;
+		}
+
+		bool found = false;
+		for (const BENCHMARK &benchmark : benchmarks)
+		{
+			if (name == "all" || name == benchmark.name)
+			{
+				found = true;
+				function(benchmark);
+			}
+		}
+		if (!found)
+		{
+			std::string known;
+			for (const BENCHMARK &benchmark : benchmarks)
+			{
+				known += std::string(" ") + benchmark.name;
+			}
+			benchPrintf("Unknown benchmark \"%s\", try all or one of:%s", name.c_str(), known.c_str());
+			ok = false;
+		}
+	}
+	return ok;
+}
+
+bool benchmarkRun(const std::string &names)
+{
+	bool ok = true;
+	bool known = forEachBenchmark(names, [&ok](const BENCHMARK &benchmark) {
+		if (!benchmark.run())
+		{
+			benchPrintf("Benchmark \"%s\" FAILED", benchmark.name);
+			ok = false;
+		}
+	});
+	return known && ok;
+}
+
+void benchmarkUpdate()
+{
+	static bool started = false;
+	static bool done = false;
+	if (done || benchmarks_enabled().empty())
+	{
+		return;
+	}
+	if (!started)
+	{
+		started = true;
+		forEachBenchmark(benchmarks_enabled(), [](const BENCHMARK &benchmark) {
+			if (benchmark.start != nullptr)
+			{
+				benchmark.start();
+			}
+		});
+	}
+	if (gameTime < BENCHMARK_START_TIME)
+	{
+		return;
+	}
+	done = true;
+
+	bool ok = benchmarkRun(benchmarks_enabled());
+	debug(ok ? LOG_INFO : LOG_ERROR, "Benchmarks %s, quitting", ok ? "passed" : "FAILED");
+	exit(ok ? 0 : 1);
+}
@@ -0,0 +1,39 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2005-2017  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+/** @file
+ *  Benchmarks and self-checks of the game internals, run with the "bench" cheat or the --bench option.
+ */
+
+#ifndef __INCLUDED_SRC_BENCHMARK_H__
+#define __INCLUDED_SRC_BENCHMARK_H__
+
+#include <string>
+
+/** Run the benchmarks in a comma or space separated list of names, or all of them for "all".
+ *
+ *  The results are printed to the console and the log.
+ *
+ *  @return false if any benchmark found something wrong, or a name was not recognised.
+ */
+bool benchmarkRun(const std::string &names);
+
+/// Run the benchmarks given with --bench, once the game has been running long enough, then quit with the result.
+void benchmarkUpdate();
+
+#endif // __INCLUDED_SRC_BENCHMARK_H__
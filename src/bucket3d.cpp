@@ -25,6 +25,7 @@
 
 #include "lib/framework/frame.h"
 #include "lib/framework/vector.h"
+#include "lib/framework/radixsort.h"
 #include "lib/ivis_opengl/piematrix.h"
 #include "lib/ivis_opengl/pieclip.h"
 
@@ -35,7 +36,6 @@
 #include "effects.h"
 #include "miscimd.h"
 
-#include <algorithm>
 
 #define CLIP_LEFT	((SDWORD)0)
 #define CLIP_RIGHT	((SDWORD)pie_GetVideoBufferWidth())
@@ -47,17 +47,13 @@
 
 struct BUCKET_TAG
 {
-	bool operator <(BUCKET_TAG const &b) const
-	{
-		return actualZ > b.actualZ;    // Sort in reverse z order.
-	}
-
 	RENDER_TYPE     objectType; //type of object held
 	void           *pObject;    //pointer to the object
-	int32_t         actualZ;
+	uint64_t        sortKey;    //reverse z order, then object type, then shape
 };
 
 static std::vector<BUCKET_TAG> bucketArray;
+static std::vector<BUCKET_TAG> bucketScratch;  // for sorting
 
 static SDWORD bucketCalculateZ(RENDER_TYPE objectType, void *pObject, const glm::mat4 &viewMatrix)
 {
@@ -303,7 +299,7 @@ static SDWORD bucketCalculateZ(RENDER_TYPE objectType, void *pObject, const glm:
 /* add an object to the current render list */
 void bucketAddTypeToList(RENDER_TYPE objectType, void *pObject, const glm::mat4 &viewMatrix)
 {
-	const iIMDShape *pie;
+	const iIMDShape *pie = nullptr;
 	BUCKET_TAG	newTag;
 	int32_t		z = bucketCalculateZ(objectType, pObject, viewMatrix);
 
@@ -322,6 +318,7 @@ void bucketAddTypeToList(RENDER_TYPE objectType, void *pObject, const glm::mat4
 	switch (objectType)
 	{
 	case RENDER_EFFECT:
+		pie = ((EFFECT *)pObject)->imd;
 		switch (((EFFECT *)pObject)->group)
 		{
 		case EFFECT_EXPLOSION:
@@ -332,7 +329,6 @@ void bucketAddTypeToList(RENDER_TYPE objectType, void *pObject, const glm::mat4
 			break;
 
 		case EFFECT_WAYPOINT:
-			pie = ((EFFECT *)pObject)->imd;
 			z = INT32_MAX - pie->texpage;
 			break;
 
@@ -359,6 +355,7 @@ void bucketAddTypeToList(RENDER_TYPE objectType, void *pObject, const glm::mat4
 		z = INT32_MAX - pie->texpage;
 		break;
 	case RENDER_PARTICLE:
+		pie = ((ATPART *)pObject)->imd;
 		z = 0;
 		break;
 	default:
@@ -369,7 +366,8 @@ void bucketAddTypeToList(RENDER_TYPE objectType, void *pObject, const glm::mat4
 	//put the object data into the tag
 	newTag.objectType = objectType;
 	newTag.pObject = pObject;
-	newTag.actualZ = z;
+	// Draw far things first, and keep the same kind of thing with the same shape together, so the same state gets set consecutively
+	newTag.sortKey = (uint64_t)(uint32_t)(INT32_MAX - z) << 32 | (uint64_t)objectType << 24 | ((uintptr_t)pie >> 4 & 0xFFFFFF);
 
 	//add tag to bucketArray
 	bucketArray.push_back(newTag);
@@ -378,7 +376,7 @@ void bucketAddTypeToList(RENDER_TYPE objectType, void *pObject, const glm::mat4
 /* render Objects in list */
 void bucketRenderCurrentList(const glm::mat4 &viewMatrix)
 {
-	std::sort(bucketArray.begin(), bucketArray.end());
+	radixSort(bucketArray, bucketScratch, [](BUCKET_TAG const &tag) { return tag.sortKey; });
 
 	for (std::vector<BUCKET_TAG>::const_iterator thisTag = bucketArray.begin(); thisTag != bucketArray.end(); ++thisTag)
 	{
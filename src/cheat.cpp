@@ -27,6 +27,7 @@
 #include "lib/exceptionhandler/dumpinfo.h"
 #include "lib/netplay/netplay.h"
 
+#include "benchmark.h"
 #include "cheat.h"
 #include "keybind.h"
 #include "keymap.h"
@@ -76,6 +77,7 @@ static CHEAT_ENTRY cheatCodes[] =
 	{"time toggle", kf_ToggleMissionTimer},
 	{"work harder", kf_FinishResearch},
 	{"tileinfo", kf_TileInfo}, // output debug info about a tile
+	{"instancing", kf_ToggleInstancing}, // toggle drawing identical shapes with one instanced draw call
 	{"showfps", kf_ToggleFPS},	//displays your average FPS
 	{"showsamples", kf_ToggleSamples}, //displays the # of Sound samples in Queue & List
 	{"showorders", kf_ToggleOrders}, //displays unit order/action state.
@@ -119,6 +121,15 @@ bool attemptCheatCode(const char *cheat_name)
 		return false;
 	}
 
+	// "bench" runs all the benchmarks, "bench <name>" just the named ones
+	if (strncasecmp(cheat_name, "bench", 5) == 0 && (cheat_name[5] == '\0' || cheat_name[5] == ' '))
+	{
+		benchmarkRun(cheat_name[5] == ' ' ? cheat_name + 6 : "all");
+		addDumpInfo("User has used cheat code: bench");
+		Cheated = true;
+		return true;
+	}
+
 	for (curCheat = cheatCodes; curCheat != EndCheat; ++curCheat)
 	{
 		if (strcasecmp(cheat_name, curCheat->pName) == 0)
@@ -82,6 +82,7 @@ typedef struct _poptContext
 static bool wz_autogame = false;
 static std::string wz_saveandquit;
 static std::string wz_test;
+static std::string wz_bench;
 
 static void poptPrintHelp(poptContext ctx, FILE *output, bool show_all)
 {
@@ -252,6 +253,7 @@ typedef enum
 	CLI_AUTOGAME,
 	CLI_SAVEANDQUIT,
 	CLI_SKIRMISH,
+	CLI_BENCH,
 } CLI_OPTIONS;
 
 static const struct poptOption *getOptionsTable()
@@ -288,6 +290,7 @@ static const struct poptOption *getOptionsTable()
 		{ "autogame",   '\0', POPT_ARG_NONE,   nullptr, CLI_AUTOGAME,   N_("Run games automatically for testing"), nullptr, true },
 		{ "saveandquit", '\0', POPT_ARG_STRING, nullptr, CLI_SAVEANDQUIT, N_("Immediately save game and quit"), N_("save name"), true },
 		{ "skirmish",   '\0', POPT_ARG_STRING, nullptr, CLI_SKIRMISH,   N_("Start skirmish game with given settings file"), N_("test"), true },
+		{ "bench",      '\0', POPT_ARG_STRING, nullptr, CLI_BENCH,      N_("Run the given benchmarks during the game, then quit"), N_("benchmarks"), true },
 		// Terminating entry
 		{ nullptr,         '\0', 0,               nullptr, 0,              nullptr,                                    nullptr, true },
 	};
@@ -649,6 +652,15 @@ bool ParseCommandLine(int argc, const char **argv)
 			}
 			wz_test = token;
 			break;
+
+		case CLI_BENCH:
+			token = poptGetOptArg(poptCon);
+			if (token == nullptr)
+			{
+				qFatal("Bad benchmark list");
+			}
+			wz_bench = token;
+			break;
 		};
 	}
 
@@ -669,3 +681,8 @@ const std::string &wz_skirmish_test()
 {
 	return wz_test;
 }
+
+const std::string &benchmarks_enabled()
+{
+	return wz_bench;
+}
@@ -37,6 +37,7 @@
 #include "configuration.h"
 #include "difficulty.h"
 #include "display3d.h"
+#include "fpath.h"
 #include "ingameop.h"
 #include "multiint.h"
 #include "multiplay.h"
@@ -121,6 +122,7 @@ bool loadConfig()
 	{
 		war_SetScrollEvent(ini.value("scrollEvent").toInt());
 	}
+	war_SetPathThreads(ini.value("pathThreads", 0).toInt());
 	rotateRadar = ini.value("rotateRadar", true).toBool();
 	radarRotationArrow = ini.value("radarRotationArrow", true).toBool();
 	quitConfirmation = ini.value("quitConfirmation", true).toBool();
@@ -149,6 +151,7 @@ bool loadConfig()
 	game.base = ini.value("base", CAMP_BASE).toInt();
 	game.alliance = ini.value("alliance", NO_ALLIANCES).toInt();
 	game.scavengers = ini.value("scavengers", false).toBool();
+	game.pathSearch = ini.value("pathSearch", FSM_CLASSIC).toInt();
 	memset(&ingame.phrases, 0, sizeof(ingame.phrases));
 	for (int i = 1; i < 5; i++)
 	{
@@ -243,6 +246,7 @@ bool saveConfig()
 	ini.setValue("cameraSpeed", war_GetCameraSpeed());	// camera speed
 	ini.setValue("radarJump", war_GetRadarJump());		// radar jump
 	ini.setValue("scrollEvent", war_GetScrollEvent());	// scroll event
+	ini.setValue("pathThreads", war_GetPathThreads());	// path-finding threads, 0 = automatic
 	ini.setValue("cameraAccel", getCameraAccel());		// camera acceleration
 	ini.setValue("mouseflip", (SDWORD)(getInvertMouseStatus()));	// flipmouse
 	ini.setValue("nomousewarp", (SDWORD)getMouseWarp());		// mouse warp
@@ -289,6 +293,7 @@ bool saveConfig()
 			ini.setValue("base", game.base);				// size of base
 			ini.setValue("alliance", game.alliance);		// allow alliances
 			ini.setValue("scavengers", game.scavengers);
+			ini.setValue("pathSearch", game.pathSearch);	// path-finding search mode
 		}
 		ini.setValue("playerName", (char *)sPlayer);		// player name
 	}
@@ -368,6 +373,7 @@ bool reloadMPConfig()
 	game.power = ini.value("powerLevel", LEV_MED).toInt();
 	game.base = ini.value("base", CAMP_BASE).toInt();
 	game.alliance = ini.value("alliance", NO_ALLIANCES).toInt();
+	game.pathSearch = ini.value("pathSearch", FSM_CLASSIC).toInt();
 
 	return true;
 }
@@ -149,7 +149,28 @@
 #define SHOCKWAVE_SPEED	(GAME_TICKS_PER_SEC)
 #define	MAX_SHOCKWAVE_SIZE				500
 
-static std::list<EFFECT *> activeList;
+/* Most effects of each group there can be at once. If a group is full, new effects nobody can see are dropped, otherwise the oldest effect
+   in the group which isn't essential makes way. The effects never move while they are in the render buckets, since the pools never grow. */
+static const unsigned effectGroupCapacity[EFFECT_FREED] =
+{
+	2048,	// EFFECT_EXPLOSION
+	512,	// EFFECT_CONSTRUCTION
+	2048,	// EFFECT_SMOKE
+	1024,	// EFFECT_GRAVITON
+	256,	// EFFECT_WAYPOINT
+	512,	// EFFECT_BLOOD
+	256,	// EFFECT_DESTRUCTION
+	64,		// EFFECT_SAT_LASER
+	512,	// EFFECT_FIRE
+	512,	// EFFECT_FIREWORK
+};
+
+/* The active effects of each group, in no particular order */
+static std::vector<EFFECT> effectGroups[EFFECT_FREED];
+
+/* The group being updated, if any, and the effects which found it full while it was, which get added once it's done */
+static std::vector<EFFECT> *updatingEffectGroup = nullptr;
+static std::vector<EFFECT> effectsWaitingForGroup;
 
 /* Tick counts for updates on a particular interval */
 static	UDWORD	lastUpdateStructures[EFFECT_STRUCTURE_DIVISION];
@@ -174,7 +195,6 @@ static bool updateDestruction(EFFECT *psEffect);
 static bool updateFire(EFFECT *psEffect);
 static bool updateSatLaser(EFFECT *psEffect);
 static bool updateFirework(EFFECT *psEffect);
-static bool updateEffect(EFFECT *psEffect);	// MASTER function
 
 // ----------------------------------------------------------------------------------------
 // ---- The render functions - every group type of effect has a distinct one
@@ -209,11 +229,10 @@ static UDWORD effectGetNumFrames(EFFECT *psEffect);
 
 void shutdownEffectsSystem()
 {
-	for (auto eff : activeList)
+	for (auto &effects : effectGroups)
 	{
-		delete eff;
+		effects.clear();
 	}
-	activeList.clear();
 }
 
 /*!
@@ -236,6 +255,48 @@ static glm::mat4 positionEffect(const EFFECT *psEffect)
 	return glm::translate(dv);
 }
 
+/* Puts a new effect in its group, if there's room for it */
+static void allocateEffect(const EFFECT &effect)
+{
+	std::vector<EFFECT> &effects = effectGroups[effect.group];
+	unsigned capacity = effectGroupCapacity[effect.group];
+	if (effects.size() < capacity)
+	{
+		effects.reserve(capacity);  // Only allocates the first time, so effects being updated never move.
+		effects.push_back(effect);
+		return;
+	}
+
+	/* Nobody will miss an effect they can't see */
+	if (!TEST_ESSENTIAL((&effect)) && !clipXY(effect.position.x, effect.position.z))
+	{
+		return;
+	}
+
+	/* One of the effects in a group being updated might be the one adding this, so wait to recycle any of them */
+	if (&effects == updatingEffectGroup)
+	{
+		effectsWaitingForGroup.push_back(effect);
+		return;
+	}
+
+	/* Make way by recycling the oldest effect which isn't essential */
+	EFFECT *psOldest = nullptr;
+	for (EFFECT &old : effects)
+	{
+		if (!TEST_ESSENTIAL((&old)) && (psOldest == nullptr || old.birthTime < psOldest->birthTime))
+		{
+			psOldest = &old;
+		}
+	}
+	if (psOldest == nullptr)
+	{
+		debug(LOG_WARNING, "No room for effect group %d, since all %u are essential", (int)effect.group, capacity);
+		return;
+	}
+	*psOldest = effect;
+}
+
 void effectSetLandLightSpec(LAND_LIGHT_SPEC spec)
 {
 	ellSpec = spec;
@@ -301,7 +362,9 @@ void addEffect(const Vector3i *pos, EFFECT_GROUP group, EFFECT_TYPE type, bool s
 	{
 		return;
 	}
-	EFFECT *psEffect = new EFFECT();
+	ASSERT_OR_RETURN(, group < EFFECT_FREED, "Weirdy group type for an effect");
+	EFFECT effect;
+	EFFECT *psEffect = &effect;
 	/* Reset control bits */
 	psEffect->control = 0;
 
@@ -394,104 +457,63 @@ void addEffect(const Vector3i *pos, EFFECT_GROUP group, EFFECT_TYPE type, bool s
 
 	ASSERT(psEffect->imd != nullptr || group == EFFECT_DESTRUCTION || group == EFFECT_FIRE || group == EFFECT_SAT_LASER, "null effect imd");
 
-	activeList.push_back(psEffect);
+	allocateEffect(effect);
 }
 
 
-/* Calls all the update functions for each different currently active effect */
-void processEffects(const glm::mat4 &viewMatrix)
+/* Updates all the effects in a group, which update() returns false for when they are finished, and adds the rest to the render buckets */
+template<bool (*update)(EFFECT *)>
+static void processEffectGroup(std::vector<EFFECT> &effects, bool updateWhilePaused, const glm::mat4 &viewMatrix)
 {
-	for (auto it = activeList.begin(); it != activeList.end(); )
+	const bool doUpdate = updateWhilePaused || !gamePaused();
+
+	// Effects added while updating are appended, and get processed too, unless the group was full.
+	updatingEffectGroup = &effects;
+	for (size_t i = 0; i < effects.size();)
 	{
-		EFFECT *psEffect = *it;
+		EFFECT *psEffect = &effects[i];
 
 		if (psEffect->birthTime <= graphicsTime)  // Don't process, if it doesn't exist yet
 		{
-			if (!updateEffect(psEffect))
+			if (doUpdate && !update(psEffect))
 			{
-				delete psEffect;
-				it = activeList.erase(it);
+				/* Replace it with the last one, which hasn't been processed yet */
+				*psEffect = effects.back();
+				effects.pop_back();
 				continue;
 			}
-			if (psEffect->group != EFFECT_FREED && clipXY(psEffect->position.x, psEffect->position.z))
+			if (clipXY(psEffect->position.x, psEffect->position.z))
 			{
 				bucketAddTypeToList(RENDER_EFFECT, psEffect, viewMatrix);
 			}
 		}
-		++it;
+		++i;
 	}
+	updatingEffectGroup = nullptr;
 
-	/* Add any structure effects */
-	effectStructureUpdates();
+	for (const EFFECT &effect : effectsWaitingForGroup)
+	{
+		allocateEffect(effect);
+	}
+	effectsWaitingForGroup.clear();
 }
 
-/* The general update function for all effects - calls a specific one for each. Returns false if effect should be deleted. */
-static bool updateEffect(EFFECT *psEffect)
+/* Calls all the update functions for each different currently active effect */
+void processEffects(const glm::mat4 &viewMatrix)
 {
-	/* What type of effect are we dealing with? */
-	switch (psEffect->group)
-	{
-	case EFFECT_EXPLOSION:
-		return updateExplosion(psEffect);
-	case EFFECT_WAYPOINT:
-		if (!gamePaused())
-		{
-			return updateWaypoint(psEffect);
-		}
-		return true;
-	case EFFECT_CONSTRUCTION:
-		if (!gamePaused())
-		{
-			return updateConstruction(psEffect);
-		}
-		return true;
-	case EFFECT_SMOKE:
-		if (!gamePaused())
-		{
-			return updatePolySmoke(psEffect);
-		}
-		return true;
-	case EFFECT_GRAVITON:
-		if (!gamePaused())
-		{
-			return updateGraviton(psEffect);
-		}
-		return true;
-	case EFFECT_BLOOD:
-		if (!gamePaused())
-		{
-			return updateBlood(psEffect);
-		}
-		return true;
-	case EFFECT_DESTRUCTION:
-		if (!gamePaused())
-		{
-			return updateDestruction(psEffect);
-		}
-		return true;
-	case EFFECT_FIRE:
-		if (!gamePaused())
-		{
-			return updateFire(psEffect);
-		}
-		return true;
-	case EFFECT_SAT_LASER:
-		if (!gamePaused())
-		{
-			return updateSatLaser(psEffect);
-		}
-		return true;
-	case EFFECT_FIREWORK:
-		if (!gamePaused())
-		{
-			return updateFirework(psEffect);
-		}
-		return true;
-	case EFFECT_FREED:
-		break;
-	}
-	debug(LOG_ERROR, "Weirdy class of effect passed to updateEffect");
-	abort();
+	processEffectGroup<updateExplosion>(effectGroups[EFFECT_EXPLOSION], true, viewMatrix);
+	processEffectGroup<updateWaypoint>(effectGroups[EFFECT_WAYPOINT], false, viewMatrix);
+	processEffectGroup<updateConstruction>(effectGroups[EFFECT_CONSTRUCTION], false, viewMatrix);
+	processEffectGroup<updatePolySmoke>(effectGroups[EFFECT_SMOKE], false, viewMatrix);
+	processEffectGroup<updateGraviton>(effectGroups[EFFECT_GRAVITON], false, viewMatrix);
+	processEffectGroup<updateBlood>(effectGroups[EFFECT_BLOOD], false, viewMatrix);
+	processEffectGroup<updateDestruction>(effectGroups[EFFECT_DESTRUCTION], false, viewMatrix);
+	processEffectGroup<updateFire>(effectGroups[EFFECT_FIRE], false, viewMatrix);
+	processEffectGroup<updateSatLaser>(effectGroups[EFFECT_SAT_LASER], false, viewMatrix);
+	processEffectGroup<updateFirework>(effectGroups[EFFECT_FIREWORK], false, viewMatrix);
+
+	/* Add any structure effects */
+	effectStructureUpdates();
 }
 
 // ----------------------------------------------------------------------------------------
@@ -2217,34 +2239,37 @@ bool writeFXData(const char *fileName)
 {
 	int i = 0;
 	WzConfig ini(fileName, WzConfig::ReadAndWrite);
-	for (auto iter = activeList.cbegin(); iter != activeList.end(); ++iter, i++)
-	{
-		EFFECT *it = *iter;
-		ini.beginGroup("effect_" + QString::number(i));
-		ini.setValue("control", it->control);
-		ini.setValue("group", it->group);
-		ini.setValue("type", it->type);
-		ini.setValue("frameNumber", it->frameNumber);
-		ini.setValue("size", it->size);
-		ini.setValue("baseScale", it->baseScale);
-		ini.setValue("specific", it->specific);
-		ini.setVector3f("position", it->position);
-		ini.setVector3f("velocity", it->velocity);
-		ini.setVector3i("rotation", it->rotation);
-		ini.setVector3i("spin", it->spin);
-		ini.setValue("birthTime", it->birthTime);
-		ini.setValue("lastFrame", it->lastFrame);
-		ini.setValue("frameDelay", it->frameDelay);
-		ini.setValue("lifeSpan", it->lifeSpan);
-		ini.setValue("radius", it->radius);
-
-		if (it->imd)
-		{
-			ini.setValue("imd_name", QString::fromStdString(modelName(it->imd)));
-		}
+	for (auto const &effects : effectGroups)
+	{
+		for (auto iter = effects.cbegin(); iter != effects.end(); ++iter, i++)
+		{
+			const EFFECT *it = &*iter;
+			ini.beginGroup("effect_" + QString::number(i));
+			ini.setValue("control", it->control);
+			ini.setValue("group", it->group);
+			ini.setValue("type", it->type);
+			ini.setValue("frameNumber", it->frameNumber);
+			ini.setValue("size", it->size);
+			ini.setValue("baseScale", it->baseScale);
+			ini.setValue("specific", it->specific);
+			ini.setVector3f("position", it->position);
+			ini.setVector3f("velocity", it->velocity);
+			ini.setVector3i("rotation", it->rotation);
+			ini.setVector3i("spin", it->spin);
+			ini.setValue("birthTime", it->birthTime);
+			ini.setValue("lastFrame", it->lastFrame);
+			ini.setValue("frameDelay", it->frameDelay);
+			ini.setValue("lifeSpan", it->lifeSpan);
+			ini.setValue("radius", it->radius);
+
+			if (it->imd)
+			{
+				ini.setValue("imd_name", QString::fromStdString(modelName(it->imd)));
+			}
 
-		// Move on to reading the next effect
-		ini.endGroup();
+			// Move on to reading the next effect
+			ini.endGroup();
+		}
 	}
 
 	// Everything is just fine!
@@ -2263,7 +2288,8 @@ bool readFXData(const char *fileName)
 	for (int i = 0; i < list.size(); ++i)
 	{
 		ini.beginGroup(list[i]);
-		EFFECT *curEffect = new EFFECT();
+		EFFECT effect;
+		EFFECT *curEffect = &effect;
 
 		curEffect->control      = ini.value("control").toInt();
 		curEffect->group        = (EFFECT_GROUP)ini.value("group").toInt();
@@ -2297,7 +2323,10 @@ bool readFXData(const char *fileName)
 		// Move on to reading the next effect
 		ini.endGroup();
 
-		activeList.push_back(curEffect);
+		if (curEffect->group < EFFECT_FREED)
+		{
+			allocateEffect(effect);
+		}
 	}
 
 	/* Hopefully everything's just fine by now */
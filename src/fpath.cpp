@@ -24,24 +24,30 @@
  *
  */
 
+#include <atomic>
 #include <future>
+#include <list>
 #include <unordered_map>
+#include <vector>
 
 #include "lib/framework/frame.h"
 #include "lib/framework/crc.h"
+#include "lib/framework/math_ext.h"
 #include "lib/netplay/netplay.h"
 
 #include "lib/framework/wzapp.h"
+#include "lib/framework/wzthreadpool.h"
 
 #include "objects.h"
 #include "map.h"
 #include "multiplay.h"
 #include "astar.h"
+#include "warzoneconfig.h"
 
 #include "fpath.h"
 
 // If the path finding system is shutdown or not
-static volatile bool fpathQuit = false;
+static std::atomic<bool> fpathQuit(false);
 
 /* Beware: Enabling this will cause significant slow-down. */
 #undef DEBUG_MAP
@@ -56,50 +62,93 @@ struct PATHRESULT
 
 
 // threading stuff
-static WZ_THREAD        *fpathThread = nullptr;
-static WZ_MUTEX         *fpathMutex = nullptr;
-static WZ_SEMAPHORE     *fpathSemaphore = nullptr;
 using packagedPathJob = wz::packaged_task<PATHRESULT()>;
-static std::list<packagedPathJob>    pathJobs;
+
+struct PATHLANEJOB
+{
+	packagedPathJob task;
+	int             queueTime;      ///< wzGetTicks() when the job was queued, for latency statistics.
+};
+
+struct PATHLANE
+{
+	std::list<PATHLANEJOB> jobs;    ///< Jobs waiting to be processed, in the order they were queued.
+	bool            busy = false;   ///< A thread is currently processing this lane.
+};
+
+static WZ_MUTEX         *fpathMutex = nullptr;
+static unsigned         pathWorkers = 0;   ///< Lane workers queued or running in the thread pool, protected by fpathMutex.
+static PATHLANE         pathLanes[FPATH_LANES];
+static unsigned         pathNextLane = 0;  ///< Where threads start looking for work, so that all lanes get served.
 static std::unordered_map<uint32_t, wz::future<PATHRESULT>> pathResults;
 
-static bool             waitingForResult = false;
-static uint32_t         waitingForResultId;
-static WZ_SEMAPHORE     *waitingForResultSemaphore = nullptr;
+// statistics, protected by fpathMutex
+static unsigned         pathJobsQueued = 0;
+static unsigned         pathMaxJobsQueued = 0;
+static unsigned         pathJobsCompleted = 0;
+static uint64_t         pathTotalLatency = 0;
+static unsigned         pathMaxLatency = 0;
 
-static PATHRESULT fpathExecute(PATHJOB psJob);
+static PATHRESULT fpathExecute(PATHJOB psJob, unsigned lane);
 
 
-/** This runs in a separate thread */
-static int fpathThreadFunc(void *)
+/** Runs in the thread pool, emptying lanes until there are none left which no other worker is processing. */
+static void fpathLaneWorker()
 {
 	wzMutexLock(fpathMutex);
 
 	while (!fpathQuit)
 	{
-		if (pathJobs.empty())
+		// Find a lane with jobs, which no other worker is processing.
+		unsigned laneIndex = 0;
+		PATHLANE *lane = nullptr;
+		for (unsigned i = 0; i < FPATH_LANES && lane == nullptr; ++i)
 		{
-			ASSERT(!waitingForResult, "Waiting for a result (id %u) that doesn't exist.", waitingForResultId);
-			wzMutexUnlock(fpathMutex);
-			wzSemaphoreWait(fpathSemaphore);  // Go to sleep until needed.
-			wzMutexLock(fpathMutex);
-			continue;
+			laneIndex = (pathNextLane + i) % FPATH_LANES;
+			if (!pathLanes[laneIndex].busy && !pathLanes[laneIndex].jobs.empty())
+			{
+				lane = &pathLanes[laneIndex];
+			}
 		}
+		if (lane == nullptr)
+		{
+			break;  // Nothing to do, give the pool thread back. fpathRoute queues a new worker when needed.
+		}
+		pathNextLane = (laneIndex + 1) % FPATH_LANES;
 
-		// Copy the first job from the queue.
-		packagedPathJob job = std::move(pathJobs.front());
-		pathJobs.pop_front();
+		// Empty the lane. The jobs in a lane share their A* contexts, so must be processed in order by a single worker.
+		lane->busy = true;
+		while (!lane->jobs.empty() && !fpathQuit)
+		{
+			PATHLANEJOB job = std::move(lane->jobs.front());
+			lane->jobs.pop_front();
+			--pathJobsQueued;
 
-		wzMutexUnlock(fpathMutex);
-		job();
-		wzMutexLock(fpathMutex);
+			wzMutexUnlock(fpathMutex);
+			job.task();
+			unsigned latency = wzGetTicks() - job.queueTime;
+			wzMutexLock(fpathMutex);
 
-		waitingForResult = false;
-		objTrace(waitingForResultId, "These are the droids you are looking for.");
-		wzSemaphorePost(waitingForResultSemaphore);
+			++pathJobsCompleted;
+			pathTotalLatency += latency;
+			pathMaxLatency = std::max(pathMaxLatency, latency);
+		}
+		lane->busy = false;
 	}
+	--pathWorkers;
 	wzMutexUnlock(fpathMutex);
-	return 0;
+}
+
+
+/** Number of lanes which may be processed at once, at most one per thread in the pool by default. */
+static unsigned fpathThreadCount()
+{
+	int threads = war_GetPathThreads();
+	if (threads == 0)
+	{
+		threads = wzThreadPoolSize();
+	}
+	return clip(threads, 1, FPATH_LANES);
 }
 
 
@@ -109,13 +158,10 @@ bool fpathInitialise()
 	// The path system is up
 	fpathQuit = false;
 
-	if (!fpathThread)
+	if (fpathMutex == nullptr)
 	{
 		fpathMutex = wzMutexCreate();
-		fpathSemaphore = wzSemaphoreCreate(0);
-		waitingForResultSemaphore = wzSemaphoreCreate(0);
-		fpathThread = wzThreadCreate(fpathThreadFunc, nullptr);
-		wzThreadStart(fpathThread);
+		debug(LOG_INFO, "Using up to %u path-finding workers", fpathThreadCount());
 	}
 
 	return true;
@@ -124,20 +170,29 @@ bool fpathInitialise()
 
 void fpathShutdown()
 {
-	// Signal the path finding thread to quit
+	// Signal the path finding workers to quit
 	fpathQuit = true;
-	wzSemaphorePost(fpathSemaphore);  // Wake up thread.
 
-	if (fpathThread)
+	if (fpathMutex != nullptr)
 	{
-		wzThreadJoin(fpathThread);
-		fpathThread = nullptr;
+		// Wait for the workers to finish their current job and leave.
+		wzMutexLock(fpathMutex);
+		while (pathWorkers != 0)
+		{
+			wzMutexUnlock(fpathMutex);
+			wzYieldCurrentThread();
+			wzMutexLock(fpathMutex);
+		}
+		// Drop the jobs nobody will process now, so that no lane is left waiting for a worker.
+		for (PATHLANE &lane : pathLanes)
+		{
+			lane.jobs.clear();
+		}
+		pathResults.clear();
+		pathJobsQueued = 0;
+		wzMutexUnlock(fpathMutex);
 		wzMutexDestroy(fpathMutex);
 		fpathMutex = nullptr;
-		wzSemaphoreDestroy(fpathSemaphore);
-		fpathSemaphore = nullptr;
-		wzSemaphoreDestroy(waitingForResultSemaphore);
-		waitingForResultSemaphore = nullptr;
 	}
 	fpathHardTableReset();
 }
@@ -312,6 +367,17 @@ void fpathRemoveDroidData(int id)
 	pathResults.erase(id);
 }
 
+/** Choose the lane for a job.
+ *
+ *  Jobs to the same destination go to the same lane, so that they can reuse the A* contexts of that lane. Must
+ *  only depend on the job itself, since the paths found in a lane depend on which jobs were processed before.
+ */
+static unsigned fpathJobLane(PATHJOB const &job)
+{
+	uint32_t hash = map_coord(job.destX) * 2654435761u ^ map_coord(job.destY) * 2246822519u;
+	return (hash >> 16) % FPATH_LANES;
+}
+
 static FPATH_RETVAL fpathRoute(MOVE_CONTROL *psMove, unsigned id, int startX, int startY, int tX, int tY, PROPULSION_TYPE propulsionType,
                                DROID_TYPE droidType, FPATH_MOVETYPE moveType, int owner, bool acceptNearest, StructureBounds const &dstStructure)
 {
@@ -385,6 +451,7 @@ queuePathfinding:
 	job.owner = owner;
 	job.acceptNearest = acceptNearest;
 	job.deleted = false;
+	job.searchMode = game.pathSearch < FSM_NUM ? (FPATH_SEARCH_MODE)game.pathSearch : FSM_CLASSIC;
 	fpathSetBlockingMap(&job);
 
 	debug(LOG_NEVER, "starting new job for droid %d 0x%x", id, id);
@@ -392,21 +459,29 @@ queuePathfinding:
 	// job or result for each droid in the system at any time.
 	fpathRemoveDroidData(id);
 
-	packagedPathJob task([job]() { return fpathExecute(job); });
+	unsigned lane = fpathJobLane(job);
+	packagedPathJob task([job, lane]() { return fpathExecute(job, lane); });
 	pathResults[id] = task.get_future();
 
-	// Add to end of list
+	// Add to end of the lane
 	wzMutexLock(fpathMutex);
-	bool isFirstJob = pathJobs.empty();
-	pathJobs.push_back(std::move(task));
+	bool isFirstJob = pathLanes[lane].jobs.empty();
+	pathLanes[lane].jobs.push_back(PATHLANEJOB{std::move(task), wzGetTicks()});
+	++pathJobsQueued;
+	pathMaxJobsQueued = std::max(pathMaxJobsQueued, pathJobsQueued);
+	bool startWorker = isFirstJob && pathWorkers < fpathThreadCount();
+	if (startWorker)
+	{
+		++pathWorkers;
+	}
 	wzMutexUnlock(fpathMutex);
 
-	if (isFirstJob)
+	if (startWorker)
 	{
-		wzSemaphorePost(fpathSemaphore);  // Wake up processing thread.
+		wzThreadPoolRun(fpathLaneWorker);  // Workers already running pick up the lane otherwise, before they leave.
 	}
 
-	objTrace(id, "Queued up a path-finding request to (%d, %d), at least %d items earlier in queue", tX, tY, isFirstJob);
+	objTrace(id, "Queued up a path-finding request to (%d, %d) in lane %u, at least %d items earlier in lane", tX, tY, lane, !isFirstJob);
 	syncDebug("fpathRoute(..., %d, %d, %d, %d, %d, %d, %d, %d, %d) = FPR_WAIT", id, startX, startY, tX, tY, propulsionType, droidType, moveType, owner);
 	return FPR_WAIT;	// wait while polling result queue
 }
@@ -456,8 +531,8 @@ FPATH_RETVAL fpathDroidRoute(DROID *psDroid, SDWORD tX, SDWORD tY, FPATH_MOVETYP
 	                  psDroid->droidType, moveType, psDroid->player, acceptNearest, dstStructure);
 }
 
-// Run only from path thread
-PATHRESULT fpathExecute(PATHJOB job)
+// Run only from path threads
+PATHRESULT fpathExecute(PATHJOB job, unsigned lane)
 {
 	PATHRESULT result;
 	result.droidID = job.droidID;
@@ -465,7 +540,7 @@ PATHRESULT fpathExecute(PATHJOB job)
 	result.retval = FPR_FAILED;
 	result.originalDest = Vector2i(job.destX, job.destY);
 
-	ASR_RETVAL retval = fpathAStarRoute(&result.sMove, &job);
+	ASR_RETVAL retval = fpathAStarRoute(lane, &result.sMove, &job);
 
 	ASSERT(retval != ASR_OK || result.sMove.asPath, "Ok result but no path in result");
 	ASSERT(retval == ASR_FAILED || result.sMove.numPoints > 0, "Ok result but no length of path in result");
@@ -511,12 +586,41 @@ static int fpathJobQueueLength()
 	int count = 0;
 
 	wzMutexLock(fpathMutex);
-	count = pathJobs.size();  // O(N) function call for std::list. .empty() is faster, but this function isn't used except in tests.
+	for (PATHLANE const &lane : pathLanes)
+	{
+		count += lane.jobs.size();  // O(N) function call for std::list. .empty() is faster, but this function isn't used except in tests.
+	}
 	wzMutexUnlock(fpathMutex);
 	return count;
 }
 
 
+FPATH_STATISTICS fpathGetStatistics()
+{
+	FPATH_STATISTICS stats;
+
+	stats.threads = fpathThreadCount();
+	ASR_ROUTE_CACHE_STATISTICS routeStats = fpathAStarRouteCacheStatistics();
+	stats.routeLookups = routeStats.lookups;
+	stats.routeHits = routeStats.hits;
+	stats.routeNodes = routeStats.avgNodesPerSearch;
+	if (fpathMutex == nullptr)
+	{
+		stats.queued = stats.maxQueued = stats.completed = stats.avgLatency = stats.maxLatency = 0;
+		return stats;
+	}
+
+	wzMutexLock(fpathMutex);
+	stats.queued = pathJobsQueued;
+	stats.maxQueued = pathMaxJobsQueued;
+	stats.completed = pathJobsCompleted;
+	stats.avgLatency = pathJobsCompleted != 0 ? pathTotalLatency / pathJobsCompleted : 0;
+	stats.maxLatency = pathMaxLatency;
+	wzMutexUnlock(fpathMutex);
+	return stats;
+}
+
+
 /** Find the length of the result queue, excepting future results. Function is thread-safe. */
 static int fpathResultQueueLength()
 {
@@ -545,10 +649,8 @@ void fpathTest(int x, int y, int x2, int y2)
 	(void)fpathJobQueueLength;
 
 	/* Check initial state */
-	assert(fpathThread != nullptr);
 	assert(fpathMutex != nullptr);
-	assert(fpathSemaphore != nullptr);
-	assert(pathJobs.empty());
+	assert(fpathJobQueueLength() == 0);
 	assert(pathResults.empty());
 	fpathRemoveDroidData(0);	// should not crash
 
@@ -616,7 +718,7 @@ void fpathTest(int x, int y, int x2, int y2)
 	{
 		fpathRemoveDroidData(i);
 	}
-	//assert(pathJobs.empty()); // can now be marked .deleted as well
+	//assert(fpathJobQueueLength() == 0); // can now be marked .deleted as well
 	assert(pathResults.empty());
 	(void)r;  // Squelch unused-but-set warning.
 }
@@ -42,6 +42,24 @@ enum FPATH_MOVETYPE
 	FMT_BLOCK,              ///< Don't go through obstacles, not even gates.
 };
 
+/** Number of path-finding lanes.
+ *
+ *  Jobs are distributed over the lanes by destination, and each lane is processed in order by at most one
+ *  thread at a time, with its own cache of A* contexts. Since the lane of a job never depends on the number
+ *  of threads, the resulting paths are identical on all clients. Changing this breaks multiplayer sync.
+ */
+#define FPATH_LANES 8
+
+/** Search strategy used for routing. Routes differ between strategies, so it must be the same on all clients.
+ */
+enum FPATH_SEARCH_MODE
+{
+	FSM_CLASSIC,            ///< A* tile by tile over the whole map.
+	FSM_HIERARCHICAL,       ///< A* over a graph of map clusters, refined by A* restricted to the clusters on the way.
+	FSM_JPS,                ///< A* jumping over open terrain instead of adding every tile to the open list (Jump Point Search).
+	FSM_NUM
+};
+
 struct PathBlockingMap;
 
 struct PATHJOB
@@ -56,6 +74,7 @@ struct PATHJOB
 	int		owner;		///< Player owner
 	std::shared_ptr<PathBlockingMap> blockingMap;   ///< Map of blocking tiles.
 	bool		acceptNearest;
+	FPATH_SEARCH_MODE searchMode;   ///< How to search for the route.
 	bool            deleted;        ///< Droid was deleted, so throw away result when complete. Must still process this PATHJOB, since processing order can affect resulting paths (but can't affect the path length).
 };
 
@@ -66,6 +85,20 @@ enum FPATH_RETVAL
 	FPR_WAIT,       ///< route is being calculated by the path-finding thread
 };
 
+/// Path-finding thread pool statistics, for debug output.
+struct FPATH_STATISTICS
+{
+	unsigned threads;       ///< Number of path-finding worker threads.
+	unsigned queued;        ///< Number of jobs currently waiting to be processed.
+	unsigned maxQueued;     ///< Largest number of jobs waiting at the same time.
+	unsigned completed;     ///< Number of jobs processed so far.
+	unsigned avgLatency;    ///< Average time in milliseconds from queueing a job to completing it.
+	unsigned maxLatency;    ///< Longest time in milliseconds from queueing a job to completing it.
+	unsigned routeLookups;  ///< Number of routes requested from the route cache.
+	unsigned routeHits;     ///< Number of routes which joined a cached route instead of searching.
+	unsigned routeNodes;    ///< Average number of nodes expanded per search, for estimating the work saved by the route cache.
+};
+
 /** Initialise the path-finding module.
  */
 bool fpathInitialise();
@@ -121,6 +154,9 @@ void fpathRemoveDroidData(int id);
  *  using the given propulsion type. orig and dest are in world coordinates. */
 bool fpathCheck(Position orig, Position dest, PROPULSION_TYPE propulsion);
 
+/** Get the path-finding thread pool statistics. Function is thread-safe. */
+FPATH_STATISTICS fpathGetStatistics();
+
 /** Unit testing. */
 void fpathTest(int x, int y, int x2, int y2);
 
@@ -31,6 +31,7 @@
 #include "group.h"
 #include "droid.h"
 #include "order.h"
+#include "objmem.h"
 #include <QtCore/QMap>
 
 // Group system variables: grpGlobalManager enables to remove all the groups to Shutdown the system
@@ -139,6 +140,11 @@ void DROID_GROUP::add(DROID *psDroid)
 		{
 			psDroid->psGrpNext = psList;
 			psList = psDroid;
+			if (type == GT_TRANSPORTER)
+			{
+				// Droids loaded from a savegame straight into a transporter are never on an object list.
+				objIdIndexAdd(psDroid);
+			}
 		}
 
 		if (type == GT_COMMAND)
@@ -31,6 +31,7 @@
 #include "lib/framework/file.h"
 #include "lib/framework/physfs_ext.h"
 #include "lib/framework/wzapp.h"
+#include "lib/framework/wzthreadpool.h"
 #include "lib/ivis_opengl/piemode.h"
 #include "lib/ivis_opengl/piestate.h"
 #include "lib/ivis_opengl/screen.h"
@@ -768,6 +769,7 @@ void systemShutdown()
 	widgShutDown();
 	fpathShutdown();
 	mapShutdown();
+	wzThreadPoolShutdown();
 	debug(LOG_MAIN, "shutting down everything else");
 	pal_ShutDown();		// currently unused stub
 	frameShutDown();	// close screen / SDL / resources / cursors / trig
@@ -1021,6 +1023,7 @@ bool stageOneShutDown()
 	}
 
 	scrShutDown();
+	visShutdown();
 	gridShutDown();
 
 	debug(LOG_TEXTURE, "== stageOneShutDown ==");
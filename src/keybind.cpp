@@ -82,6 +82,7 @@
 #include "template.h"
 #include "qtscript.h"
 #include "multigifts.h"
+#include "fpath.h"
 
 /*
 	KeyBind.c
@@ -638,8 +639,8 @@ void kf_ToggleOrders()	// Displays orders & action of currently selected unit.
 /* Writes out the frame rate */
 void	kf_FrameRate()
 {
-	CONPRINTF(ConsoleString, (ConsoleString, "FPS %d; PIEs %d; polys %d",
-	                          frameRate(), loopPieCount, loopPolyCount));
+	CONPRINTF(ConsoleString, (ConsoleString, "FPS %d; PIEs %d; polys %d; draw calls %d (%d saved by instancing)",
+	                          frameRate(), loopPieCount, loopPolyCount, loopDrawCallCount, loopDrawCallsSaved));
 	if (runningMultiplayer())
 	{
 		CONPRINTF(ConsoleString, (ConsoleString, "NETWORK:  Bytes: s-%d r-%d  Uncompressed Bytes: s-%d r-%d  Packets: s-%d r-%d",
@@ -650,6 +651,12 @@ void	kf_FrameRate()
 		                          NETgetStatistic(NetStatisticPackets, true),
 		                          NETgetStatistic(NetStatisticPackets, false)));
 	}
+	FPATH_STATISTICS pathStats = fpathGetStatistics();
+	CONPRINTF(ConsoleString, (ConsoleString, "PATHFINDING:  Threads: %u  Queued: %u (max %u)  Jobs: %u  Latency: avg %ums max %ums",
+	                          pathStats.threads, pathStats.queued, pathStats.maxQueued, pathStats.completed, pathStats.avgLatency, pathStats.maxLatency));
+	CONPRINTF(ConsoleString, (ConsoleString, "ROUTE CACHE:  Hits: %u of %u (%u%%)  Nodes per search: %u  Nodes saved: %llu",
+	                          pathStats.routeHits, pathStats.routeLookups, pathStats.routeLookups != 0 ? (unsigned)((uint64_t)pathStats.routeHits * 100 / pathStats.routeLookups) : 0,
+	                          pathStats.routeNodes, (unsigned long long)pathStats.routeHits * pathStats.routeNodes));
 	gameStats = !gameStats;
 	CONPRINTF(ConsoleString, (ConsoleString, "Built at %s on %s", __TIME__, __DATE__));
 }
@@ -773,6 +780,14 @@ void	kf_TileInfo()
 	addConsoleMessage("Tile info dumped into log", DEFAULT_JUSTIFY, SYSTEM_MESSAGE);
 }
 
+void kf_ToggleInstancing()
+{
+	static bool instancing = true;
+	instancing = !instancing;
+	bool on = pie_setInstancing(instancing);
+	CONPRINTF(ConsoleString, (ConsoleString, "Instanced drawing is %s%s", on ? "Enabled" : "Disabled", instancing && !on ? " (not supported)" : ""));
+}
+
 /* Toggles fog on/off */
 void	kf_ToggleFog()
 {
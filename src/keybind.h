@@ -254,6 +254,7 @@ void kf_ToggleRadarTerrain();            //radar terrain
 void kf_ToggleRadarAllyEnemy();          //enemy/ally color toggle
 
 void kf_TileInfo();
+void kf_ToggleInstancing();
 
 void kf_NoAssert();
 
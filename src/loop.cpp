@@ -85,6 +85,7 @@
 #include "random.h"
 #include "qtscript.h"
 #include "version.h"
+#include "benchmark.h"
 
 #include "warzoneconfig.h"
 
@@ -102,6 +103,8 @@ static void fireWaitingCallbacks();
  */
 unsigned int loopPieCount;
 unsigned int loopPolyCount;
+unsigned int loopDrawCallCount;
+unsigned int loopDrawCallsSaved;
 
 /*
  * local variables
@@ -339,7 +342,7 @@ static GAMECODE renderLoop()
 
 	wzSetCursor(cursor);
 
-	pie_GetResetCounts(&loopPieCount, &loopPolyCount);
+	pie_GetResetCounts(&loopPieCount, &loopPolyCount, &loopDrawCallCount, &loopDrawCallsSaved);
 
 	if (!quitting)
 	{
@@ -707,6 +710,8 @@ GAMECODE gameLoop()
 		ASSERT(deltaGraphicsTime == 0, "Shouldn't update graphics and game state at once.");
 	}
 
+	benchmarkUpdate();
+
 	if (realTime - lastFlushTime >= 400u)
 	{
 		lastFlushTime = realTime;
@@ -55,6 +55,8 @@ extern LEVEL_TYPE nextMissionType;
 
 extern unsigned int loopPieCount;
 extern unsigned int loopPolyCount;
+extern unsigned int loopDrawCallCount;
+extern unsigned int loopDrawCallsSaved;
 
 GAMECODE gameLoop();
 void videoLoop();
@@ -24,11 +24,16 @@
  *
  */
 #include <time.h>
+#include <queue>
+#include <list>
+#include <atomic>
+#include <memory>
 
 #include "lib/framework/frame.h"
 #include "lib/framework/endian_hack.h"
 #include "lib/framework/file.h"
 #include "lib/framework/physfs_ext.h"
+#include "lib/framework/math_ext.h"
 #include "lib/ivis_opengl/tex.h"
 #include "lib/netplay/netplay.h"  // For syncDebug
 
@@ -50,21 +55,76 @@
 #include "levels.h"
 #include "scriptfuncs.h"
 #include "lib/framework/wzapp.h"
+#include "lib/framework/wzthreadpool.h"
 
 #define GAME_TICKS_FOR_DANGER (GAME_TICKS_PER_SEC * 2)
 
-static WZ_THREAD *dangerThread = nullptr;
-static WZ_SEMAPHORE *dangerSemaphore = nullptr;
-static WZ_SEMAPHORE *dangerDoneSemaphore = nullptr;
 struct floodtile
 {
 	uint8_t x;
 	uint8_t y;
 };
-static struct floodtile *floodbucket = nullptr;
-static int bucketcounter;
+
+/// A droid or structure which can shoot, as it was when the danger maps were started.
+struct DangerThreat
+{
+	int owner;
+	bool ground, air;
+	uint32_t visibleTo;             ///< Bit for each player which can see the object.
+	unsigned firstTile, numTiles;   ///< Tiles the object can see, in dangerThreatTiles.
+};
+
+/// Danger map job, run once by either a pool thread or dangerMapsFinish, whichever gets to it first.
+struct DangerJob
+{
+	template <typename F>
+	explicit DangerJob(F &&f) : task(std::forward<F>(f)) {}
+
+	wz::packaged_task<int()> task;
+	std::atomic<bool> started{false};
+
+	void runOnce()
+	{
+		if (!started.exchange(true))
+		{
+			task();
+		}
+	}
+};
+
+/// Danger map calculation for one player. Worker threads write the new map into aux, while the game keeps using the player's aux map.
+struct DangerMap
+{
+	std::vector<uint8_t> aux;               ///< Copy of the player's aux map, getting the new danger and threat bits.
+	std::vector<floodtile> floodbucket;     ///< Open list of the flood fill.
+	Vector2i start;                         ///< Player start position, where the flood fill starts.
+	std::shared_ptr<DangerJob> job;         ///< Set while the job is queued or running.
+	wz::future<int> done;
+};
+
+static DangerMap dangerMaps[MAX_PLAYERS];
+// Inputs shared by all the danger map jobs, only changed while no jobs are running.
+static std::vector<DangerThreat> dangerThreats;
+static std::vector<TILEPOS> dangerThreatTiles;
+static bool dangerAllied[MAX_PLAYERS][MAX_PLAYERS];
 static UDWORD lastDangerUpdate = 0;
-static int lastDangerPlayer = -1;
+
+static void dangerMapsFinish();
+
+/// A burning tile, ordered by when the fire ends, and then in the order the tiles are stored in.
+struct TileFire
+{
+	bool operator >(TileFire const &z) const
+	{
+		return endTime != z.endTime ? endTime > z.endTime : y != z.y ? y > z.y : x > z.x;
+	}
+
+	uint32_t endTime;       ///< The gameTime / GAME_TICKS_PER_UPDATE that the fire ends, without wrapping around like fireEndTime.
+	uint16_t y, x;
+	MAPTILE const *tiles;   ///< The psMapTiles the tile is in, since campaign missions swap maps. Only used for comparing.
+};
+/// Burning tiles, soonest to be extinguished first. May contain tiles which are no longer burning, or which burn for longer.
+static std::priority_queue<TileFire, std::vector<TileFire>, std::greater<TileFire>> tileFires;
 
 //scroll min and max values
 SDWORD		scrollMinX, scrollMaxX, scrollMinY, scrollMaxY;
@@ -107,6 +167,8 @@ SDWORD	mapWidth = 0, mapHeight = 0;
 MAPTILE	*psMapTiles = nullptr;
 uint8_t *psBlockMap[AUX_MAX];
 uint8_t *psAuxMap[MAX_PLAYERS + AUX_MAX];        // yes, we waste one element... eyes wide open... makes API nicer
+std::vector<int> auxChangedTiles;
+uint32_t auxChangedTilesStart = 0;
 
 #define WATER_MIN_DEPTH 500
 #define WATER_MAX_DEPTH (WATER_MIN_DEPTH + 400)
@@ -883,6 +945,7 @@ bool mapLoad(char *filename, bool preview)
 	{
 		psAuxMap[x] = (uint8_t *)malloc(mapWidth * mapHeight * sizeof(*psAuxMap[0]));
 	}
+	auxForgetChanges();
 
 	// Set our blocking bits
 	for (y = 0; y < mapHeight; y++)
@@ -1018,19 +1081,22 @@ bool mapShutdown()
 {
 	int x;
 
-	if (dangerThread)
+	dangerMapsFinish();
+	for (DangerMap &danger : dangerMaps)
 	{
-		wzSemaphoreWait(dangerDoneSemaphore);
-		lastDangerPlayer = -1;
-		wzSemaphorePost(dangerSemaphore);
-		wzThreadJoin(dangerThread);
-		wzSemaphoreDestroy(dangerSemaphore);
-		wzSemaphoreDestroy(dangerDoneSemaphore);
-		dangerThread = nullptr;
-		dangerSemaphore = nullptr;
-		dangerDoneSemaphore = nullptr;
+		danger = DangerMap();
 	}
 
+	// Forget the fires on this map, but not on a map swapped out by a campaign mission.
+	std::vector<TileFire> otherFires;
+	for (; !tileFires.empty(); tileFires.pop())
+	{
+		if (tileFires.top().tiles != psMapTiles)
+		{
+			otherFires.push_back(tileFires.top());
+		}
+	}
+	tileFires = decltype(tileFires)(std::greater<TileFire>(), std::move(otherFires));
 	free(psMapTiles);
 	delete[] mapDecals;
 	free(psGroundTypes);
@@ -1041,16 +1107,15 @@ bool mapShutdown()
 	free(psBlockMap[AUX_ASTARMAP]);
 	psBlockMap[AUX_ASTARMAP] = nullptr;
 	free(psBlockMap[AUX_DANGERMAP]);
-	free(floodbucket);
 	psBlockMap[AUX_DANGERMAP] = nullptr;
 	for (x = 0; x < MAX_PLAYERS + AUX_MAX; x++)
 	{
 		free(psAuxMap[x]);
 		psAuxMap[x] = nullptr;
 	}
+	auxForgetChanges();
 
 	map = nullptr;
-	floodbucket = nullptr;
 	psGroundTypes = nullptr;
 	mapDecals = nullptr;
 	psMapTiles = nullptr;
@@ -1761,6 +1826,12 @@ void tileSetFire(int32_t x, int32_t y, uint32_t duration)
 	// Burn, tile, burn!
 	tile->tileInfoBits |= BITS_ON_FIRE;
 	tile->fireEndTime = fireEndTime;
+	TileFire fire;
+	fire.endTime = gameTime / GAME_TICKS_PER_UPDATE + (uint16_t)(fireEndTime - currentTime);
+	fire.y = posY;
+	fire.x = posX;
+	fire.tiles = psMapTiles;
+	tileFires.push(fire);
 
 	syncDebug("Fire tile{%d, %d} dur%u end%d", posX, posY, duration, fireEndTime);
 }
@@ -1777,33 +1848,29 @@ bool fireOnLocation(unsigned int x, unsigned int y)
 }
 
 // This function runs in a separate thread!
-static int dangerFloodFill(int player)
+static void dangerFloodFill(DangerMap &danger)
 {
-	int i;
-	Vector2i pos = getPlayerStartPosition(player);
+	uint8_t *const aux = danger.aux.data();
+	uint8_t const *const blockMap = psBlockMap[AUX_DANGERMAP];
+	Vector2i pos = danger.start;
 	Vector2i npos;
-	uint8_t aux, block;
-	int x, y;
+	uint8_t block;
 	bool start = true;	// hack to disregard the blocking status of any building exactly on the starting position
 
 	// Set our danger bits
-	for (y = 0; y < mapHeight; y++)
+	for (int i = 0; i < mapWidth * mapHeight; i++)
 	{
-		for (x = 0; x < mapWidth; x++)
-		{
-			auxSet(x, y, MAX_PLAYERS + AUX_DANGERMAP, AUXBITS_DANGER);
-			auxClear(x, y, MAX_PLAYERS + AUX_DANGERMAP, AUXBITS_TEMPORARY);
-		}
+		aux[i] = (aux[i] | AUXBITS_DANGER) & ~AUXBITS_TEMPORARY;
 	}
 
 	pos.x = map_coord(pos.x);
 	pos.y = map_coord(pos.y);
-	bucketcounter = 0;
+	danger.floodbucket.clear();
 
 	do
 	{
 		// Add accessible neighbouring tiles to the open list
-		for (i = 0; i < NUM_DIR; i++)
+		for (int i = 0; i < NUM_DIR; i++)
 		{
 			npos.x = pos.x + aDirOffset[i].x;
 			npos.y = pos.y + aDirOffset[i].y;
@@ -1811,103 +1878,110 @@ static int dangerFloodFill(int player)
 			{
 				continue;
 			}
-			aux = auxTile(npos.x, npos.y, MAX_PLAYERS + AUX_DANGERMAP);
-			block = blockTile(pos.x, pos.y, AUX_DANGERMAP);
-			if (!(aux & AUXBITS_TEMPORARY) && !(aux & AUXBITS_THREAT) && (aux & AUXBITS_DANGER))
+			uint8_t &naux = aux[npos.x + npos.y * mapWidth];
+			block = blockMap[pos.x + pos.y * mapWidth];
+			if (!(naux & AUXBITS_TEMPORARY) && !(naux & AUXBITS_THREAT) && (naux & AUXBITS_DANGER))
 			{
 				// Note that we do not consider water to be a blocker here. This may or may not be a feature...
-				if (!(block & FEATURE_BLOCKED) && (!(aux & AUXBITS_NONPASSABLE) || start))
+				if (!(block & FEATURE_BLOCKED) && (!(naux & AUXBITS_NONPASSABLE) || start))
 				{
-					floodbucket[bucketcounter].x = npos.x;
-					floodbucket[bucketcounter].y = npos.y;
-					bucketcounter++;
-					if (start && !(aux & AUXBITS_NONPASSABLE))
+					floodtile tile;
+					tile.x = npos.x;
+					tile.y = npos.y;
+					danger.floodbucket.push_back(tile);
+					if (start && !(naux & AUXBITS_NONPASSABLE))
 					{
 						start = false;
 					}
 				}
 				else
 				{
-					auxClear(npos.x, npos.y, MAX_PLAYERS + AUX_DANGERMAP, AUXBITS_DANGER);
+					naux &= ~AUXBITS_DANGER;
 				}
-				auxSet(npos.x, npos.y, MAX_PLAYERS + AUX_DANGERMAP, AUXBITS_TEMPORARY); // make sure we do not process it more than once
+				naux |= AUXBITS_TEMPORARY; // make sure we do not process it more than once
 			}
 		}
 
 		// Clear danger
-		auxClear(pos.x, pos.y, MAX_PLAYERS + AUX_DANGERMAP, AUXBITS_DANGER);
+		aux[pos.x + pos.y * mapWidth] &= ~AUXBITS_DANGER;
 
 		// Pop the last open node off the bucket list for the next iteration
-		if (bucketcounter)
+		if (!danger.floodbucket.empty())
 		{
-			bucketcounter--;
-			pos.x = floodbucket[bucketcounter].x;
-			pos.y = floodbucket[bucketcounter].y;
+			pos.x = danger.floodbucket.back().x;
+			pos.y = danger.floodbucket.back().y;
+			danger.floodbucket.pop_back();
 		}
 	}
-	while (bucketcounter);
-	return 0;
+	while (!danger.floodbucket.empty());
 }
 
 // This function runs in a separate thread!
-static int dangerThreadFunc(WZ_DECL_UNUSED void *data)
+static void threatUpdate(int player, DangerMap &danger)
 {
-	while (lastDangerPlayer != -1)
+	uint8_t *const aux = danger.aux.data();
+
+	// Step 1: Clear our threat bits
+	for (int i = 0; i < mapWidth * mapHeight; i++)
 	{
-		dangerFloodFill(lastDangerPlayer);	// Do the actual work
-		wzSemaphorePost(dangerDoneSemaphore);   // Signal that we are done
-		wzSemaphoreWait(dangerSemaphore);	// Go to sleep until needed.
+		aux[i] &= ~(AUXBITS_THREAT | AUXBITS_AATHREAT);
 	}
-	return 0;
-}
 
-static inline void threatUpdateTarget(int player, BASE_OBJECT *psObj, bool ground, bool air)
-{
-	int i;
-
-	if (psObj->visible[player] || psObj->born == 2)
+	// Step 2: Set threat bits
+	for (DangerThreat const &threat : dangerThreats)
 	{
-		for (i = 0; i < psObj->numWatchedTiles; i++)
+		if (dangerAllied[player][threat.owner] || !(threat.visibleTo & 1 << player))
 		{
-			const TILEPOS pos = psObj->watchedTiles[i];
+			continue;
+		}
+		for (unsigned i = threat.firstTile; i < threat.firstTile + threat.numTiles; i++)
+		{
+			const TILEPOS pos = dangerThreatTiles[i];
 
-			if (ground)
+			if (threat.ground)
 			{
-				auxSet(pos.x, pos.y, MAX_PLAYERS + AUX_DANGERMAP, AUXBITS_THREAT);	// set ground threat for this tile
+				aux[pos.x + pos.y * mapWidth] |= AUXBITS_THREAT;	// set ground threat for this tile
 			}
-			if (air)
+			if (threat.air)
 			{
-				auxSet(pos.x, pos.y, MAX_PLAYERS + AUX_DANGERMAP, AUXBITS_AATHREAT);	// set air threat for this tile
+				aux[pos.x + pos.y * mapWidth] |= AUXBITS_AATHREAT;	// set air threat for this tile
 			}
 		}
 	}
 }
 
-static void threatUpdate(int player)
+static inline void threatAddTarget(BASE_OBJECT *psObj, bool ground, bool air)
 {
-	int i, weapon, x, y;
-
-	// Step 1: Clear our threat bits
-	for (y = 0; y < mapHeight; y++)
+	DangerThreat threat;
+	threat.owner = psObj->player;
+	threat.ground = ground;
+	threat.air = air;
+	threat.visibleTo = 0;
+	for (int player = 0; player < MAX_PLAYERS; player++)
 	{
-		for (x = 0; x < mapWidth; x++)
+		if (psObj->visible[player] || psObj->born == 2)
 		{
-			auxClear(x, y, MAX_PLAYERS + AUX_DANGERMAP, AUXBITS_THREAT | AUXBITS_AATHREAT);
+			threat.visibleTo |= 1 << player;
 		}
 	}
+	threat.firstTile = dangerThreatTiles.size();
+	threat.numTiles = psObj->numWatchedTiles;
+	dangerThreatTiles.insert(dangerThreatTiles.end(), psObj->watchedTiles, psObj->watchedTiles + psObj->numWatchedTiles);
+	dangerThreats.push_back(threat);
+}
 
-	// Step 2: Set threat bits
-	for (i = 0; i < MAX_PLAYERS; i++)
+/// Collects the objects which can shoot, for the danger map jobs to read while the game goes on.
+static void threatCollect()
+{
+	int weapon;
+
+	dangerThreats.clear();
+	dangerThreatTiles.clear();
+	for (int i = 0; i < MAX_PLAYERS; i++)
 	{
 		DROID *psDroid;
 		STRUCTURE *psStruct;
 
-		if (aiCheckAlliances(player, i))
-		{
-			// No need to iterate friendly objects
-			continue;
-		}
-
 		for (psDroid = apsDroidLists[i]; psDroid; psDroid = psDroid->psNext)
 		{
 			UBYTE mode = 0;
@@ -1927,7 +2001,7 @@ static void threatUpdate(int player)
 			}
 			if (mode > 0)
 			{
-				threatUpdateTarget(player, (BASE_OBJECT *)psDroid, mode & SHOOT_ON_GROUND, mode & SHOOT_IN_AIR);
+				threatAddTarget((BASE_OBJECT *)psDroid, mode & SHOOT_ON_GROUND, mode & SHOOT_IN_AIR);
 			}
 		}
 
@@ -1945,72 +2019,116 @@ static void threatUpdate(int player)
 			}
 			if (mode > 0)
 			{
-				threatUpdateTarget(player, (BASE_OBJECT *)psStruct, mode & SHOOT_ON_GROUND, mode & SHOOT_IN_AIR);
+				threatAddTarget((BASE_OBJECT *)psStruct, mode & SHOOT_ON_GROUND, mode & SHOOT_IN_AIR);
 			}
 		}
 	}
 }
 
-void mapInit()
+/// Starts calculating the danger maps of the first numPlayers players, from the current state of the game.
+static void dangerMapsStart(int numPlayers)
 {
-	int player;
+	const int mapSize = mapWidth * mapHeight;
 
-	free(floodbucket);
-	floodbucket = (struct floodtile *)malloc(mapWidth * mapHeight * sizeof(*floodbucket));
+	// The block map is the same for all players.
+	memcpy(psBlockMap[AUX_DANGERMAP], psBlockMap[AUX_MAP], sizeof(*psBlockMap[AUX_MAP]) * mapSize);
+	threatCollect();
+	for (int player = 0; player < MAX_PLAYERS; player++)
+	{
+		for (int other = 0; other < MAX_PLAYERS; other++)
+		{
+			dangerAllied[player][other] = aiCheckAlliances(player, other);
+		}
+	}
 
-	lastDangerUpdate = 0;
-	lastDangerPlayer = -1;
+	for (int player = 0; player < numPlayers; player++)
+	{
+		DangerMap &danger = dangerMaps[player];
+		danger.aux.assign(psAuxMap[player], psAuxMap[player] + mapSize);
+		danger.start = getPlayerStartPosition(player);
+		auto job = std::make_shared<DangerJob>([player]() {
+			threatUpdate(player, dangerMaps[player]);
+			dangerFloodFill(dangerMaps[player]);
+			return 0;
+		});
+		danger.done = job->task.get_future();
+		danger.job = job;
+		wzThreadPoolRun([job]() { job->runOnce(); });
+	}
+}
 
-	// Start danger thread (not used for campaign for now - mission map swaps too icky)
-	ASSERT(dangerSemaphore == nullptr && dangerThread == nullptr, "Map data not cleaned up before starting!");
-	if (game.type == SKIRMISH)
+/// Waits for the danger maps started by dangerMapsStart, and copies the new danger and threat bits into the aux maps.
+static void dangerMapsFinish()
+{
+	const int mask = AUXBITS_DANGER | AUXBITS_THREAT | AUXBITS_AATHREAT;
+
+	for (int player = 0; player < MAX_PLAYERS; player++)
 	{
-		for (player = 0; player < MAX_PLAYERS; player++)
+		DangerMap &danger = dangerMaps[player];
+		if (!danger.job)
 		{
-			auxMapStore(player, AUX_DANGERMAP);
-			threatUpdate(player);
-			dangerFloodFill(player);
-			auxMapRestore(player, AUX_DANGERMAP, AUXBITS_DANGER | AUXBITS_THREAT | AUXBITS_AATHREAT);
+			continue;
+		}
+		// The pool threads may all be busy with path-finding lanes, so do the job here if no one has started it yet.
+		danger.job->runOnce();
+		danger.done.get();
+		danger.job.reset();
+		for (int i = 0; i < mapHeight * mapWidth; i++)
+		{
+			uint8_t original = psAuxMap[player][i];
+			psAuxMap[player][i] = original ^ ((original ^ danger.aux[i]) & mask);
 		}
-		lastDangerPlayer = 0;
-		dangerSemaphore = wzSemaphoreCreate(0);
-		dangerDoneSemaphore = wzSemaphoreCreate(0);
-		dangerThread = wzThreadCreate(dangerThreadFunc, nullptr);
-		wzThreadStart(dangerThread);
+	}
+}
+
+void mapInit()
+{
+	lastDangerUpdate = 0;
+
+	// Start danger maps (not used for campaign for now - mission map swaps too icky)
+	if (game.type == SKIRMISH)
+	{
+		dangerMapsStart(MAX_PLAYERS);
+		dangerMapsFinish();
 	}
 }
 
 void mapUpdate()
 {
-	const uint16_t currentTime = gameTime / GAME_TICKS_PER_UPDATE;
-	int posX, posY;
+	const uint32_t currentUpdate = gameTime / GAME_TICKS_PER_UPDATE;
+	const uint16_t currentTime = currentUpdate;
+
+	// Fires ending now come out in the same order as scanning the map row by row, so the sync debug log stays the same.
+	while (!tileFires.empty() && tileFires.top().endTime <= currentUpdate)
+	{
+		TileFire fire = tileFires.top();
+		tileFires.pop();
 
-	for (posY = 0; posY < mapHeight; ++posY)
-		for (posX = 0; posX < mapWidth; ++posX)
+		if (fire.tiles != psMapTiles || fire.endTime != currentUpdate)
 		{
-			MAPTILE *const tile = mapTile(posX, posY);
+			// The map with the tile is swapped out, or this update was skipped. Check again when fireEndTime wraps around to the same value.
+			fire.endTime += 0x10000;
+			tileFires.push(fire);
+			continue;
+		}
 
-			if ((tile->tileInfoBits & BITS_ON_FIRE) != 0 && tile->fireEndTime == currentTime)
-			{
-				// Extinguish, tile, extinguish!
-				tile->tileInfoBits &= ~BITS_ON_FIRE;
+		MAPTILE *const tile = mapTile(fire.x, fire.y);
+		if ((tile->tileInfoBits & BITS_ON_FIRE) != 0 && tile->fireEndTime == currentTime)
+		{
+			// Extinguish, tile, extinguish!
+			tile->tileInfoBits &= ~BITS_ON_FIRE;
 
-				syncDebug("Extinguished tile{%d, %d}", posX, posY);
-			}
+			syncDebug("Extinguished tile{%d, %d}", fire.x, fire.y);
 		}
+	}
 
 	if (gameTime > lastDangerUpdate + GAME_TICKS_FOR_DANGER && game.type == SKIRMISH)
 	{
 		syncDebug("Do danger maps.");
 		lastDangerUpdate = gameTime;
 
-		// Lock if previous job not done yet
-		wzSemaphoreWait(dangerDoneSemaphore);
-
-		auxMapRestore(lastDangerPlayer, AUX_DANGERMAP, AUXBITS_THREAT | AUXBITS_AATHREAT | AUXBITS_DANGER);
-		lastDangerPlayer = (lastDangerPlayer + 1) % game.maxPlayers;
-		auxMapStore(lastDangerPlayer, AUX_DANGERMAP);
-		threatUpdate(lastDangerPlayer);
-		wzSemaphorePost(dangerSemaphore);
+		// Use the maps started last time, which have had a whole interval to finish, and start the next ones for all players at once.
+		dangerMapsFinish();
+		dangerMapsStart(game.maxPlayers);
 	}
 }
@@ -133,6 +133,7 @@ extern char *tilesetDir;
 #define AUXBITS_AATHREAT	0x40	///< Can hostile players shoot at my VTOLs here?
 #define AUXBITS_UNUSED          0x80    ///< Unused
 #define AUXBITS_ALL		0xff
+#define AUXBITS_PATHBITS        (AUXBITS_NONPASSABLE | AUXBITS_OUR_BUILDING | AUXBITS_BLOCKING)  ///< Bits which affect path-finding
 
 #define AUX_MAP		0
 #define AUX_ASTARMAP	1
@@ -142,43 +143,53 @@ extern char *tilesetDir;
 extern uint8_t *psBlockMap[AUX_MAX];
 extern uint8_t *psAuxMap[MAX_PLAYERS + AUX_MAX];	// yes, we waste one element... eyes wide open... makes API nicer
 
-/// Find aux bitfield for a given tile
-WZ_DECL_ALWAYS_INLINE static inline uint8_t auxTile(int x, int y, int player)
+/// Tiles where the blocking or structure bits changed, oldest first, so that cached path-finding blocking maps can be patched instead of regenerated.
+extern std::vector<int> auxChangedTiles;
+/// Serial number of the first entry of auxChangedTiles. Changes with a lower serial number have been forgotten.
+extern uint32_t auxChangedTilesStart;
+
+/// Forget the changed tiles, forcing cached blocking maps to be regenerated. Call whenever the aux maps are replaced.
+static inline void auxForgetChanges()
 {
-	return psAuxMap[player][x + y * mapWidth];
+	auxChangedTilesStart += auxChangedTiles.size() + 1;
+	auxChangedTiles.clear();
 }
 
-/// Find blocking bitfield for a given tile
-WZ_DECL_ALWAYS_INLINE static inline uint8_t blockTile(int x, int y, int slot)
+/// Remember that the blocking bits of a tile may have changed.
+WZ_DECL_ALWAYS_INLINE static inline void auxMarkChanged(int x, int y)
 {
-	return psBlockMap[slot][x + y * mapWidth];
+	int tile = x + y * mapWidth;
+	if (!auxChangedTiles.empty() && auxChangedTiles.back() == tile)
+	{
+		return;  // Structures typically set several bits at once.
+	}
+	if (auxChangedTiles.size() >= (size_t)mapWidth * mapHeight)
+	{
+		auxForgetChanges();  // Nobody is reading the changes, and regenerating would be cheaper than patching anyway.
+	}
+	auxChangedTiles.push_back(tile);
 }
 
-/// Store a shadow copy of a player's aux map for use in threaded calculations
-static inline void auxMapStore(int player, int slot)
+/// Find aux bitfield for a given tile
+WZ_DECL_ALWAYS_INLINE static inline uint8_t auxTile(int x, int y, int player)
 {
-	memcpy(psBlockMap[slot], psBlockMap[0], sizeof(*psBlockMap[player]) * mapWidth * mapHeight);
-	memcpy(psAuxMap[MAX_PLAYERS + slot], psAuxMap[player], sizeof(*psAuxMap[player]) * mapWidth * mapHeight);
+	return psAuxMap[player][x + y * mapWidth];
 }
 
-/// Restore selected fields from the shadow copy of a player's aux map (ignoring the block map)
-static inline void auxMapRestore(int player, int slot, int mask)
+/// Find blocking bitfield for a given tile
+WZ_DECL_ALWAYS_INLINE static inline uint8_t blockTile(int x, int y, int slot)
 {
-	int i;
-	uint8_t original, cached;
-
-	for (i = 0; i < mapHeight * mapWidth; i++)
-	{
-		original = psAuxMap[player][i];
-		cached = psAuxMap[MAX_PLAYERS + slot][i];
-		psAuxMap[player][i] = original ^ ((original ^ cached) & mask);
-	}
+	return psBlockMap[slot][x + y * mapWidth];
 }
 
 /// Set aux bits. Always set identically for all players. States not set are retained.
 WZ_DECL_ALWAYS_INLINE static inline void auxSet(int x, int y, int player, int state)
 {
 	psAuxMap[player][x + y * mapWidth] |= state;
+	if (state & AUXBITS_PATHBITS)
+	{
+		auxMarkChanged(x, y);
+	}
 }
 
 /// Set aux bits. Always set identically for all players. States not set are retained.
@@ -190,6 +201,10 @@ WZ_DECL_ALWAYS_INLINE static inline void auxSetAll(int x, int y, int state)
 	{
 		psAuxMap[i][x + y * mapWidth] |= state;
 	}
+	if (state & AUXBITS_PATHBITS)
+	{
+		auxMarkChanged(x, y);
+	}
 }
 
 /// Set aux bits. Always set identically for all players. States not set are retained.
@@ -204,6 +219,10 @@ WZ_DECL_ALWAYS_INLINE static inline void auxSetAllied(int x, int y, int player,
 			psAuxMap[i][x + y * mapWidth] |= state;
 		}
 	}
+	if (state & AUXBITS_PATHBITS)
+	{
+		auxMarkChanged(x, y);
+	}
 }
 
 /// Set aux bits. Always set identically for all players. States not set are retained.
@@ -218,12 +237,20 @@ WZ_DECL_ALWAYS_INLINE static inline void auxSetEnemy(int x, int y, int player, i
 			psAuxMap[i][x + y * mapWidth] |= state;
 		}
 	}
+	if (state & AUXBITS_PATHBITS)
+	{
+		auxMarkChanged(x, y);
+	}
 }
 
 /// Clear aux bits. Always set identically for all players. States not cleared are retained.
 WZ_DECL_ALWAYS_INLINE static inline void auxClear(int x, int y, int player, int state)
 {
 	psAuxMap[player][x + y * mapWidth] &= ~state;
+	if (state & AUXBITS_PATHBITS)
+	{
+		auxMarkChanged(x, y);
+	}
 }
 
 /// Clear all aux bits. Always set identically for all players. States not cleared are retained.
@@ -235,18 +262,24 @@ WZ_DECL_ALWAYS_INLINE static inline void auxClearAll(int x, int y, int state)
 	{
 		psAuxMap[i][x + y * mapWidth] &= ~state;
 	}
+	if (state & AUXBITS_PATHBITS)
+	{
+		auxMarkChanged(x, y);
+	}
 }
 
 /// Set blocking bits. Always set identically for all players. States not set are retained.
 WZ_DECL_ALWAYS_INLINE static inline void auxSetBlocking(int x, int y, int state)
 {
 	psBlockMap[0][x + y * mapWidth] |= state;
+	auxMarkChanged(x, y);
 }
 
 /// Clear blocking bits. Always set identically for all players. States not cleared are retained.
 WZ_DECL_ALWAYS_INLINE static inline void auxClearBlocking(int x, int y, int state)
 {
 	psBlockMap[0][x + y * mapWidth] &= ~state;
+	auxMarkChanged(x, y);
 }
 
 /**
@@ -31,38 +31,200 @@
 #include "mapgrid.h"
 #include "pointtree.h"
 
+#include "lib/framework/wzapp.h"
+#include <QtCore/QElapsedTimer>
+#include <unordered_set>
 
-static PointTree *gridPointTree = nullptr;  // A quad-tree-like object.
-static PointTree::Filter *gridFiltersUnseen;
-static PointTree::Filter *gridFiltersDroidsByPlayer;
+
+/// Objects are kept in separate point trees, so the structures and features, which almost never change, don't need sorting again when droids move.
+enum GRID_LAYER
+{
+	GRID_STATIC,   ///< Structures and features.
+	GRID_DYNAMIC,  ///< Droids.
+	GRID_LAYERS
+};
+
+struct GridLayerObject
+{
+	BASE_OBJECT *obj;
+	int32_t x, y;
+};
+
+/// True if a and b have the same objects in the same order, and, if checking positions, in the same places.
+static bool gridSameObjects(std::vector<GridLayerObject> const &a, std::vector<GridLayerObject> const &b, bool checkPositions)
+{
+	if (a.size() != b.size())
+	{
+		return false;
+	}
+	for (unsigned i = 0; i != a.size(); ++i)
+	{
+		if (a[i].obj != b[i].obj || (checkPositions && (a[i].x != b[i].x || a[i].y != b[i].y)))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+struct GridLayer
+{
+	PointTree pointTree;                         ///< A quad-tree-like object.
+	PointTree::Filter filtersUnseen[MAX_PLAYERS];
+	PointTree::Filter filtersDroidsByPlayer[MAX_PLAYERS];
+	std::vector<GridLayerObject> objects;        ///< The objects in the point tree, in list order. Objects no longer in the lists may have been freed already.
+	std::vector<GridLayerObject> newObjects;     ///< The objects now in the lists, in list order.
+};
+
+static GridLayer *gridLayers = nullptr;
+static GRID_STATISTICS gridStats;
+static uint32_t gridGenerationCount = 0;  ///< Not reset with the statistics, so never repeats.
+static bool gridCheckRebuild = false;
 
 // initialise the grid system
 bool gridInitialise()
 {
-	ASSERT(gridPointTree == nullptr, "gridInitialise already called, without calling gridShutDown.");
-	gridPointTree = new PointTree;
-	gridFiltersUnseen = new PointTree::Filter[MAX_PLAYERS];
-	gridFiltersDroidsByPlayer = new PointTree::Filter[MAX_PLAYERS];
+	ASSERT(gridLayers == nullptr, "gridInitialise already called, without calling gridShutDown.");
+	gridLayers = new GridLayer[GRID_LAYERS];
+	gridStats = GRID_STATISTICS();
 
 	return true;  // Yay, nothing failed!
 }
 
+/// Brings the point tree of a layer up to date with newObjects, only moving the points which changed.
+static void gridUpdateLayer(GridLayer &layer)
+{
+	PointTree &pointTree = layer.pointTree;
+
+	bool isDynamic = &layer == &gridLayers[GRID_DYNAMIC];
+	if (gridSameObjects(layer.newObjects, layer.objects, !isDynamic))
+	{
+		if (!isDynamic)
+		{
+			return;  // Nothing moved, nothing added, nothing removed, so no need to do anything.
+		}
+		// Same droids as last time. Only their positions need updating, and it's safe to look at them, since none can have been freed.
+		for (unsigned i = 0; i != pointTree.size(); ++i)
+		{
+			BASE_OBJECT *psObj = static_cast<BASE_OBJECT *>(pointTree.pointData(i));
+			pointTree.move(i, psObj->pos.x, psObj->pos.y, psObj->id);
+		}
+	}
+	else
+	{
+		// Objects were added or removed. Don't look at removed objects, since they may have been freed, and another object might even have been allocated in the same place.
+		static std::unordered_set<BASE_OBJECT *> objs;
+		objs.clear();
+		for (GridLayerObject const &o : layer.newObjects)
+		{
+			objs.insert(o.obj);
+		}
+		gridStats.removed += pointTree.eraseIf([](void *pointData) {
+			return objs.erase(static_cast<BASE_OBJECT *>(pointData)) == 0;
+		});
+		for (unsigned i = 0; i != pointTree.size(); ++i)
+		{
+			BASE_OBJECT *psObj = static_cast<BASE_OBJECT *>(pointTree.pointData(i));
+			pointTree.move(i, psObj->pos.x, psObj->pos.y, psObj->id);
+		}
+		// Whatever is left in objs was not in the point tree.
+		for (GridLayerObject const &o : layer.newObjects)
+		{
+			if (objs.count(o.obj) != 0)
+			{
+				pointTree.insert(o.obj, o.x, o.y, o.obj->id);
+				++gridStats.inserted;
+			}
+		}
+		std::swap(layer.objects, layer.newObjects);
+	}
+
+	// Points in the same place are sorted by id, so the order doesn't depend on the order the objects were added.
+	gridStats.shifted += pointTree.resort();
+	++gridStats.layerUpdates;
+}
+
+/// Sorts all objects into new point trees from scratch, like before the layers existed, and checks that gives the same points in the same places as the real grid.
+static void gridCheckAgainstRebuild()
+{
+	static PointTree pointTrees[GRID_LAYERS];
+	static PointTree::Filter filters[GRID_LAYERS][MAX_PLAYERS * 2];
+	QElapsedTimer timer;
+	timer.start();
+	for (PointTree &pointTree : pointTrees)
+	{
+		pointTree.clear();
+	}
+	for (unsigned player = 0; player < MAX_PLAYERS; player++)
+	{
+		BASE_OBJECT *start[3] = {(BASE_OBJECT *)apsDroidLists[player], (BASE_OBJECT *)apsStructLists[player], (BASE_OBJECT *)apsFeatureLists[player]};
+		for (unsigned type = 0; type != sizeof(start) / sizeof(*start); ++type)
+		{
+			for (BASE_OBJECT *psObj = start[type]; psObj != nullptr; psObj = psObj->psNext)
+			{
+				if (!psObj->died)
+				{
+					pointTrees[type == 0 ? GRID_DYNAMIC : GRID_STATIC].insert(psObj, psObj->pos.x, psObj->pos.y, psObj->id);
+				}
+			}
+		}
+	}
+	for (unsigned layer = 0; layer != GRID_LAYERS; ++layer)
+	{
+		pointTrees[layer].sort();
+		for (PointTree::Filter &filter : filters[layer])
+		{
+			filter.reset(pointTrees[layer]);
+		}
+	}
+	gridStats.checkNanoseconds += timer.nsecsElapsed();
+	++gridStats.checks;
+
+	for (unsigned layer = 0; layer != GRID_LAYERS; ++layer)
+	{
+		PointTree const &updated = gridLayers[layer].pointTree;
+		PointTree const &rebuilt = pointTrees[layer];
+		bool same = updated.size() == rebuilt.size();
+		for (unsigned i = 0; same && i != updated.size(); ++i)
+		{
+			int32_t updatedX, updatedY, rebuiltX, rebuiltY;
+			updated.pointPosition(i, updatedX, updatedY);
+			rebuilt.pointPosition(i, rebuiltX, rebuiltY);
+			same = updated.pointData(i) == rebuilt.pointData(i) && updatedX == rebuiltX && updatedY == rebuiltY;
+		}
+		if (!same)
+		{
+			++gridStats.mismatches;
+			ASSERT(false, "Updating grid layer %u gave something else than rebuilding it", layer);
+			break;
+		}
+	}
+}
+
 // reset the grid system
 void gridReset()
 {
-	gridPointTree->clear();
+	QElapsedTimer timer;
+	timer.start();
+
+	for (unsigned layer = 0; layer != GRID_LAYERS; ++layer)
+	{
+		gridLayers[layer].newObjects.clear();
+	}
 
-	// Put all existing objects into the point tree.
+	// Find all existing objects.
 	for (unsigned player = 0; player < MAX_PLAYERS; player++)
 	{
 		BASE_OBJECT *start[3] = {(BASE_OBJECT *)apsDroidLists[player], (BASE_OBJECT *)apsStructLists[player], (BASE_OBJECT *)apsFeatureLists[player]};
 		for (unsigned type = 0; type != sizeof(start) / sizeof(*start); ++type)
 		{
+			std::vector<GridLayerObject> &newObjects = gridLayers[type == 0 ? GRID_DYNAMIC : GRID_STATIC].newObjects;
 			for (BASE_OBJECT *psObj = start[type]; psObj != nullptr; psObj = psObj->psNext)
 			{
 				if (!psObj->died)
 				{
-					gridPointTree->insert(psObj, psObj->pos.x, psObj->pos.y);
+					GridLayerObject o = {psObj, psObj->pos.x, psObj->pos.y};
+					newObjects.push_back(o);
 					for (unsigned char &viewer : psObj->seenThisTick)
 					{
 						viewer = 0;
@@ -72,24 +234,47 @@ void gridReset()
 		}
 	}
 
-	gridPointTree->sort();
+	// Put them into the point trees.
+	for (unsigned layer = 0; layer != GRID_LAYERS; ++layer)
+	{
+		gridUpdateLayer(gridLayers[layer]);
+		for (unsigned player = 0; player < MAX_PLAYERS; ++player)
+		{
+			gridLayers[layer].filtersUnseen[player].reset(gridLayers[layer].pointTree);
+			gridLayers[layer].filtersDroidsByPlayer[player].reset(gridLayers[layer].pointTree);
+		}
+	}
+
+	++gridStats.resets;
+	++gridGenerationCount;
+	gridStats.nanoseconds += timer.nsecsElapsed();
 
-	for (unsigned player = 0; player < MAX_PLAYERS; ++player)
+	if (gridCheckRebuild)
 	{
-		gridFiltersUnseen[player].reset(*gridPointTree);
-		gridFiltersDroidsByPlayer[player].reset(*gridPointTree);
+		gridCheckAgainstRebuild();
 	}
 }
 
 // shutdown the grid system
 void gridShutDown()
 {
-	delete gridPointTree;
-	gridPointTree = nullptr;
-	delete[] gridFiltersUnseen;
-	gridFiltersUnseen = nullptr;
-	delete[] gridFiltersDroidsByPlayer;
-	gridFiltersDroidsByPlayer = nullptr;
+	delete[] gridLayers;
+	gridLayers = nullptr;
+}
+
+GRID_STATISTICS gridGetStatistics()
+{
+	return gridStats;
+}
+
+void gridSetCheckRebuild(bool check)
+{
+	gridCheckRebuild = check;
+}
+
+uint32_t gridGeneration()
+{
+	return gridGenerationCount;
 }
 
 static bool isInRadius(int32_t x, int32_t y, uint32_t radius)
@@ -97,59 +282,43 @@ static bool isInRadius(int32_t x, int32_t y, uint32_t radius)
 	return (uint32_t)(x * x + y * y) <= radius * radius;
 }
 
-// initialise the grid system to start iterating through units that
-// could affect a location (x,y in world coords)
+/// Finds the objects within radius where condition.test(object) is true, and if using filters, stops objects where it is false from being found again.
 template<class Condition>
-static GridList const &gridStartIterateFiltered(int32_t x, int32_t y, uint32_t radius, PointTree::Filter *filter, Condition const &condition)
+static void gridSearchFiltered(GridSearch &search, int32_t x, int32_t y, uint32_t radius, PointTree::Filter (GridLayer::*filters)[MAX_PLAYERS], unsigned filterIndex, Condition const &condition)
 {
-	if (filter == nullptr)
-	{
-		gridPointTree->query(x, y, radius);
-	}
-	else
-	{
-		gridPointTree->query(*filter, x, y, radius);
-	}
-	PointTree::ResultVector::iterator w = gridPointTree->lastQueryResults.begin(), i;
-	for (i = w; i != gridPointTree->lastQueryResults.end(); ++i)
+	search.objects.clear();
+	for (unsigned layer = 0; layer != GRID_LAYERS; ++layer)
 	{
-		BASE_OBJECT *obj = static_cast<BASE_OBJECT *>(*i);
-		if (!condition.test(obj))  // Check if we should skip this object.
+		PointTree const &pointTree = gridLayers[layer].pointTree;
+		PointTree::Filter *filter = filters != nullptr ? &(gridLayers[layer].*filters)[filterIndex] : nullptr;
+		if (filter == nullptr)
+		{
+			pointTree.query(search.points, x, y, radius);
+		}
+		else
 		{
-			filter->erase(gridPointTree->lastFilteredQueryIndices[i - gridPointTree->lastQueryResults.begin()]);  // Stop the object from appearing in future searches.
+			pointTree.query(search.points, search.indices, *filter, x, y, radius);
 		}
-		else if (isInRadius(obj->pos.x - x, obj->pos.y - y, radius))  // Check that search result is less than radius (since they can be up to a factor of sqrt(2) more).
+		for (unsigned i = 0; i != search.points.size(); ++i)
 		{
-			*w = *i;
-			++w;
+			BASE_OBJECT *obj = static_cast<BASE_OBJECT *>(search.points[i]);
+			if (!condition.test(obj))  // Check if we should skip this object.
+			{
+				if (filter != nullptr)
+				{
+					filter->erase(search.indices[i]);  // Stop the object from appearing in future searches.
+				}
+			}
+			else if (isInRadius(obj->pos.x - x, obj->pos.y - y, radius))  // Check that search result is less than radius (since they can be up to a factor of sqrt(2) more).
+			{
+				search.objects.push_back(obj);
+			}
 		}
 	}
-	gridPointTree->lastQueryResults.erase(w, i);  // Erase all points that were a bit too far.
 	/*
 	// In case you are curious.
-	debug(LOG_WARNING, "gridStartIterateFiltered(%d, %d, %u) found %u objects", x, y, radius, (unsigned)gridPointTree->lastQueryResults.size());
+	debug(LOG_WARNING, "gridSearchFiltered(%d, %d, %u) found %u objects", x, y, radius, (unsigned)search.objects.size());
 	*/
-	static GridList gridList;
-	gridList.resize(gridPointTree->lastQueryResults.size());
-	for (unsigned n = 0; n < gridList.size(); ++n)
-	{
-		gridList[n] = (BASE_OBJECT *)gridPointTree->lastQueryResults[n];
-	}
-	return gridList;
-}
-
-template<class Condition>
-static GridList const &gridStartIterateFilteredArea(int32_t x, int32_t y, int32_t x2, int32_t y2, Condition const &condition)
-{
-	gridPointTree->query(x, y, x2, y2);
-
-	static GridList gridList;
-	gridList.resize(gridPointTree->lastQueryResults.size());
-	for (unsigned n = 0; n < gridList.size(); ++n)
-	{
-		gridList[n] = (BASE_OBJECT *)gridPointTree->lastQueryResults[n];
-	}
-	return gridList;
 }
 
 struct ConditionTrue
@@ -160,16 +329,6 @@ struct ConditionTrue
 	}
 };
 
-GridList const &gridStartIterate(int32_t x, int32_t y, uint32_t radius)
-{
-	return gridStartIterateFiltered(x, y, radius, nullptr, ConditionTrue());
-}
-
-GridList const &gridStartIterateArea(int32_t x, int32_t y, uint32_t x2, uint32_t y2)
-{
-	return gridStartIterateFilteredArea(x, y, x2, y2, ConditionTrue());
-}
-
 struct ConditionDroidsByPlayer
 {
 	ConditionDroidsByPlayer(int32_t player_) : player(player_) {}
@@ -180,11 +339,6 @@ struct ConditionDroidsByPlayer
 	int player;
 };
 
-GridList const &gridStartIterateDroidsByPlayer(int32_t x, int32_t y, uint32_t radius, int player)
-{
-	return gridStartIterateFiltered(x, y, radius, &gridFiltersDroidsByPlayer[player], ConditionDroidsByPlayer(player));
-}
-
 struct ConditionUnseen
 {
 	ConditionUnseen(int32_t player_) : player(player_) {}
@@ -195,15 +349,197 @@ struct ConditionUnseen
 	int player;
 };
 
+void gridSearch(GridSearch &search, int32_t x, int32_t y, uint32_t radius)
+{
+	gridSearchFiltered(search, x, y, radius, nullptr, 0, ConditionTrue());
+}
+
+void gridSearchArea(GridSearch &search, int32_t x, int32_t y, uint32_t x2, uint32_t y2)
+{
+	search.objects.clear();
+	for (unsigned layer = 0; layer != GRID_LAYERS; ++layer)
+	{
+		gridLayers[layer].pointTree.query(search.points, x, y, x2, y2);
+		for (void *point : search.points)
+		{
+			search.objects.push_back(static_cast<BASE_OBJECT *>(point));
+		}
+	}
+}
+
+void gridSearchAreaWithPositions(GridSearch &search, int32_t x, int32_t y, uint32_t x2, uint32_t y2)
+{
+	search.objects.clear();
+	search.positions.clear();
+	for (unsigned layer = 0; layer != GRID_LAYERS; ++layer)
+	{
+		PointTree const &pointTree = gridLayers[layer].pointTree;
+		pointTree.query(search.points, search.indices, x, y, x2, y2);
+		for (unsigned i = 0; i != search.points.size(); ++i)
+		{
+			Vector2i pos;
+			pointTree.pointPosition(search.indices[i], pos.x, pos.y);
+			search.objects.push_back(static_cast<BASE_OBJECT *>(search.points[i]));
+			search.positions.push_back(pos);
+		}
+	}
+}
+
+void GridSearchCache::search(GridList &results, int32_t x, int32_t y, uint32_t radius)
+{
+	if (generation != gridGeneration())
+	{
+		searches.clear();  // The grid has been reset, so the searches are out of date.
+		generation = gridGeneration();
+	}
+
+	auto cell = [this](int32_t coord) {
+		return (coord >= 0 ? coord : coord - (cellSize - 1)) / cellSize;  // Round down, even if negative.
+	};
+	int32_t cellX = cell(x);
+	int32_t cellY = cell(y);
+	int32_t band = (radius + bandSize - 1) / bandSize;
+	uint64_t key = (uint64_t)(uint16_t)cellX << 32 | (uint64_t)(uint16_t)cellY << 16 | (uint16_t)band;
+
+	++stats.lookups;
+	auto it = searches.find(key);
+	if (it == searches.end())
+	{
+		it = searches.insert(std::make_pair(key, GridSearch())).first;
+		int32_t bandRange = band * bandSize;
+		gridSearchAreaWithPositions(it->second, cellX * cellSize - bandRange, cellY * cellSize - bandRange,
+		                            cellX * cellSize + cellSize - 1 + bandRange, cellY * cellSize + cellSize - 1 + bandRange);
+	}
+	else
+	{
+		++stats.hits;
+	}
+	GridSearch const &cached = it->second;
+	stats.candidates += cached.objects.size();
+
+	// Keep the objects the grid would have found searching here. The grid only finds objects in the square around (x, y), according to where they
+	// were when the grid was reset, but then checks that they are in range according to where they are now.
+	int32_t range = radius;
+	int32_t minX = x - range, maxX = x + range;
+	int32_t minY = y - range, maxY = y + range;
+	results.clear();
+	for (unsigned i = 0; i != cached.objects.size(); ++i)
+	{
+		BASE_OBJECT *psObj = cached.objects[i];
+		Vector2i gridPos = cached.positions[i];
+		if (gridPos.x >= minX && gridPos.x <= maxX && gridPos.y >= minY && gridPos.y <= maxY && isInRadius(psObj->pos.x - x, psObj->pos.y - y, radius))
+		{
+			results.push_back(psObj);
+		}
+	}
+}
+
+void gridSearchDroidsByPlayer(GridSearch &search, int32_t x, int32_t y, uint32_t radius, int player)
+{
+	gridSearchFiltered(search, x, y, radius, nullptr, 0, ConditionDroidsByPlayer(player));
+}
+
+void gridSearchUnseen(GridSearch &search, int32_t x, int32_t y, uint32_t radius, int player)
+{
+	gridSearchFiltered(search, x, y, radius, nullptr, 0, ConditionUnseen(player));
+}
+
+// The gridStartIterate functions use these, and the per-player filters, so may only be used on the main thread, and each call overwrites the results of the last call to the same function.
+static GridSearch gridMainSearch;
+static GridSearch gridMainSearchArea;
+static GridSearch gridMainSearchDroidsByPlayer;
+static GridSearch gridMainSearchUnseen;
+
+GridList const &gridStartIterate(int32_t x, int32_t y, uint32_t radius)
+{
+	gridSearch(gridMainSearch, x, y, radius);
+	return gridMainSearch.objects;
+}
+
+GridList const &gridStartIterateArea(int32_t x, int32_t y, uint32_t x2, uint32_t y2)
+{
+	gridSearchArea(gridMainSearchArea, x, y, x2, y2);
+	return gridMainSearchArea.objects;
+}
+
+GridList const &gridStartIterateDroidsByPlayer(int32_t x, int32_t y, uint32_t radius, int player)
+{
+	gridSearchFiltered(gridMainSearchDroidsByPlayer, x, y, radius, &GridLayer::filtersDroidsByPlayer, player, ConditionDroidsByPlayer(player));
+	return gridMainSearchDroidsByPlayer.objects;
+}
+
 GridList const &gridStartIterateUnseen(int32_t x, int32_t y, uint32_t radius, int player)
 {
-	return gridStartIterateFiltered(x, y, radius, &gridFiltersUnseen[player], ConditionUnseen(player));
+	gridSearchFiltered(gridMainSearchUnseen, x, y, radius, &GridLayer::filtersUnseen, player, ConditionUnseen(player));
+	return gridMainSearchUnseen.objects;
 }
 
 BASE_OBJECT **gridIterateDup()
 {
-	size_t bytes = gridPointTree->lastQueryResults.size() * sizeof(void *);
+	size_t bytes = gridMainSearch.objects.size() * sizeof(void *);
 	BASE_OBJECT **ret = (BASE_OBJECT **)malloc(bytes);
-	memcpy(ret, &gridPointTree->lastQueryResults[0], bytes);
+	memcpy(ret, gridMainSearch.objects.data(), bytes);
 	return ret;
 }
+
+GRID_STRESS_TEST gridStressTest(unsigned numThreads)
+{
+	GRID_STRESS_TEST result;
+	result.threads = numThreads;
+	result.mismatches = 0;
+
+	// Search around every object, with each kind of search.
+	std::vector<GridLayerObject> centres;
+	for (unsigned layer = 0; layer != GRID_LAYERS; ++layer)
+	{
+		centres.insert(centres.end(), gridLayers[layer].objects.begin(), gridLayers[layer].objects.end());
+	}
+	result.queries = centres.size();
+	auto search = [&centres](GridSearch &search, unsigned n) {
+		GridLayerObject const &centre = centres[n];
+		int player = n % MAX_PLAYERS;
+		switch (n % 4)
+		{
+		case 0: gridSearch(search, centre.x, centre.y, TILE_UNITS * 8); break;
+		case 1: gridSearchArea(search, centre.x - TILE_UNITS * 4, centre.y - TILE_UNITS * 4, centre.x + TILE_UNITS * 4, centre.y + TILE_UNITS * 4); break;
+		case 2: gridSearchDroidsByPlayer(search, centre.x, centre.y, TILE_UNITS * 12, player); break;
+		case 3: gridSearchUnseen(search, centre.x, centre.y, TILE_UNITS * 16, player); break;
+		}
+	};
+
+	std::vector<GridList> expected(centres.size());
+	GridSearch mainSearch;
+	for (unsigned n = 0; n != centres.size(); ++n)
+	{
+		search(mainSearch, n);
+		expected[n] = mainSearch.objects;
+	}
+
+	// Each thread does every search, starting at different places, so different threads are doing different searches at the same time.
+	std::vector<unsigned> mismatches(numThreads, 0);
+	std::vector<wz::thread> threads;
+	QElapsedTimer timer;
+	timer.start();
+	for (unsigned t = 0; t != numThreads; ++t)
+	{
+		threads.emplace_back([&, t]() {
+			GridSearch threadSearch;
+			for (unsigned i = 0; i != centres.size(); ++i)
+			{
+				unsigned n = (i + t * centres.size() / numThreads) % centres.size();
+				search(threadSearch, n);
+				mismatches[t] += threadSearch.objects != expected[n];
+			}
+		});
+	}
+	for (wz::thread &thread : threads)
+	{
+		thread.join();
+	}
+	result.microseconds = timer.nsecsElapsed() / 1000;
+	for (unsigned m : mismatches)
+	{
+		result.mismatches += m;
+	}
+	return result;
+}
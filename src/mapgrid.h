@@ -24,9 +24,21 @@
 #ifndef __INCLUDED_SRC_MAPGRID_H__
 #define __INCLUDED_SRC_MAPGRID_H__
 
+#include <unordered_map>
+
 typedef std::vector<BASE_OBJECT *> GridList;
 typedef GridList::const_iterator GridIterator;
 
+/// Results of a search of the grid. Searches with different GridSearches may be done at the same time on different threads,
+/// as long as the grid is not reset meanwhile. Reusing the same GridSearch for the next search avoids allocating memory.
+struct GridSearch
+{
+	GridList objects;               ///< Objects found.
+	std::vector<void *> points;     ///< Used while searching.
+	std::vector<unsigned> indices;  ///< Used while searching.
+	std::vector<Vector2i> positions;  ///< Where the objects found were when the grid was reset. Only set by gridSearchAreaWithPositions().
+};
+
 // initialise the grid system
 bool gridInitialise();
 
@@ -35,8 +47,84 @@ void gridShutDown();
 
 // Reset the grid system. Called once per update.
 // Resets seenThisTick[] to false.
+// Only moves the objects which moved, were added or were removed since the last update.
 void gridReset();
 
+struct GRID_STATISTICS
+{
+	uint64_t resets = 0;        ///< Number of gridReset() calls.
+	uint64_t nanoseconds = 0;   ///< Total time spent in gridReset().
+	uint64_t layerUpdates = 0;  ///< Number of times droids, or structures and features, had to be sorted again.
+	uint64_t inserted = 0;      ///< Number of objects added to the grid.
+	uint64_t removed = 0;       ///< Number of objects removed from the grid.
+	uint64_t shifted = 0;       ///< Number of steps objects were shifted, when sorting again after moving.
+	uint64_t checks = 0;        ///< Number of resets checked against rebuilding the grid from scratch.
+	uint64_t checkNanoseconds = 0;  ///< Total time spent rebuilding the grid from scratch, for the checks.
+	uint64_t mismatches = 0;    ///< Number of checks where rebuilding the grid gave something else than updating it.
+};
+GRID_STATISTICS gridGetStatistics();
+
+/// If enabled, every gridReset() also sorts all objects into a new grid from scratch, and checks that it matches the updated grid.
+void gridSetCheckRebuild(bool check);
+
+/// Changes every time the grid is reset, so anything remembering search results knows when they are out of date.
+uint32_t gridGeneration();
+
+/// Shares grid searches between searches near each other, until the grid is next reset. Each search covers a cell, plus the radius rounded up
+/// to a whole band, once, and is then filtered down to exactly the objects gridSearch() would find, in the same order. Not thread safe.
+class GridSearchCache
+{
+public:
+	struct Statistics
+	{
+		uint64_t lookups = 0;     ///< Number of searches.
+		uint64_t hits = 0;        ///< Number of those which reused an earlier grid search.
+		uint64_t candidates = 0;  ///< Number of objects checked, when filtering the shared searches.
+	};
+
+	GridSearchCache(int cellSize, int bandSize) : cellSize(cellSize), bandSize(bandSize) {}
+
+	/// Puts the objects within radius in results, like gridSearch().
+	void search(GridList &results, int32_t x, int32_t y, uint32_t radius);
+	Statistics const &statistics() const
+	{
+		return stats;
+	}
+
+private:
+	int cellSize;
+	int bandSize;
+	uint32_t generation = 0;
+	std::unordered_map<uint64_t, GridSearch> searches;  ///< Searches done since the grid was reset, by cell and band.
+	Statistics stats;
+};
+
+struct GRID_STRESS_TEST
+{
+	unsigned queries;       ///< Number of searches done by each thread.
+	unsigned threads;       ///< Number of threads searching at the same time.
+	unsigned mismatches;    ///< Number of searches which found something else than the same search on the main thread.
+	uint64_t microseconds;  ///< Time taken by the threads.
+};
+/// Searches around every object from several threads at once, and checks that they all find the same as searching one at a time.
+GRID_STRESS_TEST gridStressTest(unsigned numThreads);
+
+// The gridSearch functions put the objects found in search.objects, and are thread safe, as long as each thread has its own GridSearch.
+
+/// Find all objects within radius.
+void gridSearch(GridSearch &search, int32_t x, int32_t y, uint32_t radius);
+/// Find all objects within the rectangle.
+void gridSearchArea(GridSearch &search, int32_t x, int32_t y, uint32_t x2, uint32_t y2);
+/// Like gridSearchArea(), but also sets search.positions, which are the positions the grid used, for filtering the objects found down to the results of smaller searches.
+void gridSearchAreaWithPositions(GridSearch &search, int32_t x, int32_t y, uint32_t x2, uint32_t y2);
+/// Find all objects within radius where object->type == OBJ_DROID && object->player == player.
+void gridSearchDroidsByPlayer(GridSearch &search, int32_t x, int32_t y, uint32_t radius, int player);
+/// Find all objects within radius where object->seenThisTick[player] != 255.
+void gridSearchUnseen(GridSearch &search, int32_t x, int32_t y, uint32_t radius, int player);
+
+// The gridStartIterate functions are not thread safe, and return a list which is overwritten by the next call to the same function.
+// The filtered ones remember which objects didn't match, so later searches in the same tick get faster.
+
 /// Find all objects within radius.
 GridList const &gridStartIterate(int32_t x, int32_t y, uint32_t radius);
 
@@ -344,6 +344,7 @@ bool missionShutDown()
 			psAuxMap[i] = mission.psAuxMap[i];
 			mission.psAuxMap[i] = nullptr;
 		}
+		auxForgetChanges();
 		std::swap(mission.psGateways, gwGetGateways());
 	}
 
@@ -877,6 +878,7 @@ void restoreMissionData()
 		psAuxMap[i] = mission.psAuxMap[i];
 		mission.psAuxMap[i] = nullptr;
 	}
+	auxForgetChanges();
 	scrollMinX = mission.scrollMinX;
 	scrollMinY = mission.scrollMinY;
 	scrollMaxX = mission.scrollMaxX;
@@ -1376,6 +1378,7 @@ void swapMissionPointers()
 	{
 		std::swap(psAuxMap[i],   mission.psAuxMap[i]);
 	}
+	auxForgetChanges();
 	//swap gateway zones
 	std::swap(mission.psGateways, gwGetGateways());
 	std::swap(scrollMinX, mission.scrollMinX);
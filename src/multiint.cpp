@@ -2957,6 +2957,7 @@ static void loadMapSettings1()
 	game.scavengers = ini.value("scavengers", game.scavengers).toBool();
 	game.base = ini.value("bases", game.base).toInt();
 	game.alliance = ini.value("alliances", game.alliance).toInt();
+	game.pathSearch = ini.value("pathSearch", game.pathSearch).toInt();
 	if (ini.contains("powerLevel"))
 	{
 		game.power = ini.value("powerLevel", game.power).toInt();
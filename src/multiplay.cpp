@@ -31,11 +31,13 @@
 #include "lib/framework/strres.h"
 #include "lib/framework/physfs_ext.h"
 #include "map.h"
+#include "objmem.h"
 
 #include "game.h"									// for loading maps
 #include "hci.h"
 
 #include <time.h>									// for recording ping times.
+#include <QtCore/QElapsedTimer>
 #include "research.h"
 #include "display3d.h"								// for changing the viewpoint
 #include "console.h"								// for screen messages
@@ -304,9 +306,26 @@ bool multiPlayerLoop()
 // ////////////////////////////////////////////////////////////////////////////
 // quikie functions.
 
+/// Whether the IdTo*() functions may use findObjectById(), instead of searching the object lists. Only off for benchmarking.
+static bool useObjectIdIndex = true;
+
 // to get droids ...
 DROID *IdToDroid(UDWORD id, UDWORD player)
 {
+	if (useObjectIdIndex && objectsOnlyOnCurrentLists())
+	{
+		BASE_OBJECT *psObj = findObjectById(id);
+		if (psObj == nullptr || psObj->type != OBJ_DROID || (player != ANYPLAYER && psObj->player != player))
+		{
+			return nullptr;
+		}
+		DROID *psDroid = (DROID *)psObj;
+		if (psDroid->psGroup != nullptr && psDroid->psGroup->type == GT_TRANSPORTER && !isTransporter(psDroid))
+		{
+			return nullptr;  // In a transporter, so not on a droid list.
+		}
+		return psDroid;
+	}
 	if (player == ANYPLAYER)
 	{
 		for (int i = 0; i < MAX_PLAYERS; i++)
@@ -336,6 +355,10 @@ DROID *IdToDroid(UDWORD id, UDWORD player)
 // find off-world droids
 DROID *IdToMissionDroid(UDWORD id, UDWORD player)
 {
+	if (useObjectIdIndex && objectsOnlyOnCurrentLists())
+	{
+		return nullptr;  // Nothing is off world.
+	}
 	if (player == ANYPLAYER)
 	{
 		for (int i = 0; i < MAX_PLAYERS; i++)
@@ -366,6 +389,15 @@ DROID *IdToMissionDroid(UDWORD id, UDWORD player)
 // find a structure
 STRUCTURE *IdToStruct(UDWORD id, UDWORD player)
 {
+	if (useObjectIdIndex && objectsOnlyOnCurrentLists())
+	{
+		BASE_OBJECT *psObj = findObjectById(id);
+		if (psObj == nullptr || psObj->type != OBJ_STRUCTURE || (player != ANYPLAYER && psObj->player != player))
+		{
+			return nullptr;
+		}
+		return (STRUCTURE *)psObj;
+	}
 	int beginPlayer = 0, endPlayer = MAX_PLAYERS;
 	if (player != ANYPLAYER)
 	{
@@ -394,6 +426,15 @@ STRUCTURE *IdToStruct(UDWORD id, UDWORD player)
 FEATURE *IdToFeature(UDWORD id, UDWORD player)
 {
 	(void)player;	// unused, all features go into player 0
+	if (useObjectIdIndex && objectsOnlyOnCurrentLists())
+	{
+		BASE_OBJECT *psObj = findObjectById(id);
+		if (psObj == nullptr || psObj->type != OBJ_FEATURE)
+		{
+			return nullptr;
+		}
+		return (FEATURE *)psObj;
+	}
 	for (FEATURE *d = apsFeatureLists[0]; d; d = d->psNext)
 	{
 		if (d->id == id)
@@ -464,6 +505,113 @@ BASE_OBJECT *IdToPointer(UDWORD id, UDWORD player)
 	return nullptr;
 }
 
+ID_LOOKUP_BENCHMARK idLookupBenchmark(unsigned rounds)
+{
+	ID_LOOKUP_BENCHMARK result;
+	result.objects = 0;
+	result.dying = 0;
+	result.orders = 0;
+	result.indexedMicroseconds = 0;
+	result.searchedMicroseconds = 0;
+	result.mismatches = 0;
+
+	std::vector<BASE_OBJECT *> droids, targets;
+	for (unsigned player = 0; player < MAX_PLAYERS; ++player)
+	{
+		for (DROID *psDroid = apsDroidLists[player]; psDroid != nullptr; psDroid = psDroid->psNext)
+		{
+			droids.push_back(psDroid);
+			targets.push_back(psDroid);
+			if (isTransporter(psDroid) && psDroid->psGroup != nullptr)
+			{
+				// Not on a list, so IdToDroid() mustn't find these, but getBaseObjFromId() must.
+				for (DROID *psPassenger = psDroid->psGroup->psList; psPassenger != nullptr; psPassenger = psPassenger->psGrpNext)
+				{
+					if (psPassenger != psDroid)
+					{
+						targets.push_back(psPassenger);
+					}
+				}
+			}
+		}
+		for (STRUCTURE *psStruct = apsStructLists[player]; psStruct != nullptr; psStruct = psStruct->psNext)
+		{
+			targets.push_back(psStruct);
+		}
+	}
+	for (FEATURE *psFeature = apsFeatureLists[0]; psFeature != nullptr; psFeature = psFeature->psNext)
+	{
+		targets.push_back(psFeature);
+	}
+	result.objects = targets.size();
+	if (droids.empty())
+	{
+		return result;
+	}
+
+	// Like receiving an order: find the droid being ordered, then the object it is ordered to target.
+	auto processOrders = [&](std::vector<BASE_OBJECT *> &found) {
+		found.clear();
+		for (unsigned round = 0; round < rounds; ++round)
+		{
+			for (unsigned i = 0; i < droids.size(); ++i)
+			{
+				BASE_OBJECT *target = targets[(i * 7919 + round) % targets.size()];
+				found.push_back(IdToDroid(droids[i]->id, droids[i]->player));
+				found.push_back(IdToPointer(target->id, ANYPLAYER));
+			}
+		}
+	};
+
+	std::vector<BASE_OBJECT *> indexed, searched;
+	QElapsedTimer timer;
+	timer.start();
+	processOrders(indexed);
+	result.indexedMicroseconds = timer.nsecsElapsed() / 1000;
+
+	useObjectIdIndex = false;
+	timer.start();
+	processOrders(searched);
+	result.searchedMicroseconds = timer.nsecsElapsed() / 1000;
+	useObjectIdIndex = true;
+
+	result.orders = rounds * droids.size();
+	for (unsigned i = 0; i < indexed.size(); ++i)
+	{
+		result.mismatches += indexed[i] != searched[i];
+	}
+
+	// Objects killed this tick stay on their lists, with died set, until objmemUpdate(), and must still be found by ID.
+	// Make sure there are some, by marking the first droid and structure as dying while checking every object.
+	std::vector<BASE_OBJECT *> markedDying;
+	bool markedType[OBJ_NUM_TYPES] = {false};
+	for (BASE_OBJECT *psObj : targets)
+	{
+		if ((psObj->type == OBJ_DROID || psObj->type == OBJ_STRUCTURE) && psObj->died == 0 && !markedType[psObj->type])
+		{
+			markedType[psObj->type] = true;
+			markedDying.push_back(psObj);
+			psObj->died = gameTime + 1;
+		}
+	}
+	for (BASE_OBJECT *psObj : targets)
+	{
+		result.dying += isDead(psObj);
+		BASE_OBJECT *psIndexed = IdToPointer(psObj->id, psObj->player);
+		useObjectIdIndex = false;
+		BASE_OBJECT *psSearched = IdToPointer(psObj->id, psObj->player);
+		useObjectIdIndex = true;
+		result.mismatches += psIndexed != psSearched;
+		result.mismatches += getBaseObjFromId(psObj->id) != psObj;
+		result.mismatches += getBaseObjFromData(psObj->id, psObj->player, psObj->type) != psObj;
+	}
+	for (BASE_OBJECT *psObj : markedDying)
+	{
+		psObj->died = 0;
+	}
+	return result;
+}
+
 
 // ////////////////////////////////////////////////////////////////////////////
 // return a players name.
@@ -57,6 +57,7 @@ struct MULTIPLAYERGAME
 	uint8_t		skDiff[MAX_PLAYERS];		// skirmish game difficulty settings. 0x0=OFF 0xff=HUMAN
 	bool		mapHasScavengers;
 	bool		isMapMod;					// if a map has mods
+	uint8_t		pathSearch;					// path-finding search mode (FPATH_SEARCH_MODE), must match on all clients
 };
 
 struct MULTISTRUCTLIMITS
@@ -138,6 +139,19 @@ WZ_DECL_WARN_UNUSED_RESULT DROID			*IdToMissionDroid(UDWORD id, UDWORD player);
 WZ_DECL_WARN_UNUSED_RESULT FEATURE		*IdToFeature(UDWORD id, UDWORD player);
 WZ_DECL_WARN_UNUSED_RESULT DROID_TEMPLATE	*IdToTemplate(UDWORD tempId, UDWORD player);
 
+struct ID_LOOKUP_BENCHMARK
+{
+	unsigned objects;               ///< Number of droids, structures and features on the map, or in transporters on it.
+	unsigned dying;                 ///< Number of those checked while dying, some marked dying just for the check.
+	unsigned orders;                ///< Number of orders looked up each way, each finding a droid and its target.
+	uint64_t indexedMicroseconds;   ///< Time taken, finding objects by ID in the object ID index.
+	uint64_t searchedMicroseconds;  ///< Time taken, searching the object lists.
+	unsigned mismatches;            ///< Number of lookups which found something different each way.
+};
+/// Times finding the droids and targets of orders, like when receiving them, with and without the object ID index.
+/// Then checks that every object, including dying ones, is found the same way each way, and by getBaseObjFromId() and getBaseObjFromData().
+ID_LOOKUP_BENCHMARK idLookupBenchmark(unsigned rounds);
+
 const char *getPlayerName(int player);
 bool setPlayerName(int player, const char *sName);
 const char *getPlayerColourName(int player);
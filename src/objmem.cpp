@@ -24,6 +24,7 @@
  *
  */
 #include <string.h>
+#include <unordered_map>
 
 #include "lib/framework/frame.h"
 #include "objects.h"
@@ -69,6 +70,9 @@ FLAG_POSITION	*apsFlagPosLists[MAX_PLAYERS];
 /* The list of destroyed objects */
 BASE_OBJECT		*psDestroyedObj = nullptr;
 
+/// Every object which has been added to an object list and not yet freed, by ID, wherever it is now.
+static std::unordered_map<uint32_t, BASE_OBJECT *> objIdIndex;
+
 /* Forward function declarations */
 #ifdef DEBUG
 static void objListIntegCheck();
@@ -245,6 +249,57 @@ uint32_t generateSynchronisedObjectId()
 	return ret;
 }
 
+void setObjectId(BASE_OBJECT *psObj, uint32_t id)
+{
+	auto it = objIdIndex.find(psObj->id);
+	bool indexed = it != objIdIndex.end() && it->second == psObj;
+	if (indexed)
+	{
+		objIdIndex.erase(it);
+	}
+	psObj->id = id;
+	if (indexed)
+	{
+		objIdIndex[id] = psObj;
+	}
+}
+
+void objIdIndexAdd(BASE_OBJECT *psObj)
+{
+	objIdIndex[psObj->id] = psObj;
+}
+
+void objIdIndexRemove(BASE_OBJECT *psObj)
+{
+	auto it = objIdIndex.find(psObj->id);
+	if (it != objIdIndex.end() && it->second == psObj)
+	{
+		objIdIndex.erase(it);
+	}
+}
+
+BASE_OBJECT *findObjectById(uint32_t id)
+{
+	auto it = objIdIndex.find(id);
+	if (it == objIdIndex.end())
+	{
+		return nullptr;
+	}
+	return it->second;
+}
+
+bool objectsOnlyOnCurrentLists()
+{
+	for (unsigned player = 0; player < MAX_PLAYERS; ++player)
+	{
+		if (mission.apsDroidLists[player] != nullptr || mission.apsStructLists[player] != nullptr || mission.apsFeatureLists[player] != nullptr || apsLimboDroids[player] != nullptr)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
 /* Add the object to its list
  * \param list is a pointer to the object list
  */
@@ -282,6 +337,9 @@ static inline void destroyObject(OBJECT *list[], OBJECT *object)
 	ASSERT_OR_RETURN(, object != nullptr, "Invalid pointer");
 	ASSERT(gameTime - deltaGameTime <= gameTime || gameTime == 2, "Expected %u <= %u, bad time", gameTime - deltaGameTime, gameTime);
 
+	// Searching the lists never found objects on the destroyed list, so neither does findObjectById().
+	objIdIndexRemove(object);
+
 	// If the message to remove is the first one in the list then mark the next one as the first
 	if (list[object->player] == object)
 	{
@@ -417,6 +475,7 @@ void addDroid(DROID *psDroidToAdd, DROID *pList[MAX_PLAYERS])
 	DROID_GROUP	*psGroup;
 
 	addObjectToList(pList, psDroidToAdd, psDroidToAdd->player);
+	objIdIndexAdd(psDroidToAdd);
 
 	/* Whenever a droid gets added to a list other than the current list
 	 * its died flag is set to NOT_CURRENT_LIST so that anything targetting
@@ -520,6 +579,7 @@ void freeAllLimboDroids()
 void addStructure(STRUCTURE *psStructToAdd)
 {
 	addObjectToList(apsStructLists, psStructToAdd, psStructToAdd->player);
+	objIdIndexAdd(psStructToAdd);
 	if (psStructToAdd->pStructureType->pSensor
 	    && psStructToAdd->pStructureType->pSensor->location == LOC_TURRET)
 	{
@@ -622,6 +682,7 @@ void removeStructureFromList(STRUCTURE *psStructToRemove, STRUCTURE *pList[MAX_P
 void addFeature(FEATURE *psFeatureToAdd)
 {
 	addObjectToList(apsFeatureLists, psFeatureToAdd, 0);
+	objIdIndexAdd(psFeatureToAdd);
 	if (psFeatureToAdd->psStats->subType == FEAT_OIL_RESOURCE)
 	{
 		addObjectToFuncList(apsOilList, psFeatureToAdd, 0);
@@ -771,59 +832,10 @@ void checkFactoryFlags()
 // Find a base object from it's id
 BASE_OBJECT *getBaseObjFromData(unsigned id, unsigned player, OBJECT_TYPE type)
 {
-	BASE_OBJECT		*psObj;
-	DROID			*psTrans;
-
-	for (int i = 0; i < 3; ++i)
+	BASE_OBJECT *psObj = findObjectById(id);
+	if (psObj != nullptr && psObj->type == type && (type == OBJ_FEATURE || psObj->player == player))
 	{
-		psObj = nullptr;
-		switch (i)
-		{
-		case 0:
-			switch (type)
-			{
-			case OBJ_DROID: psObj = apsDroidLists[player]; break;
-			case OBJ_STRUCTURE: psObj = apsStructLists[player]; break;
-			case OBJ_FEATURE: psObj = apsFeatureLists[0];
-			default: break;
-			}
-			break;
-		case 1:
-			switch (type)
-			{
-			case OBJ_DROID: psObj = mission.apsDroidLists[player]; break;
-			case OBJ_STRUCTURE: psObj = mission.apsStructLists[player]; break;
-			case OBJ_FEATURE: psObj = mission.apsFeatureLists[0]; break;
-			default: break;
-			}
-			break;
-		case 2:
-			if (player == 0 && type == OBJ_DROID)
-			{
-				psObj = apsLimboDroids[0];
-			}
-			break;
-		}
-
-		while (psObj)
-		{
-			if (psObj->id == id)
-			{
-				return psObj;
-			}
-			// if transporter check any droids in the grp
-			if ((psObj->type == OBJ_DROID) && isTransporter((DROID *)psObj))
-			{
-				for (psTrans = ((DROID *)psObj)->psGroup->psList; psTrans != nullptr; psTrans = psTrans->psGrpNext)
-				{
-					if (psTrans->id == id)
-					{
-						return (BASE_OBJECT *)psTrans;
-					}
-				}
-			}
-			psObj = psObj->psNext;
-		}
+		return psObj;
 	}
 	ASSERT(false, "failed to find id %d for player %d", id, player);
 
@@ -833,88 +845,10 @@ BASE_OBJECT *getBaseObjFromData(unsigned id, unsigned player, OBJECT_TYPE type)
 // Find a base object from it's id
 BASE_OBJECT *getBaseObjFromId(UDWORD id)
 {
-	unsigned int i;
-	UDWORD			player;
-	BASE_OBJECT		*psObj;
-	DROID			*psTrans;
+	BASE_OBJECT *psObj = findObjectById(id);
+	ASSERT(psObj != nullptr, "getBaseObjFromId() failed for id %d", id);
 
-	for (i = 0; i < 7; ++i)
-	{
-		for (player = 0; player < MAX_PLAYERS; ++player)
-		{
-			switch (i)
-			{
-			case 0:
-				psObj = (BASE_OBJECT *)apsDroidLists[player];
-				break;
-			case 1:
-				psObj = (BASE_OBJECT *)apsStructLists[player];
-				break;
-			case 2:
-				if (player == 0)
-				{
-					psObj = (BASE_OBJECT *)apsFeatureLists[0];
-				}
-				else
-				{
-					psObj = nullptr;
-				}
-				break;
-			case 3:
-				psObj = (BASE_OBJECT *)mission.apsDroidLists[player];
-				break;
-			case 4:
-				psObj = (BASE_OBJECT *)mission.apsStructLists[player];
-				break;
-			case 5:
-				if (player == 0)
-				{
-					psObj = (BASE_OBJECT *)mission.apsFeatureLists[0];
-				}
-				else
-				{
-					psObj = nullptr;
-				}
-				break;
-			case 6:
-				if (player == 0)
-				{
-					psObj = (BASE_OBJECT *)apsLimboDroids[0];
-				}
-				else
-				{
-					psObj = nullptr;
-				}
-				break;
-			default:
-				psObj = nullptr;
-				break;
-			}
-
-			while (psObj)
-			{
-				if (psObj->id == id)
-				{
-					return psObj;
-				}
-				// if transporter check any droids in the grp
-				if ((psObj->type == OBJ_DROID) && isTransporter((DROID *)psObj))
-				{
-					for (psTrans = ((DROID *)psObj)->psGroup->psList; psTrans != nullptr; psTrans = psTrans->psGrpNext)
-					{
-						if (psTrans->id == id)
-						{
-							return (BASE_OBJECT *)psTrans;
-						}
-					}
-				}
-				psObj = psObj->psNext;
-			}
-		}
-	}
-	ASSERT(!"couldn't find a BASE_OBJ with ID", "getBaseObjFromId() failed for id %d", id);
-
-	return nullptr;
+	return psObj;
 }
 
 UDWORD getRepairIdFromFlag(FLAG_POSITION *psFlag)
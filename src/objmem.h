@@ -101,6 +101,17 @@ void removeFlagPosition(FLAG_POSITION *psDel);
 void freeAllFlagPositions();
 void freeAllAssemblyPoints();
 
+/// Changes the ID of an object, keeping it findable by its new ID.
+void setObjectId(BASE_OBJECT *psObj, uint32_t id);
+/// Finds an object by its ID from now on, called when adding it to an object list or a transporter.
+void objIdIndexAdd(BASE_OBJECT *psObj);
+/// Stops finding an object by its ID, called when destroying or freeing it.
+void objIdIndexRemove(BASE_OBJECT *psObj);
+/// Finds an object on an object list, off world, in limbo or in a transporter, even if dying, but not once moved to the destroyed list. Returns nullptr if there is none.
+BASE_OBJECT *findObjectById(uint32_t id);
+/// Returns true if the mission and limbo lists are empty, so every object findObjectById() can return is on the current lists, or in a transporter on them.
+bool objectsOnlyOnCurrentLists();
+
 // Find a base object from it's id
 BASE_OBJECT *getBaseObjFromData(unsigned id, unsigned player, OBJECT_TYPE type);
 BASE_OBJECT *getBaseObjFromId(UDWORD id);
@@ -77,24 +77,74 @@ static uint64_t interleave(int32_t x, int32_t y)
 	return expandX(x) | expandY(y);
 }
 
-void PointTree::insert(void *pointData, int32_t x, int32_t y)
+void PointTree::insert(void *pointData, int32_t x, int32_t y, uint32_t order)
 {
-	points.push_back(Point(interleave(x, y), pointData));
+	points.push_back(Point(interleave(x, y), order, pointData));
 }
 
 void PointTree::clear()
 {
 	points.clear();
+	numSorted = 0;
 }
 
-static bool pointTreeSortFunction(std::pair<uint64_t, void *> const &a, std::pair<uint64_t, void *> const &b)
+template<typename Point>
+static bool pointTreeSortFunction(Point const &a, Point const &b)
 {
-	return a.first < b.first;  // Sort only by position, not by pointer address, even if two units are in the same place.
+	return a.key < b.key;  // Search only by position.
+}
+
+template<typename Point>
+static bool pointTreeOrderFunction(Point const &a, Point const &b)
+{
+	return a.key < b.key || (a.key == b.key && a.order < b.order);  // Sort by position, then order, but not by pointer address, even if two units are in the same place.
 }
 
 void PointTree::sort()
 {
-	std::stable_sort(points.begin(), points.end(), pointTreeSortFunction);  // Stable sort to avoid unspecified behaviour when two objects are in exactly the same place.
+	std::stable_sort(points.begin(), points.end(), pointTreeOrderFunction<Point>);  // Stable sort to avoid unspecified behaviour when two objects are in exactly the same place.
+	numSorted = points.size();
+}
+
+void PointTree::move(unsigned index, int32_t x, int32_t y, uint32_t order)
+{
+	points[index].key = interleave(x, y);
+	points[index].order = order;
+}
+
+unsigned PointTree::resort()
+{
+	// Insertion sort the points which were sorted before, since most didn't move, and those which did, probably didn't move far.
+	// If too many points moved too far, finish with a normal sort. Both are stable, so the result is the same as sort().
+	size_t maxShifts = 8 * numSorted + 64;
+	unsigned shifts = 0;
+	Vector::iterator sortedEnd = points.begin() + numSorted;
+	for (Vector::iterator i = points.begin(); i != sortedEnd; ++i)
+	{
+		if (i == points.begin() || !pointTreeOrderFunction(*i, i[-1]))
+		{
+			continue;
+		}
+		Point point = *i;
+		Vector::iterator j = i;
+		for (; j != points.begin() && pointTreeOrderFunction(point, j[-1]); --j)
+		{
+			*j = j[-1];
+			++shifts;
+		}
+		*j = point;
+		if (shifts > maxShifts)
+		{
+			std::stable_sort(points.begin(), sortedEnd, pointTreeOrderFunction<Point>);
+			break;
+		}
+	}
+
+	// Sort the new points, and merge them in.
+	std::stable_sort(sortedEnd, points.end(), pointTreeOrderFunction<Point>);
+	std::inplace_merge(points.begin(), sortedEnd, points.end(), pointTreeOrderFunction<Point>);
+	numSorted = points.size();
+	return shifts;
 }
 
 //#define DUMP_IMAGE  // All x and y coordinates must be in range -500 to 499, if dumping an image.
@@ -128,8 +178,8 @@ static unsigned current(std::vector<unsigned> &filterData, unsigned i)
 	return ret;
 }
 
-template<bool IsFiltered>
-PointTree::ResultVector &PointTree::queryMaybeFilter(Filter &filter, int32_t minXo, int32_t minYo, int32_t maxXo, int32_t maxYo)
+template<bool IsFiltered, bool WantIndices>
+void PointTree::queryMaybeFilter(Filter &filter, ResultVector &results, IndexVector &filteredIndices, int32_t minXo, int32_t minYo, int32_t maxXo, int32_t maxYo) const
 {
 	uint64_t minX = expandX(minXo);
 	uint64_t maxX = expandX(maxXo);
@@ -225,34 +275,34 @@ PointTree::ResultVector &PointTree::queryMaybeFilter(Filter &filter, int32_t min
 		--numRanges;
 	}
 
-	lastQueryResults.clear();
-	if (IsFiltered)
+	results.clear();
+	if (WantIndices)
 	{
-		lastFilteredQueryIndices.clear();
+		filteredIndices.clear();
 	}
 	for (int r = 0; r != numRanges; ++r)
 	{
 		// Find range of points which may be close enough. Range is [i1 ... i2 - 1]. The pointers are ignored when searching.
-		unsigned i1 = std::lower_bound(points.begin(),      points.end(), Point(ranges[r].a, (void *)nullptr), pointTreeSortFunction) - points.begin();
-		unsigned i2 = std::upper_bound(points.begin() + i1, points.end(), Point(ranges[r].z, (void *)nullptr), pointTreeSortFunction) - points.begin();
+		unsigned i1 = std::lower_bound(points.begin(),      points.end(), Point(ranges[r].a, 0, nullptr), pointTreeSortFunction<Point>) - points.begin();
+		unsigned i2 = std::upper_bound(points.begin() + i1, points.end(), Point(ranges[r].z, 0, nullptr), pointTreeSortFunction<Point>) - points.begin();
 
 		for (unsigned i = current<IsFiltered>(filter.data, i1); i < i2; i = current<IsFiltered>(filter.data, i + 1))
 		{
-			uint64_t px = points[i].first & 0xAAAAAAAAAAAAAAAAULL;
-			uint64_t py = points[i].first & 0x5555555555555555ULL;
+			uint64_t px = points[i].key & 0xAAAAAAAAAAAAAAAAULL;
+			uint64_t py = points[i].key & 0x5555555555555555ULL;
 			if (px >= minX && px <= maxX && py >= minY && py <= maxY)  // Only add point if it's at least in the desired square.
 			{
-				lastQueryResults.push_back(points[i].second);
-				if (IsFiltered)
+				results.push_back(points[i].data);
+				if (WantIndices)
 				{
-					lastFilteredQueryIndices.push_back(i);
+					filteredIndices.push_back(i);
 				}
 #ifdef DUMP_IMAGE
 				if (doDump)
 				{
-					ppm[((int32_t *)points[i].second)[1] + 500][((int32_t *)points[i].second)[0] + 500][0] = 192;
-					ppm[((int32_t *)points[i].second)[1] + 500][((int32_t *)points[i].second)[0] + 500][1] = 128;
-					ppm[((int32_t *)points[i].second)[1] + 500][((int32_t *)points[i].second)[0] + 500][2] = 0;
+					ppm[((int32_t *)points[i].data)[1] + 500][((int32_t *)points[i].data)[0] + 500][0] = 192;
+					ppm[((int32_t *)points[i].data)[1] + 500][((int32_t *)points[i].data)[0] + 500][1] = 128;
+					ppm[((int32_t *)points[i].data)[1] + 500][((int32_t *)points[i].data)[0] + 500][2] = 0;
 				}
 #endif //DUMP_IMAGE
 			}
@@ -266,31 +316,55 @@ PointTree::ResultVector &PointTree::queryMaybeFilter(Filter &filter, int32_t min
 		fclose(f);
 	}
 #endif //DUMP_IMAGE
+}
+
+void PointTree::query(ResultVector &results, int32_t x, int32_t y, uint32_t x2, uint32_t y2) const
+{
+	static Filter unused;  // Not touched by unfiltered queries, so can be shared between threads.
+	static IndexVector unusedIndices;
+	queryMaybeFilter<false, false>(unused, results, unusedIndices, x, y, x2, y2);
+}
 
-	return lastQueryResults;
+void PointTree::query(ResultVector &results, IndexVector &indices, int32_t x, int32_t y, uint32_t x2, uint32_t y2) const
+{
+	static Filter unused;  // Not touched by unfiltered queries, so can be shared between threads.
+	queryMaybeFilter<false, true>(unused, results, indices, x, y, x2, y2);
+}
+
+// Inverse of expand().
+static uint32_t compact(uint64_t r)
+{
+	r &= 0x5555555555555555ULL;
+	r = (r | r >> 1)  & 0x3333333333333333ULL;
+	r = (r | r >> 2)  & 0x0F0F0F0F0F0F0F0FULL;
+	r = (r | r >> 4)  & 0x00FF00FF00FF00FFULL;
+	r = (r | r >> 8)  & 0x0000FFFF0000FFFFULL;
+	r = (r | r >> 16) & 0x00000000FFFFFFFFULL;
+	return r;
 }
 
-PointTree::ResultVector &PointTree::query(int32_t x, int32_t y, uint32_t x2, uint32_t y2)
+void PointTree::pointPosition(unsigned index, int32_t &x, int32_t &y) const
 {
-	Filter unused;
-	return queryMaybeFilter<false>(unused, x, y, x2, y2);
+	x = compact(points[index].key >> 1) - 0x80000000u;
+	y = compact(points[index].key) - 0x80000000u;
 }
 
-PointTree::ResultVector &PointTree::query(int32_t x, int32_t y, uint32_t radius)
+void PointTree::query(ResultVector &results, int32_t x, int32_t y, uint32_t radius) const
 {
-	Filter unused;
+	static Filter unused;  // Not touched by unfiltered queries, so can be shared between threads.
+	static IndexVector unusedIndices;
 	int32_t minXo = x - radius;
 	int32_t maxXo = x + radius;
 	int32_t minYo = y - radius;
 	int32_t maxYo = y + radius;
-	return queryMaybeFilter<false>(unused, minXo, minYo, maxXo, maxYo);
+	queryMaybeFilter<false, false>(unused, results, unusedIndices, minXo, minYo, maxXo, maxYo);
 }
 
-PointTree::ResultVector &PointTree::query(Filter &filter, int32_t x, int32_t y, uint32_t radius)
+void PointTree::query(ResultVector &results, IndexVector &filteredIndices, Filter &filter, int32_t x, int32_t y, uint32_t radius) const
 {
 	int32_t minXo = x - radius;
 	int32_t maxXo = x + radius;
 	int32_t minYo = y - radius;
 	int32_t maxYo = y + radius;
-	return queryMaybeFilter<true>(filter, minXo, minYo, maxXo, maxYo);
+	queryMaybeFilter<true, true>(filter, results, filteredIndices, minXo, minYo, maxXo, maxYo);
 }
@@ -23,6 +23,7 @@
 #include "lib/framework/types.h"
 
 #include <vector>
+#include <algorithm>
 
 class PointTree
 {
@@ -51,31 +52,77 @@ public:
 		Data data;
 	};
 
-	void insert(void *pointData, int32_t x, int32_t y);                       ///< Inserts a point into the point tree.
+	/// Inserts a point into the point tree. Points in the same place are sorted by order, and then by when they were inserted.
+	void insert(void *pointData, int32_t x, int32_t y, uint32_t order = 0);
 	void clear();                                                             ///< Clears the PointTree.
 	void sort();                                                              ///< Must be done between inserting and querying, to get meaningful results.
-	/// Returns all points less than or equal to radius from (x, y), possibly plus some extra nearby points.
-	/// (More specifically, returns all objects in a square with edge length 2*radius.)
-	/// Note: Not thread safe, because it modifies lastQueryResults.
-	ResultVector &query(int32_t x, int32_t y, uint32_t radius);
-	/// Returns all points which have not been filtered away, less than or equal to radius from (x, y), possibly plus some extra nearby points.
-	/// (More specifically, returns objects in a square with edge length 2*radius.)
-	/// Note: Not thread safe, because it modifies lastQueryResults, lastFilteredQueryIndices and the internal filter representation for faster lookups.
-	ResultVector &query(Filter &filter, int32_t x, int32_t y, uint32_t radius);
-	/// Returns all points which have not been filtered away within given rectangle. See function above on thread safety.
-	ResultVector &query(int32_t x, int32_t y, uint32_t x2, uint32_t y2);
-
-	ResultVector lastQueryResults;
-	IndexVector lastFilteredQueryIndices;
+
+	// For updating the PointTree incrementally, instead of clearing it and inserting everything again.
+	size_t size() const                                                       ///< Number of points in the PointTree.
+	{
+		return points.size();
+	}
+	void *pointData(unsigned index) const                                     ///< The pointData of a point, in the order the points are sorted.
+	{
+		return points[index].data;
+	}
+	void move(unsigned index, int32_t x, int32_t y, uint32_t order);         ///< Moves a point. Must call resort() before querying.
+	void pointPosition(unsigned index, int32_t &x, int32_t &y) const;        ///< Where the point was inserted or moved to. Queries use this, not where the pointData is now.
+	/// Erases all points where pred(pointData) is true. Must call resort() before querying, if any points were moved or inserted.
+	template<typename Pred>
+	unsigned eraseIf(Pred const &pred)
+	{
+		unsigned w = 0;
+		for (unsigned i = 0; i != points.size(); ++i)
+		{
+			if (i == numSorted)
+			{
+				numSorted = w;  // Points inserted since the last sort start here now.
+			}
+			if (!pred(points[i].data))
+			{
+				points[w++] = points[i];
+			}
+		}
+		unsigned numErased = points.size() - w;
+		numSorted = std::min<size_t>(numSorted, w);
+		points.erase(points.begin() + w, points.end());
+		return numErased;
+	}
+	/// Same as sort(), but much faster if only a few points were moved or inserted since sorting.
+	/// Returns the number of points it had to shift, to fix the moved points.
+	unsigned resort();
+	// Queries put the points found in results, so any number of queries may be done at the same time, from any number of threads, as long as
+	// the PointTree is not modified meanwhile, and each query has its own results.
+
+	/// Finds all points less than or equal to radius from (x, y), possibly plus some extra nearby points.
+	/// (More specifically, finds all objects in a square with edge length 2*radius.)
+	void query(ResultVector &results, int32_t x, int32_t y, uint32_t radius) const;
+	/// Finds all points which have not been filtered away, less than or equal to radius from (x, y), possibly plus some extra nearby points.
+	/// (More specifically, finds objects in a square with edge length 2*radius.) The index of each point is put in filteredIndices, for erasing from the filter.
+	/// Note: Modifies the filter, for faster lookups, so queries using the same filter must not be done at the same time.
+	void query(ResultVector &results, IndexVector &filteredIndices, Filter &filter, int32_t x, int32_t y, uint32_t radius) const;
+	/// Finds all points within given rectangle.
+	void query(ResultVector &results, int32_t x, int32_t y, uint32_t x2, uint32_t y2) const;
+	/// Finds all points within given rectangle, and puts the index of each point in indices, for use with pointPosition().
+	void query(ResultVector &results, IndexVector &indices, int32_t x, int32_t y, uint32_t x2, uint32_t y2) const;
 
 private:
-	typedef std::pair<uint64_t, void *> Point;
+	struct Point
+	{
+		Point(uint64_t key_, uint32_t order_, void *data_) : key(key_), order(order_), data(data_) {}
+
+		uint64_t key;    ///< Position, as a Morton number.
+		uint32_t order;  ///< For sorting points in the same place.
+		void *data;
+	};
 	typedef std::vector<Point> Vector;
 
-	template<bool IsFiltered>
-	ResultVector &queryMaybeFilter(Filter &filter, int32_t minXo, int32_t maxXo, int32_t minYo, int32_t maxYo);
+	template<bool IsFiltered, bool WantIndices>
+	void queryMaybeFilter(Filter &filter, ResultVector &results, IndexVector &filteredIndices, int32_t minXo, int32_t maxXo, int32_t minYo, int32_t maxYo) const;
 
 	Vector points;
+	size_t numSorted = 0;  ///< Points after this were inserted since sorting.
 };
 
 #endif //_point_tree_h
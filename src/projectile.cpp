@@ -59,7 +59,9 @@
 
 #include <algorithm>
 #include <functional>
+#include <type_traits>
 #include <glm/gtx/transform.hpp>
+#include <QtCore/QElapsedTimer>
 
 #define VTOL_HITBOX_MODIFICATOR 100
 
@@ -76,12 +78,66 @@ struct INTERVAL
 // Watermelon:they are from droid.c
 /* The range for neighbouring objects */
 #define PROJ_NEIGHBOUR_RANGE (TILE_UNITS*4)
+// Projectiles in the same cell share one search for neighbours to collide with.
+#define PROJ_NEIGHBOUR_CELL_SIZE (TILE_UNITS*2)
 // used to create a specific ID for projectile objects to facilitate tracking them.
 static const UDWORD ProjectileTrackerID =	0xdead0000;
 
 /* The list of projectiles in play */
 static std::vector<PROJECTILE *> psProjectileList;
 
+/// Allocates projectiles in chunks, so projectiles fired around the same time are near each other in memory, and freed projectiles are reused
+/// while still in the cache, instead of calling new and delete for every shot. Projectiles never move, since other things point at them.
+class ProjectilePool
+{
+public:
+	~ProjectilePool()
+	{
+		for (Slot *chunk : chunks)
+		{
+			delete[] chunk;
+		}
+	}
+
+	PROJECTILE *create(uint32_t id, unsigned player)
+	{
+		if (freeSlots.empty())
+		{
+			Slot *chunk = new Slot[CHUNK_SIZE];
+			chunks.push_back(chunk);
+			for (unsigned i = CHUNK_SIZE; i-- > 0;)
+			{
+				freeSlots.push_back(&chunk[i]);  // Backwards, so the first slot of the chunk is used first.
+			}
+		}
+		void *slot = freeSlots.back();
+		freeSlots.pop_back();
+		return new(slot) PROJECTILE(id, player);
+	}
+
+	void destroy(PROJECTILE *psProj)
+	{
+		psProj->~PROJECTILE();
+		freeSlots.push_back(reinterpret_cast<Slot *>(psProj));
+	}
+
+	size_t capacity() const
+	{
+		return chunks.size() * CHUNK_SIZE;
+	}
+
+private:
+	enum {CHUNK_SIZE = 256};
+	typedef std::aligned_storage<sizeof(PROJECTILE), alignof(PROJECTILE)>::type Slot;
+
+	std::vector<Slot *> chunks;
+	std::vector<Slot *> freeSlots;  ///< Used as a stack, so the most recently freed slot is reused first.
+};
+
+static ProjectilePool projectilePool;
+static PROJECTILE_STATISTICS projectileStats;
+static GridSearchCache projNeighbourSearches(PROJ_NEIGHBOUR_CELL_SIZE, TILE_UNITS);
+
 /* The next projectile to give out in the proj_First / proj_Next methods */
 static ProjectileIterator psProjectileNext;
 
@@ -202,6 +258,10 @@ proj_InitSystem()
 void
 proj_FreeAllProjectiles()
 {
+	for (PROJECTILE *psProj : psProjectileList)
+	{
+		projectilePool.destroy(psProj);
+	}
 	psProjectileList.clear();
 	psProjectileNext = psProjectileList.end();
 }
@@ -415,7 +475,7 @@ bool proj_SendProjectileAngled(WEAPON *psWeap, SIMPLE_OBJECT *psAttacker, int pl
 	ASSERT_OR_RETURN(false, psStats != nullptr, "Invalid weapon stats");
 	ASSERT_OR_RETURN(false, psTarget == nullptr || !psTarget->died, "Aiming at dead target!");
 
-	PROJECTILE *psProj = new PROJECTILE(ProjectileTrackerID | (realTime >> 4), player);
+	PROJECTILE *psProj = projectilePool.create(ProjectileTrackerID | (realTime >> 4), player);
 
 	/* get muzzle offset */
 	if (psAttacker == nullptr)
@@ -648,6 +708,13 @@ static INTERVAL collisionXY(int32_t x1, int32_t y1, int32_t x2, int32_t y2, int3
 	return ret;
 }
 
+/// Returns true if going from v1 to v2 can't get within the shape horizontally, in which case collisionXYZ() would return -1 whatever the height.
+static bool collisionMissesXY(Vector3i v1, Vector3i v2, ObjectShape shape)
+{
+	return std::min(v1.x, v2.x) > shape.size.x || std::max(v1.x, v2.x) < -shape.size.x ||
+	       std::min(v1.y, v2.y) > shape.size.y || std::max(v1.y, v2.y) < -shape.size.y;
+}
+
 static int32_t collisionXYZ(Vector3i v1, Vector3i v2, ObjectShape shape, int32_t height)
 {
 	INTERVAL i = collisionZ(v1.z, v2.z, height);
@@ -798,7 +865,7 @@ static void proj_InFlightFunc(PROJECTILE *psProj)
 
 	/* Check nearby objects for possible collisions */
 	static GridList gridList;  // static to avoid allocations.
-	gridList = gridStartIterate(psProj->pos.x, psProj->pos.y, PROJ_NEIGHBOUR_RANGE);
+	projNeighbourSearches.search(gridList, psProj->pos.x, psProj->pos.y, PROJ_NEIGHBOUR_RANGE);
 	for (GridIterator gi = gridList.begin(); gi != gridList.end(); ++gi)
 	{
 		BASE_OBJECT *psTempObj = *gi;
@@ -838,8 +905,15 @@ static void proj_InFlightFunc(PROJECTILE *psProj)
 
 		const Vector3i diff = psProj->pos - psTempObj->pos;
 		const Vector3i prevDiff = psProj->prevSpacetime.pos - psTempObjPrevPos;
-		const unsigned int targetHeight = establishTargetHeight(psTempObj);
 		const ObjectShape targetShape = establishTargetShape(psTempObj);
+		++projectileStats.collisionChecks;
+		if (collisionMissesXY(prevDiff, diff, targetShape))
+		{
+			// Not even close, so don't bother working out the height
+			++projectileStats.collisionsSkipped;
+			continue;
+		}
+		const unsigned int targetHeight = establishTargetHeight(psTempObj);
 		const int32_t collision = collisionXYZ(prevDiff, diff, targetShape, targetHeight);
 		const uint32_t collisionTime = psProj->prevSpacetime.time + (psProj->time - psProj->prevSpacetime.time) * collision / 1024;
 
@@ -1324,13 +1398,39 @@ void PROJECTILE::update()
 // iterate through all projectiles and update their status
 void proj_UpdateAll()
 {
-	std::vector<PROJECTILE *> psProjectileListOld = psProjectileList;
+	QElapsedTimer timer;
+	timer.start();
 
-	// Update all projectiles. Penetrating projectiles may add to psProjectileList.
-	std::for_each(psProjectileListOld.begin(), psProjectileListOld.end(), std::mem_fun(&PROJECTILE::update));
+	// Update all projectiles. Penetrating projectiles may add to the end of psProjectileList, but nothing is removed until all are updated,
+	// so indexing is enough to only update the projectiles which already existed, without copying the list.
+	size_t numProjectiles = psProjectileList.size();
+	for (size_t i = 0; i != numProjectiles; ++i)
+	{
+		psProjectileList[i]->update();
+	}
 
 	// Remove and free dead projectiles.
-	psProjectileList.erase(std::remove_if(psProjectileList.begin(), psProjectileList.end(), std::mem_fun(&PROJECTILE::deleteIfDead)), psProjectileList.end());
+	psProjectileList.erase(std::remove_if(psProjectileList.begin(), psProjectileList.end(), [](PROJECTILE *psProj) {
+		if (!psProj->isDeadForGood())
+		{
+			return false;
+		}
+		projectilePool.destroy(psProj);
+		return true;
+	}), psProjectileList.end());
+
+	++projectileStats.updates;
+	projectileStats.projectilesUpdated += numProjectiles;
+	projectileStats.nanoseconds += timer.nsecsElapsed();
+	projectileStats.maxProjectiles = std::max<uint64_t>(projectileStats.maxProjectiles, numProjectiles);
+	projectileStats.poolCapacity = projectilePool.capacity();
+	projectileStats.neighbourSearches = projNeighbourSearches.statistics().lookups;
+	projectileStats.neighbourSearchesShared = projNeighbourSearches.statistics().hits;
+}
+
+PROJECTILE_STATISTICS proj_GetStatistics()
+{
+	return projectileStats;
 }
 
 /***************************************************************************/
@@ -55,6 +55,20 @@ PROJECTILE *proj_GetNext();		///< Get next projectile in the list.
 
 void	proj_FreeAllProjectiles();	///< Free all projectiles in the list.
 
+struct PROJECTILE_STATISTICS
+{
+	uint64_t updates = 0;                  ///< Number of proj_UpdateAll() calls.
+	uint64_t projectilesUpdated = 0;       ///< Total number of projectiles updated.
+	uint64_t nanoseconds = 0;              ///< Total time spent in proj_UpdateAll().
+	uint64_t maxProjectiles = 0;           ///< Most projectiles updated in one tick.
+	uint64_t poolCapacity = 0;             ///< Number of projectiles there is memory for.
+	uint64_t neighbourSearches = 0;        ///< Number of searches for objects a projectile might hit.
+	uint64_t neighbourSearchesShared = 0;  ///< Number of those which reused a grid search from a nearby projectile.
+	uint64_t collisionChecks = 0;          ///< Number of objects a projectile might have hit.
+	uint64_t collisionsSkipped = 0;        ///< Number of those which were not even close.
+};
+PROJECTILE_STATISTICS proj_GetStatistics();
+
 void setExpGain(int player, int gain);
 int getExpGain(int player);
 
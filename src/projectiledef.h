@@ -43,13 +43,9 @@ struct PROJECTILE : public SIMPLE_OBJECT
 	PROJECTILE(uint32_t id, unsigned player) : SIMPLE_OBJECT(OBJ_PROJECTILE, id, player) {}
 
 	void            update();
-	bool            deleteIfDead()
+	bool            isDeadForGood() const  ///< True once nothing can be looking at the projectile any more, so it can be freed.
 	{
-		if (died == 0 || died >= gameTime - deltaGameTime)
-		{
-			return false;
-		} delete this;
-		return true;
+		return died != 0 && died < gameTime - deltaGameTime;
 	}
 
 
@@ -56,6 +56,7 @@
 #include <QtCore/QTextStream>
 #include <QtCore/QHash>
 #include <QtScript/QScriptEngine>
+#include <QtScript/QScriptString>
 #include <QtScript/QScriptValue>
 #include <QtScript/QScriptValueIterator>
 #include <QtScript/QScriptSyntaxCheckResult>
@@ -82,7 +83,10 @@
 #include "mission.h"
 #include "modding.h"
 
+#include <algorithm>
+#include <climits>
 #include <set>
+#include <vector>
 #include <utility>
 
 #include "qtscriptdebug.h"
@@ -99,12 +103,15 @@ extern bool doUpdateModels; // ugh-ly hack; fix with signal when moc-ing this fi
 
 enum timerType
 {
-	TIMER_REPEAT, TIMER_ONESHOT_READY, TIMER_ONESHOT_DONE
+	TIMER_REPEAT, TIMER_ONESHOT_READY, TIMER_ONESHOT_DONE  ///< Done oneshots are only found in old savegames.
 };
 
+struct ScriptHandler;
+
 struct timerNode
 {
 	QString function;
+	ScriptHandler *handler;  ///< function in engine, found when the timer first runs.
 	QScriptEngine *engine;
 	int baseobj;
 	OBJECT_TYPE baseobjtype;
@@ -114,23 +121,113 @@ struct timerNode
 	int player;
 	int calls;
 	timerType type;
-	timerNode() : engine(nullptr), baseobjtype(OBJ_NUM_TYPES) {}
+	uint32_t sequence;  ///< Order in which the timer was (re)scheduled, to break ties between timers due at the same time.
+	timerNode() : handler(nullptr), engine(nullptr), baseobjtype(OBJ_NUM_TYPES), sequence(0) {}
 	timerNode(QScriptEngine *caller, QString val, int plr, int frame)
-		: function(std::move(val)), engine(caller), baseobj(-1), baseobjtype(OBJ_NUM_TYPES), frameTime(frame + gameTime), ms(frame), player(plr), calls(0), type(TIMER_REPEAT) {}
+		: function(std::move(val)), handler(nullptr), engine(caller), baseobj(-1), baseobjtype(OBJ_NUM_TYPES), frameTime(std::max(frame, 0) + gameTime), ms(frame), player(plr), calls(0), type(TIMER_REPEAT), sequence(0) {}
 	bool operator== (const timerNode &t)
 	{
 		return function == t.function && player == t.player;
 	}
-	// implement operator less TODO
 };
 
 #define MAX_US 20000
 #define HALF_MAX_US 10000
 
-/// List of timer events for scripts. Before running them, we sort the list then run as many as we have time for.
-/// In this way, we implement load balancing of events and keep frame rates tidy for users. Since scripts run on the
-/// host, we do not need to worry about each peer simulating the world differently.
-static QList<timerNode> timers;
+/// Timers of each engine run per game tick regardless of load. Timers due beyond the budget wait for a later tick.
+#define SCRIPT_TIMER_BUDGET_MIN 4
+/// Timers that are already this many milliseconds late run even if the budget is used up.
+#define SCRIPT_TIMER_MAX_DELAY 500
+
+/// Timer events for scripts, as a heap with the timer that is due first in front. Each game tick runs the due timers
+/// in order, up to a budget, so that timers which happen to fall due together are spread over the following ticks
+/// instead of all running at once. The budget counts timers rather than time spent, so that every peer runs the
+/// same timers on the same tick. Each engine has its own budget, sized by its own timers, since AI scripts only run
+/// on the host, and must not change when the scripts running on every peer get to run their timers.
+static std::vector<timerNode> timers;
+
+/// Timers taken off the heap while running them this tick. They are kept here so that removeTimer() and
+/// scriptRemoveObject() can still find them, and repeating timers go back on the heap afterwards.
+static std::vector<timerNode> timersFired;
+
+/// Timers which are due, but taken off the heap this tick since their engine used up its budget. Kept here, like
+/// timersFired, and put back on the heap after running the timers of the other engines.
+static std::vector<timerNode> timersHeld;
+
+/// Source of timerNode::sequence.
+static uint32_t timerSequence = 0;
+
+/// How often the repeating timers of each engine are due, in thousandths of a run per game tick, used to size its budget.
+static QHash<QScriptEngine *, unsigned> timerLoads;
+
+/// Heap order for timers: whichever is due later, or was scheduled later if due at the same time, goes further back.
+static bool timerLater(const timerNode &a, const timerNode &b)
+{
+	if (a.frameTime != b.frameTime)
+	{
+		return a.frameTime > b.frameTime;
+	}
+	return a.sequence > b.sequence;
+}
+
+static unsigned timerTickLoad(const timerNode &node)
+{
+	if (node.type != TIMER_REPEAT)
+	{
+		return 0;
+	}
+	return 1000 * GAME_TICKS_PER_UPDATE / std::max<unsigned>(node.ms, GAME_TICKS_PER_UPDATE);
+}
+
+static void pushTimer(timerNode node)
+{
+	node.sequence = timerSequence++;
+	timers.push_back(std::move(node));
+	std::push_heap(timers.begin(), timers.end(), timerLater);
+}
+
+static void addTimer(timerNode node)
+{
+	timerLoads[node.engine] += timerTickLoad(node);
+	pushTimer(std::move(node));
+}
+
+/// Removes up to maxCount timers for which match returns true, whether waiting or running this tick.
+/// Returns the number of timers removed.
+template <typename Match>
+static int removeTimers(const Match &match, int maxCount = INT_MAX)
+{
+	int removed = 0;
+	for (std::vector<timerNode> *list : {&timersFired, &timersHeld, &timers})
+	{
+		for (auto i = list->begin(); i != list->end() && removed < maxCount;)
+		{
+			if (match(*i))
+			{
+				timerLoads[i->engine] -= timerTickLoad(*i);
+				i = list->erase(i);
+				++removed;
+			}
+			else
+			{
+				++i;
+			}
+		}
+	}
+	if (removed > 0)
+	{
+		std::make_heap(timers.begin(), timers.end(), timerLater);
+	}
+	return removed;
+}
+
+/// Timers in the order they will run, for saving and display.
+static std::vector<timerNode> sortedTimers()
+{
+	std::vector<timerNode> sorted = timers;
+	std::sort(sorted.begin(), sorted.end(), [](const timerNode &a, const timerNode &b) { return timerLater(b, a); });
+	return sorted;
+}
 
 /// Scripting engine (what others call the scripting context, but QtScript's nomenclature is different).
 static QList<QScriptEngine *> scripts;
@@ -163,8 +260,141 @@ typedef struct monitor_bin
 	uint64_t time;
 	monitor_bin() : worst(0),  worstGameTime(0), calls(0), overMaxTimeCalls(0), overHalfMaxTimeCalls(0), time(0) {}
 } MONITOR_BIN;
-typedef QHash<QString, MONITOR_BIN> MONITOR;
-static QHash<QScriptEngine *, MONITOR *> monitors;
+
+/// A global function of one engine, called by name. The name is interned once, so calls skip converting it. The function itself
+/// is still fetched through the interned name on every call, since a script may assign another function to the global at any time.
+struct ScriptHandler
+{
+	QScriptString name;
+	QByteArray utf8Name;                    ///< For log messages, so they don't convert the name on every call.
+	MONITOR_BIN monitor;                    ///< Calls and time taken, for the performance log.
+	int resolvedNamespaces = 0;             ///< How many of the engine's event namespaces are in variants.
+	std::vector<ScriptHandler *> variants;  ///< This name in each event namespace, called first when called as an event.
+};
+
+/// Events the game calls by a fixed name. Each engine resolves their handlers once, so calling them skips finding the name.
+enum SCRIPT_EVENT
+{
+	EVENT_SELECTION_CHANGED,
+	EVENT_GAME_INIT,
+	EVENT_START_LEVEL,
+	EVENT_LAUNCH_TRANSPORTER,
+	EVENT_TRANSPORTER_LAUNCH,
+	EVENT_REINFORCEMENTS_ARRIVED,
+	EVENT_TRANSPORTER_ARRIVED,
+	EVENT_DELIVERY_POINT_MOVING,
+	EVENT_DELIVERY_POINT_MOVED,
+	EVENT_OBJECT_RECYCLED,
+	EVENT_TRANSPORTER_EXIT,
+	EVENT_TRANSPORTER_DONE,
+	EVENT_TRANSPORTER_LANDED,
+	EVENT_MISSION_TIMEOUT,
+	EVENT_VIDEO_DONE,
+	EVENT_GAME_LOADED,
+	EVENT_GAME_SAVING,
+	EVENT_GAME_SAVED,
+	EVENT_DESIGN_BODY,
+	EVENT_DESIGN_PROPULSION,
+	EVENT_DESIGN_WEAPON,
+	EVENT_DESIGN_COMMAND,
+	EVENT_DESIGN_SYSTEM,
+	EVENT_DESIGN_QUIT,
+	EVENT_MENU_BUILD_SELECTED,
+	EVENT_MENU_RESEARCH_SELECTED,
+	EVENT_MENU_BUILD,
+	EVENT_MENU_RESEARCH,
+	EVENT_MENU_DESIGN,
+	EVENT_MENU_MANUFACTURE,
+	EVENT_PLAYER_LEFT,
+	EVENT_CHEAT_MODE,
+	EVENT_DROID_IDLE,
+	EVENT_DROID_BUILT,
+	EVENT_STRUCTURE_BUILT,
+	EVENT_STRUCTURE_READY,
+	EVENT_ATTACKED,
+	EVENT_RESEARCHED,
+	EVENT_DESTROYED,
+	EVENT_PICKUP,
+	EVENT_OBJECT_SEEN,
+	EVENT_GROUP_SEEN,
+	EVENT_OBJECT_TRANSFER,
+	EVENT_CHAT,
+	EVENT_BEACON,
+	EVENT_BEACON_REMOVED,
+	EVENT_GROUP_LOSS,
+	EVENT_DESIGN_CREATED,
+	EVENT_ALLIANCE_OFFER,
+	EVENT_ALLIANCE_ACCEPTED,
+	EVENT_ALLIANCE_BROKEN,
+	EVENT_SYNC_REQUEST,
+	EVENT_KEY_PRESSED,
+	EVENT_COUNT
+};
+
+static const char *const eventNames[EVENT_COUNT] =
+{
+	"eventSelectionChanged",
+	"eventGameInit",
+	"eventStartLevel",
+	"eventLaunchTransporter",
+	"eventTransporterLaunch",
+	"eventReinforcementsArrived",
+	"eventTransporterArrived",
+	"eventDeliveryPointMoving",
+	"eventDeliveryPointMoved",
+	"eventObjectRecycled",
+	"eventTransporterExit",
+	"eventTransporterDone",
+	"eventTransporterLanded",
+	"eventMissionTimeout",
+	"eventVideoDone",
+	"eventGameLoaded",
+	"eventGameSaving",
+	"eventGameSaved",
+	"eventDesignBody",
+	"eventDesignPropulsion",
+	"eventDesignWeapon",
+	"eventDesignCommand",
+	"eventDesignSystem",
+	"eventDesignQuit",
+	"eventMenuBuildSelected",
+	"eventMenuResearchSelected",
+	"eventMenuBuild",
+	"eventMenuResearch",
+	"eventMenuDesign",
+	"eventMenuManufacture",
+	"eventPlayerLeft",
+	"eventCheatMode",
+	"eventDroidIdle",
+	"eventDroidBuilt",
+	"eventStructureBuilt",
+	"eventStructureReady",
+	"eventAttacked",
+	"eventResearched",
+	"eventDestroyed",
+	"eventPickup",
+	"eventObjectSeen",
+	"eventGroupSeen",
+	"eventObjectTransfer",
+	"eventChat",
+	"eventBeacon",
+	"eventBeaconRemoved",
+	"eventGroupLoss",
+	"eventDesignCreated",
+	"eventAllianceOffer",
+	"eventAllianceAccepted",
+	"eventAllianceBroken",
+	"eventSyncRequest",
+	"eventKeyPressed",
+};
+
+/// The handlers of one engine: by name, and resolved up front for each event.
+struct HANDLERS
+{
+	QHash<QString, ScriptHandler *> byName;
+	ScriptHandler *events[EVENT_COUNT];
+};
+static QHash<QScriptEngine *, HANDLERS *> handlers;
 static QHash<QScriptEngine *, QStringList> eventNamespaces; // separate event namespaces for libraries
 
 static MODELMAP models;
@@ -180,43 +410,60 @@ void doNotSaveGlobal(const QString &global)
 	internalNamespace.insert(global);
 }
 
-// Call a function by name
-static QScriptValue callFunction(QScriptEngine *engine, const QString &function, const QScriptValueList &args, bool event = true)
+/// Finds the handler of a function, interning its name the first time it is called in this engine.
+static ScriptHandler *findHandler(QScriptEngine *engine, const QString &function)
+{
+	ScriptHandler *&handler = handlers.value(engine)->byName[function];
+	if (handler == nullptr)
+	{
+		handler = new ScriptHandler;
+		handler->name = engine->toStringHandle(function);
+		handler->utf8Name = function.toUtf8();
+	}
+	return handler;
+}
+
+// Call a function by its handler
+static QScriptValue callHandler(QScriptEngine *engine, ScriptHandler *handler, const QScriptValueList &args, bool event)
 {
 	if (event)
 	{
+		// Namespaces are only ever appended, so only new ones need resolving.
+		const QStringList &namespaces = eventNamespaces[engine];
+		while (handler->resolvedNamespaces < namespaces.size())
+		{
+			ScriptHandler *variant = findHandler(engine, namespaces[handler->resolvedNamespaces] + handler->name.toString());
+			handler->variants.push_back(variant);
+			++handler->resolvedNamespaces;
+		}
 		// recurse into variants, if any
-		for (const QString &s : eventNamespaces[engine])
+		for (size_t i = 0; i < handler->variants.size(); ++i)
 		{
-			const QScriptValue &value = engine->globalObject().property(s + function);
+			ScriptHandler *variant = handler->variants[i];
+			const QScriptValue &value = engine->globalObject().property(variant->name);
 			if (value.isValid() && value.isFunction())
 			{
-				callFunction(engine, s + function, args, event);
+				callHandler(engine, variant, args, event);
 			}
 		}
 	}
 	code_part level = event ? LOG_SCRIPT : LOG_ERROR;
-	QScriptValue value = engine->globalObject().property(function);
+	QScriptValue value = engine->globalObject().property(handler->name);
 	if (!value.isValid() || !value.isFunction())
 	{
 		// not necessarily an error, may just be a trigger that is not defined (ie not needed)
 		// or it could be a typo in the function name or ...
-		debug(level, "called function (%s) not defined", function.toUtf8().constData());
+		debug(level, "called function (%s) not defined", handler->utf8Name.constData());
 		return false;
 	}
 	QElapsedTimer timer;
 	timer.start();
 	QScriptValue result = value.call(QScriptValue(), args);
 	int ticks = timer.nsecsElapsed() / 1000;
-	MONITOR *monitor = monitors.value(engine); // pick right one for this engine
-	MONITOR_BIN m;
-	if (monitor->contains(function))
-	{
-		m = monitor->value(function);
-	}
+	MONITOR_BIN &m = handler->monitor;
 	if (ticks > MAX_US)
 	{
-		debug(LOG_SCRIPT, "%s took %dus at time %d", function.toUtf8().constData(), ticks, wzGetTicks());
+		debug(LOG_SCRIPT, "%s took %dus at time %d", handler->utf8Name.constData(), ticks, wzGetTicks());
 		m.overMaxTimeCalls++;
 	}
 	else if (ticks > HALF_MAX_US)
@@ -230,7 +477,6 @@ static QScriptValue callFunction(QScriptEngine *engine, const QString &function,
 		m.worstGameTime = gameTime;
 	}
 	m.time += ticks;
-	monitor->insert(function, m);
 	if (engine->hasUncaughtException())
 	{
 		int line = engine->uncaughtExceptionLineNumber();
@@ -240,13 +486,25 @@ static QScriptValue callFunction(QScriptEngine *engine, const QString &function,
 			debug(LOG_ERROR, "%d : %s", i, bt.at(i).toUtf8().constData());
 		}
 		ASSERT(false, "Uncaught exception calling function \"%s\" at line %d: %s",
-		       function.toUtf8().constData(), line, result.toString().toUtf8().constData());
+		       handler->utf8Name.constData(), line, result.toString().toUtf8().constData());
 		engine->clearExceptions();
 		return QScriptValue();
 	}
 	return result;
 }
 
+// Call a function by name
+static QScriptValue callFunction(QScriptEngine *engine, const QString &function, const QScriptValueList &args, bool event = true)
+{
+	return callHandler(engine, findHandler(engine, function), args, event);
+}
+
+// Call an event by the handler resolved when loading the script
+static QScriptValue callEvent(QScriptEngine *engine, SCRIPT_EVENT event, const QScriptValueList &args)
+{
+	return callHandler(engine, handlers.value(engine)->events[event], args, true);
+}
+
 //-- ## setTimer(function, milliseconds[, object])
 //--
 //-- Set a function to run repeated at some given time interval. The function to run
@@ -289,7 +547,7 @@ static QScriptValue js_setTimer(QScriptContext *context, QScriptEngine *engine)
 		}
 	}
 	node.type = TIMER_REPEAT;
-	timers.push_back(node);
+	addTimer(node);
 	return QScriptValue();
 }
 
@@ -303,17 +561,8 @@ static QScriptValue js_removeTimer(QScriptContext *context, QScriptEngine *engin
 	SCRIPT_ASSERT(context, context->argument(0).isString(), "Timer functions must be quoted");
 	QString function = context->argument(0).toString();
 	int player = engine->globalObject().property("me").toInt32();
-	int i, size = timers.size();
-	for (i = 0; i < size; ++i)
-	{
-		timerNode node = timers.at(i);
-		if (node.function == function && node.player == player)
-		{
-			timers.removeAt(i);
-			break;
-		}
-	}
-	if (i == size)
+	int removed = removeTimers([&](const timerNode &node) { return node.function == function && node.player == player; }, 1);
+	if (removed == 0)
 	{
 		// Friendly warning
 		QString warnName = function.left(15) + "...";
@@ -363,7 +612,7 @@ static QScriptValue js_queue(QScriptContext *context, QScriptEngine *engine)
 		}
 	}
 	node.type = TIMER_ONESHOT_READY;
-	timers.push_back(node);
+	addTimer(node);
 	return QScriptValue();
 }
 
@@ -388,18 +637,7 @@ static QScriptValue js_profile(QScriptContext *context, QScriptEngine *engine)
 void scriptRemoveObject(BASE_OBJECT *psObj)
 {
 	// Weed out timers with dead objects
-	for (int i = 0; i < timers.count();)
-	{
-		const timerNode node = timers.at(i);
-		if (node.baseobj == psObj->id)
-		{
-			timers.removeAt(i);
-		}
-		else
-		{
-			i++;
-		}
-	}
+	removeTimers([psObj](const timerNode &node) { return node.baseobj == psObj->id; });
 	groupRemoveObject(psObj);
 }
 
@@ -497,28 +735,36 @@ bool shutdownScripts()
 	triggerModel = nullptr;
 	for (auto *engine : scripts)
 	{
-		MONITOR *monitor = monitors.value(engine);
+		HANDLERS *table = handlers.value(engine);
 		QString scriptName = engine->globalObject().property("scriptName").toString();
 		int me = engine->globalObject().property("me").toInt32();
 		dumpScriptLog(scriptName, me, "=== PERFORMANCE DATA ===\n");
 		dumpScriptLog(scriptName, me, "    calls | avg (usec) | worst (usec) | worst call at | >=limit | >=limit/2 | function\n");
-		for (MONITOR::const_iterator iter = monitor->constBegin(); iter != monitor->constEnd(); ++iter)
+		for (auto iter = table->byName.constBegin(); iter != table->byName.constEnd(); ++iter)
 		{
 			const QString& function = iter.key();
-			MONITOR_BIN m = iter.value();
+			MONITOR_BIN m = iter.value()->monitor;
+			if (m.calls == 0)
+			{
+				continue;  // Never called, or not defined.
+			}
 			QString info = QString("%1 | %2 | %3 | %4 | %5 | %6 | %7\n")
 			               .arg(m.calls, 9).arg(m.time / m.calls, 10).arg(m.worst, 12)
 			               .arg(m.worstGameTime, 13).arg(m.overMaxTimeCalls, 7)
 			               .arg(m.overHalfMaxTimeCalls, 9).arg(function);
 			dumpScriptLog(scriptName, me, info);
 		}
-		monitor->clear();
-		delete monitor;
+		qDeleteAll(table->byName);
+		delete table;
 		unregisterFunctions(engine);
 	}
 	timers.clear();
+	timersFired.clear();
+	timersHeld.clear();
+	timerSequence = 0;
+	timerLoads.clear();
 	internalNamespace.clear();
-	monitors.clear();
+	handlers.clear();
 	while (!scripts.isEmpty())
 	{
 		delete scripts.takeFirst();
@@ -535,7 +781,7 @@ bool updateScripts()
 		{
 			QScriptValueList args;
 			args += js_enumSelected(nullptr, engine);
-			callFunction(engine, "eventSelectionChanged", args);
+			callEvent(engine, EVENT_SELECTION_CHANGED, args);
 		}
 		selectionChanged = false;
 	}
@@ -545,49 +791,57 @@ bool updateScripts()
 	{
 		engine->globalObject().setProperty("gameTime", gameTime, QScriptValue::ReadOnly | QScriptValue::Undeletable);
 	}
-	// Weed out dead timers
-	for (int i = 0; i < timers.count();)
-	{
-		const timerNode node = timers.at(i);
-		if (node.type == TIMER_ONESHOT_DONE)
+	// Run the timers that are due, in the order they fell due, up to the budget of their engine. Repeating timers are
+	// rescheduled from when they actually ran, so timers held back to a later tick stay spread out afterwards.
+	const uint32_t firstNewTimer = timerSequence;  // timers (re)scheduled from here on wait for the next tick
+	QHash<QScriptEngine *, unsigned> ran;
+	while (!timers.empty() && timers.front().frameTime <= gameTime && timers.front().sequence < firstNewTimer)
+	{
+		std::pop_heap(timers.begin(), timers.end(), timerLater);
+		timerNode node = std::move(timers.back());
+		timers.pop_back();
+		unsigned &engineRan = ran[node.engine];
+		const unsigned budget = SCRIPT_TIMER_BUDGET_MIN + timerLoads.value(node.engine) * 3 / 2000;
+		if (engineRan >= budget && gameTime - node.frameTime < SCRIPT_TIMER_MAX_DELAY)
 		{
-			timers.removeAt(i);
+			timersHeld.push_back(std::move(node));
+			continue;
 		}
-		else
+		++engineRan;
+		node.frameTime = std::max(node.ms, 0) + gameTime;	// update for next invokation
+		node.calls++;
+		if (node.handler == nullptr)
 		{
-			i++;
+			node.handler = findHandler(node.engine, node.function);
 		}
-	}
-	// Check for timers, and run them if applicable.
-	// TODO - load balancing
-	QList<timerNode> runlist; // make a new list here, since we might trample all over the timer list during execution
-	QList<timerNode>::iterator iter;
-	for (iter = timers.begin(); iter != timers.end(); iter++)
-	{
-		if (iter->frameTime <= gameTime)
+		timersFired.push_back(node);
+
+		QScriptValueList args;
+		if (node.baseobj > 0)
 		{
-			iter->frameTime = iter->ms + gameTime;	// update for next invokation
-			if (iter->type == TIMER_ONESHOT_READY)
-			{
-				iter->type = TIMER_ONESHOT_DONE; // unless there is none
-			}
-			iter->calls++;
-			runlist.append(*iter);
+			args += convMax(IdToObject(node.baseobjtype, node.baseobj, node.player), node.engine);
 		}
-	}
-	for (iter = runlist.begin(); iter != runlist.end(); iter++)
-	{
-		QScriptValueList args;
-		if (iter->baseobj > 0)
+		else if (!node.stringarg.isEmpty())
 		{
-			args += convMax(IdToObject(iter->baseobjtype, iter->baseobj, iter->player), iter->engine);
+			args += node.stringarg;
 		}
-		else if (!iter->stringarg.isEmpty())
+		callHandler(node.engine, node.handler, args, true);
+	}
+	for (auto &node : timersFired)
+	{
+		if (node.type == TIMER_REPEAT)
 		{
-			args += iter->stringarg;
+			pushTimer(std::move(node));
 		}
-		callFunction(iter->engine, iter->function, args, true);
 	}
+	timersFired.clear();
+	for (auto &node : timersHeld)
+	{
+		// Not rescheduled, so they keep their place among the timers due at the same time.
+		timers.push_back(std::move(node));
+		std::push_heap(timers.begin(), timers.end(), timerLater);
+	}
+	timersHeld.clear();
 
 	if (globalDialog && doUpdateModels)
 	{
@@ -715,8 +969,11 @@ QScriptEngine *loadPlayerScript(const QString& path, int player, int difficulty)
 	// Register script
 	scripts.push_back(engine);
 
-	MONITOR *monitor = new MONITOR;
-	monitors.insert(engine, monitor);
+	handlers.insert(engine, new HANDLERS);
+	for (int event = 0; event < EVENT_COUNT; ++event)
+	{
+		handlers.value(engine)->events[event] = findHandler(engine, eventNames[event]);
+	}
 
 	debug(LOG_SAVE, "Created script engine %d for player %d from %s", scripts.size() - 1, player, path.toUtf8().constData());
 	return engine;
@@ -753,9 +1010,10 @@ bool saveScriptStates(const char *filename)
 		saveGroups(ini, engine);
 		ini.endGroup();
 	}
-	for (int i = 0; i < timers.size(); ++i)
+	std::vector<timerNode> sorted = sortedTimers();
+	for (size_t i = 0; i < sorted.size(); ++i)
 	{
-		timerNode node = timers.at(i);
+		const timerNode &node = sorted[i];
 		ini.beginGroup(QString("triggers_") + QString::number(i));
 		// we have to save 'scriptName' and 'me' explicitly
 		ini.setValue("me", node.player);
@@ -812,7 +1070,10 @@ bool loadScriptStates(const char *filename)
 			node.function = ini.value("function").toString();
 			node.baseobj = ini.value("baseobj", -1).toInt();
 			node.type = (timerType)ini.value("type", TIMER_REPEAT).toInt();
-			timers.push_back(node);
+			if (node.type != TIMER_ONESHOT_DONE)
+			{
+				addTimer(node);
+			}
 		}
 		else if (engine && list[i].startsWith("globals_"))
 		{
@@ -891,7 +1152,7 @@ static void updateGlobalModels()
 	}
 	QStandardItemModel *m = triggerModel;
 	m->setRowCount(0);
-	for (const auto &node : timers)
+	for (const auto &node : sortedTimers())
 	{
 		int nextRow = m->rowCount();
 		m->setRowCount(nextRow);
@@ -912,10 +1173,6 @@ static void updateGlobalModels()
 		{
 			m->setItem(nextRow, 5, new QStandardItem("Oneshot"));
 		}
-		else if (node.type == TIMER_ONESHOT_DONE)
-		{
-			m->setItem(nextRow, 5, new QStandardItem("Done"));
-		}
 		else
 		{
 			m->setItem(nextRow, 5, new QStandardItem("Repeat"));
@@ -944,6 +1201,127 @@ bool jsEvaluate(QScriptEngine *engine, const QString &text)
 	return true;
 }
 
+/// Evaluates code in a script for a benchmark, adding the time it took to microseconds. Returns an invalid value on errors.
+static QScriptValue benchmarkEvaluate(QScriptEngine *engine, const QString &code, uint64_t &microseconds)
+{
+	QElapsedTimer timer;
+	timer.start();
+	QScriptValue result = engine->evaluate(code);
+	microseconds += timer.nsecsElapsed() / 1000;
+	if (engine->hasUncaughtException())
+	{
+		debug(LOG_ERROR, "Uncaught exception in benchmark: %s", result.toString().toUtf8().constData());
+		engine->clearExceptions();
+		return QScriptValue();
+	}
+	return result;
+}
+
+SCRIPT_LAZY_BENCHMARK scriptLazyObjectsBenchmark(unsigned rounds)
+{
+	SCRIPT_LAZY_BENCHMARK result;
+	result.droids = 0;
+	result.rounds = rounds;
+	result.eagerMicroseconds = 0;
+	result.lazyMicroseconds = 0;
+	result.mismatches = 0;
+	if (scripts.isEmpty())
+	{
+		return result;
+	}
+
+	// Like an AI going through its droids, reading only a few properties of each.
+	static const QString code =
+	    "(function() {"
+	    "	var droids = 0, sum = 0;"
+	    "	for (var player = 0; player < maxPlayers; ++player) {"
+	    "		enumDroid(player).forEach(function(droid) {"
+	    "			++droids;"
+	    "			sum += droid.x * 256 + droid.y + droid.health + droid.droidType * 65536;"
+	    "		});"
+	    "	}"
+	    "	return [droids, sum];"
+	    "})()";
+	QScriptEngine *engine = scripts.first();
+	const bool wasLazy = setLazyObjects(engine, false);
+	for (unsigned round = 0; round < rounds; ++round)
+	{
+		setLazyObjects(engine, false);
+		QScriptValue eager = benchmarkEvaluate(engine, code, result.eagerMicroseconds);
+		setLazyObjects(engine, true);  // Also forgets what the last round read, so that each round computes the properties again.
+		QScriptValue lazy = benchmarkEvaluate(engine, code, result.lazyMicroseconds);
+		result.droids = eager.property(0).toUInt32();
+		result.mismatches += !eager.isValid() || !lazy.isValid() || eager.property(0).toUInt32() != lazy.property(0).toUInt32()
+		                     || eager.property(1).toNumber() != lazy.property(1).toNumber();
+	}
+	setLazyObjects(engine, wasLazy);
+	return result;
+}
+
+SCRIPT_RANGE_BENCHMARK scriptRangeBenchmark(unsigned rounds)
+{
+	SCRIPT_RANGE_BENCHMARK result;
+	result.searches = 0;
+	result.rounds = rounds;
+	result.objects = 0;
+	result.droids = 0;
+	result.enumMicroseconds = 0;
+	result.countMicroseconds = 0;
+	result.filterMicroseconds = 0;
+	result.typedMicroseconds = 0;
+	result.typedCountMicroseconds = 0;
+	result.mismatches = 0;
+	if (scripts.isEmpty())
+	{
+		return result;
+	}
+
+	// Counts around every 8th tile each way, like an AI checking for danger around its bases and units.
+	QScriptEngine *engine = scripts.first();
+	auto search = [engine, rounds](const char *count, uint64_t &microseconds) {
+		const QString code = QString(
+		    "(function() {"
+		    "	var counts = [];"
+		    "	for (var y = 4; y < mapHeight; y += 8) {"
+		    "		for (var x = 4; x < mapWidth; x += 8) {"
+		    "			counts.push(%1);"
+		    "		}"
+		    "	}"
+		    "	return counts;"
+		    "})()").arg(count);
+		std::vector<unsigned> counts;
+		for (unsigned round = 0; round < rounds; ++round)
+		{
+			QScriptValue value = benchmarkEvaluate(engine, code, microseconds);
+			counts.resize(value.property("length").toUInt32());
+			for (unsigned i = 0; i < counts.size(); ++i)
+			{
+				counts[i] = value.property(i).toUInt32();
+			}
+		}
+		return counts;
+	};
+	std::vector<unsigned> enumCounts = search("enumRange(x, y, 8, ALL_PLAYERS, false).length", result.enumMicroseconds);
+	std::vector<unsigned> countCounts = search("countRange(x, y, 8, ALL_PLAYERS, false)", result.countMicroseconds);
+	std::vector<unsigned> filterCounts = search("enumRange(x, y, 8, ALL_PLAYERS, false).filter(function(obj) { return obj.type === DROID; }).length", result.filterMicroseconds);
+	std::vector<unsigned> typedCounts = search("enumRange(x, y, 8, ALL_PLAYERS, false, DROID).length", result.typedMicroseconds);
+	std::vector<unsigned> typedCountCounts = search("countRange(x, y, 8, ALL_PLAYERS, false, DROID)", result.typedCountMicroseconds);
+
+	result.searches = enumCounts.size();
+	if (countCounts.size() != result.searches || filterCounts.size() != result.searches || typedCounts.size() != result.searches || typedCountCounts.size() != result.searches)
+	{
+		result.mismatches = result.searches;  // Some search threw, so nothing can be compared.
+		return result;
+	}
+	for (unsigned i = 0; i < result.searches; ++i)
+	{
+		result.objects += enumCounts[i];
+		result.droids += filterCounts[i];
+		result.mismatches += countCounts[i] != enumCounts[i] || typedCounts[i] != filterCounts[i] || typedCountCounts[i] != filterCounts[i];
+	}
+	return result;
+}
+
 void jsAutogameSpecific(const QString &name, int player)
 {
 	QScriptEngine *engine = loadPlayerScript(name, player, DIFFICULTY_MEDIUM);
@@ -953,8 +1331,8 @@ void jsAutogameSpecific(const QString &name, int player)
 		return;
 	}
 	console("Loaded the %s AI script for current player!", name.toUtf8().constData());
-	callFunction(engine, "eventGameInit", QScriptValueList());
-	callFunction(engine, "eventStartLevel", QScriptValueList());
+	callEvent(engine, EVENT_GAME_INIT, QScriptValueList());
+	callEvent(engine, EVENT_START_LEVEL, QScriptValueList());
 }
 
 void jsAutogame()
@@ -1119,92 +1497,92 @@ bool triggerEvent(SCRIPT_TRIGGER_TYPE trigger, BASE_OBJECT *psObj)
 		switch (trigger)
 		{
 		case TRIGGER_GAME_INIT:
-			callFunction(engine, "eventGameInit", QScriptValueList());
+			callEvent(engine, EVENT_GAME_INIT, QScriptValueList());
 			break;
 		case TRIGGER_START_LEVEL:
 			processVisibility(); // make sure we initialize visibility first
-			callFunction(engine, "eventStartLevel", QScriptValueList());
+			callEvent(engine, EVENT_START_LEVEL, QScriptValueList());
 			break;
 		case TRIGGER_TRANSPORTER_LAUNCH:
-			callFunction(engine, "eventLaunchTransporter", QScriptValueList()); // deprecated!
-			callFunction(engine, "eventTransporterLaunch", args);
+			callEvent(engine, EVENT_LAUNCH_TRANSPORTER, QScriptValueList()); // deprecated!
+			callEvent(engine, EVENT_TRANSPORTER_LAUNCH, args);
 			break;
 		case TRIGGER_TRANSPORTER_ARRIVED:
-			callFunction(engine, "eventReinforcementsArrived", QScriptValueList()); // deprecated!
-			callFunction(engine, "eventTransporterArrived", args);
+			callEvent(engine, EVENT_REINFORCEMENTS_ARRIVED, QScriptValueList()); // deprecated!
+			callEvent(engine, EVENT_TRANSPORTER_ARRIVED, args);
 			break;
 		case TRIGGER_DELIVERY_POINT_MOVING:
-			callFunction(engine, "eventDeliveryPointMoving", args);
+			callEvent(engine, EVENT_DELIVERY_POINT_MOVING, args);
 			break;
 		case TRIGGER_DELIVERY_POINT_MOVED:
-			callFunction(engine, "eventDeliveryPointMoved", args);
+			callEvent(engine, EVENT_DELIVERY_POINT_MOVED, args);
 			break;
 		case TRIGGER_OBJECT_RECYCLED:
-			callFunction(engine, "eventObjectRecycled", args);
+			callEvent(engine, EVENT_OBJECT_RECYCLED, args);
 			break;
 		case TRIGGER_TRANSPORTER_EXIT:
-			callFunction(engine, "eventTransporterExit", args);
+			callEvent(engine, EVENT_TRANSPORTER_EXIT, args);
 			break;
 		case TRIGGER_TRANSPORTER_DONE:
-			callFunction(engine, "eventTransporterDone", args);
+			callEvent(engine, EVENT_TRANSPORTER_DONE, args);
 			break;
 		case TRIGGER_TRANSPORTER_LANDED:
-			callFunction(engine, "eventTransporterLanded", args);
+			callEvent(engine, EVENT_TRANSPORTER_LANDED, args);
 			break;
 		case TRIGGER_MISSION_TIMEOUT:
-			callFunction(engine, "eventMissionTimeout", QScriptValueList());
+			callEvent(engine, EVENT_MISSION_TIMEOUT, QScriptValueList());
 			break;
 		case TRIGGER_VIDEO_QUIT:
-			callFunction(engine, "eventVideoDone", QScriptValueList());
+			callEvent(engine, EVENT_VIDEO_DONE, QScriptValueList());
 			break;
 		case TRIGGER_GAME_LOADED:
-			callFunction(engine, "eventGameLoaded", QScriptValueList());
+			callEvent(engine, EVENT_GAME_LOADED, QScriptValueList());
 			break;
 		case TRIGGER_GAME_SAVING:
-			callFunction(engine, "eventGameSaving", QScriptValueList());
+			callEvent(engine, EVENT_GAME_SAVING, QScriptValueList());
 			break;
 		case TRIGGER_GAME_SAVED:
-			callFunction(engine, "eventGameSaved", QScriptValueList());
+			callEvent(engine, EVENT_GAME_SAVED, QScriptValueList());
 			break;
 		case TRIGGER_DESIGN_BODY:
-			callFunction(engine, "eventDesignBody", QScriptValueList());
+			callEvent(engine, EVENT_DESIGN_BODY, QScriptValueList());
 			break;
 		case TRIGGER_DESIGN_PROPULSION:
-			callFunction(engine, "eventDesignPropulsion", QScriptValueList());
+			callEvent(engine, EVENT_DESIGN_PROPULSION, QScriptValueList());
 			break;
 		case TRIGGER_DESIGN_WEAPON:
-			callFunction(engine, "eventDesignWeapon", QScriptValueList());
+			callEvent(engine, EVENT_DESIGN_WEAPON, QScriptValueList());
 			break;
 		case TRIGGER_DESIGN_COMMAND:
-			callFunction(engine, "eventDesignCommand", QScriptValueList());
+			callEvent(engine, EVENT_DESIGN_COMMAND, QScriptValueList());
 			break;
 		case TRIGGER_DESIGN_SYSTEM:
-			callFunction(engine, "eventDesignSystem", QScriptValueList());
+			callEvent(engine, EVENT_DESIGN_SYSTEM, QScriptValueList());
 			break;
 		case TRIGGER_DESIGN_QUIT:
-			callFunction(engine, "eventDesignQuit", QScriptValueList());
+			callEvent(engine, EVENT_DESIGN_QUIT, QScriptValueList());
 			break;
 		case TRIGGER_MENU_BUILD_SELECTED:
-			callFunction(engine, "eventMenuBuildSelected", args);
+			callEvent(engine, EVENT_MENU_BUILD_SELECTED, args);
 			break;
 		case TRIGGER_MENU_RESEARCH_SELECTED:
-			callFunction(engine, "eventMenuResearchSelected", args);
+			callEvent(engine, EVENT_MENU_RESEARCH_SELECTED, args);
 			break;
 		case TRIGGER_MENU_BUILD_UP:
 			args += QScriptValue(true);
-			callFunction(engine, "eventMenuBuild", args);
+			callEvent(engine, EVENT_MENU_BUILD, args);
 			break;
 		case TRIGGER_MENU_RESEARCH_UP:
 			args += QScriptValue(true);
-			callFunction(engine, "eventMenuResearch", args);
+			callEvent(engine, EVENT_MENU_RESEARCH, args);
 			break;
 		case TRIGGER_MENU_DESIGN_UP:
 			args += QScriptValue(true);
-			callFunction(engine, "eventMenuDesign", args);
+			callEvent(engine, EVENT_MENU_DESIGN, args);
 			break;
 		case TRIGGER_MENU_MANUFACTURE_UP:
 			args += QScriptValue(true);
-			callFunction(engine, "eventMenuManufacture", args);
+			callEvent(engine, EVENT_MENU_MANUFACTURE, args);
 			break;
 		}
 	}
@@ -1229,7 +1607,7 @@ bool triggerEventPlayerLeft(int id)
 	{
 		QScriptValueList args;
 		args += id;
-		callFunction(engine, "eventPlayerLeft", args);
+		callEvent(engine, EVENT_PLAYER_LEFT, args);
 	}
 	return true;
 }
@@ -1246,7 +1624,7 @@ bool triggerEventCheatMode(bool entered)
 	{
 		QScriptValueList args;
 		args += entered;
-		callFunction(engine, "eventCheatMode", args);
+		callEvent(engine, EVENT_CHEAT_MODE, args);
 	}
 	return true;
 }
@@ -1265,7 +1643,7 @@ bool triggerEventDroidIdle(DROID *psDroid)
 		{
 			QScriptValueList args;
 			args += convDroid(psDroid, engine);
-			callFunction(engine, "eventDroidIdle", args);
+			callEvent(engine, EVENT_DROID_IDLE, args);
 		}
 	}
 	return true;
@@ -1292,7 +1670,7 @@ bool triggerEventDroidBuilt(DROID *psDroid, STRUCTURE *psFactory)
 			{
 				args += convStructure(psFactory, engine);
 			}
-			callFunction(engine, "eventDroidBuilt", args);
+			callEvent(engine, EVENT_DROID_BUILT, args);
 		}
 	}
 	return true;
@@ -1319,7 +1697,7 @@ bool triggerEventStructBuilt(STRUCTURE *psStruct, DROID *psDroid)
 			{
 				args += convDroid(psDroid, engine);
 			}
-			callFunction(engine, "eventStructureBuilt", args);
+			callEvent(engine, EVENT_STRUCTURE_BUILT, args);
 		}
 	}
 	return true;
@@ -1342,7 +1720,7 @@ bool triggerEventStructureReady(STRUCTURE *psStruct)
 		{
 			QScriptValueList args;
 			args += convStructure(psStruct, engine);
-			callFunction(engine, "eventStructureReady", args);
+			callEvent(engine, EVENT_STRUCTURE_READY, args);
 		}
 	}
 	return true;
@@ -1376,7 +1754,7 @@ bool triggerEventAttacked(BASE_OBJECT *psVictim, BASE_OBJECT *psAttacker, int la
 			QScriptValueList args;
 			args += convMax(psVictim, engine);
 			args += convMax(psAttacker, engine);
-			callFunction(engine, "eventAttacked", args);
+			callEvent(engine, EVENT_ATTACKED, args);
 		}
 	}
 	return true;
@@ -1415,7 +1793,7 @@ bool triggerEventResearched(RESEARCH *psResearch, STRUCTURE *psStruct, int playe
 				args += QScriptValue::NullValue;
 			}
 			args += QScriptValue(player);
-			callFunction(engine, "eventResearched", args);
+			callEvent(engine, EVENT_RESEARCHED, args);
 		}
 	}
 	return true;
@@ -1434,7 +1812,7 @@ bool triggerEventDestroyed(BASE_OBJECT *psVictim)
 		QScriptEngine *engine = scripts.at(i);
 		QScriptValueList args;
 		args += convMax(psVictim, engine);
-		callFunction(engine, "eventDestroyed", args);
+		callEvent(engine, EVENT_DESTROYED, args);
 	}
 	return true;
 }
@@ -1453,7 +1831,7 @@ bool triggerEventPickup(FEATURE *psFeat, DROID *psDroid)
 		QScriptValueList args;
 		args += convFeature(psFeat, engine);
 		args += convDroid(psDroid, engine);
-		callFunction(engine, "eventPickup", args);
+		callEvent(engine, EVENT_PICKUP, args);
 	}
 	return true;
 }
@@ -1485,14 +1863,14 @@ bool triggerEventSeen(BASE_OBJECT *psViewer, BASE_OBJECT *psSeen)
 			QScriptValueList args;
 			args += convMax(psViewer, engine);
 			args += convMax(psSeen, engine);
-			callFunction(engine, "eventObjectSeen", args);
+			callEvent(engine, EVENT_OBJECT_SEEN, args);
 		}
 		if (callbacks.second)
 		{
 			QScriptValueList args;
 			args += convMax(psViewer, engine);
 			args += QScriptValue(callbacks.second); // group id
-			callFunction(engine, "eventGroupSeen", args);
+			callEvent(engine, EVENT_GROUP_SEEN, args);
 		}
 	}
 	return true;
@@ -1518,7 +1896,7 @@ bool triggerEventObjectTransfer(BASE_OBJECT *psObj, int from)
 			QScriptValueList args;
 			args += convMax(psObj, engine);
 			args += QScriptValue(from);
-			callFunction(engine, "eventObjectTransfer", args);
+			callEvent(engine, EVENT_OBJECT_TRANSFER, args);
 		}
 	}
 	return true;
@@ -1543,7 +1921,7 @@ bool triggerEventChat(int from, int to, const char *message)
 			args += QScriptValue(from);
 			args += QScriptValue(to);
 			args += QScriptValue(QString(message));
-			callFunction(engine, "eventChat", args);
+			callEvent(engine, EVENT_CHAT, args);
 		}
 	}
 	return true;
@@ -1572,7 +1950,7 @@ bool triggerEventBeacon(int from, int to, const char *message, int x, int y)
 			{
 				args += QScriptValue(QString(message));
 			}
-			callFunction(engine, "eventBeacon", args);
+			callEvent(engine, EVENT_BEACON, args);
 		}
 	}
 	return true;
@@ -1595,7 +1973,7 @@ bool triggerEventBeaconRemoved(int from, int to)
 			QScriptValueList args;
 			args += QScriptValue(from);
 			args += QScriptValue(to);
-			callFunction(engine, "eventBeaconRemoved", args);
+			callEvent(engine, EVENT_BEACON_REMOVED, args);
 		}
 	}
 	return true;
@@ -1631,7 +2009,7 @@ bool triggerEventGroupLoss(BASE_OBJECT *psObj, int group, int size, QScriptEngin
 	args += convMax(psObj, engine);
 	args += QScriptValue(group);
 	args += QScriptValue(size);
-	callFunction(engine, "eventGroupLoss", args);
+	callEvent(engine, EVENT_GROUP_LOSS, args);
 	return true;
 }
 
@@ -1674,7 +2052,7 @@ bool triggerEventDesignCreated(DROID_TEMPLATE *psTemplate)
 	{
 		QScriptValueList args;
 		args += convTemplate(psTemplate, engine);
-		callFunction(engine, "eventDesignCreated", args);
+		callEvent(engine, EVENT_DESIGN_CREATED, args);
 	}
 	return true;
 }
@@ -1690,7 +2068,7 @@ bool triggerEventAllianceOffer(uint8_t from, uint8_t to)
 		QScriptValueList args;
 		args += QScriptValue(from);
 		args += QScriptValue(to);
-		callFunction(engine, "eventAllianceOffer", args);
+		callEvent(engine, EVENT_ALLIANCE_OFFER, args);
 	}
 	return true;
 }
@@ -1706,7 +2084,7 @@ bool triggerEventAllianceAccepted(uint8_t from, uint8_t to)
 		QScriptValueList args;
 		args += QScriptValue(from);
 		args += QScriptValue(to);
-		callFunction(engine, "eventAllianceAccepted", args);
+		callEvent(engine, EVENT_ALLIANCE_ACCEPTED, args);
 	}
 	return true;
 }
@@ -1722,7 +2100,7 @@ bool triggerEventAllianceBroken(uint8_t from, uint8_t to)
 		QScriptValueList args;
 		args += QScriptValue(from);
 		args += QScriptValue(to);
-		callFunction(engine, "eventAllianceBroken", args);
+		callEvent(engine, EVENT_ALLIANCE_BROKEN, args);
 	}
 	return true;
 }
@@ -1751,7 +2129,7 @@ bool triggerEventSyncRequest(int from, int req_id, int x, int y, BASE_OBJECT *ps
 		{
 			args += convMax(psObj2, engine);
 		}
-		callFunction(engine, "eventSyncRequest", args);
+		callEvent(engine, EVENT_SYNC_REQUEST, args);
 	}
 	return true;
 }
@@ -1768,7 +2146,7 @@ bool triggerEventKeyPressed(int meta, int key)
 		QScriptValueList args;
 		args += QScriptValue(meta);
 		args += QScriptValue(key);
-		callFunction(engine, "eventKeyPressed", args);
+		callEvent(engine, EVENT_KEY_PRESSED, args);
 	}
 	return true;
 }
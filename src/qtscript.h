@@ -149,4 +149,33 @@ void jsDebugSelected(const BASE_OBJECT *psObj);
 void jsDebugMessageUpdate();
 void jsDebugUpdate();
 
+struct SCRIPT_LAZY_BENCHMARK
+{
+	unsigned droids;                ///< Number of droids enumerated in each round.
+	unsigned rounds;                ///< Number of times the droids were enumerated each way.
+	uint64_t eagerMicroseconds;     ///< Time taken, with every property filled in up front.
+	uint64_t lazyMicroseconds;      ///< Time taken, with setLazyObjects(), computing properties when read.
+	unsigned mismatches;            ///< Number of rounds which read something different each way.
+};
+/// Times enumDroid() for every player in the first loaded script, reading a few properties of each droid, with and
+/// without setLazyObjects(). Then checks that both read the same.
+SCRIPT_LAZY_BENCHMARK scriptLazyObjectsBenchmark(unsigned rounds);
+
+struct SCRIPT_RANGE_BENCHMARK
+{
+	unsigned searches;              ///< Number of positions searched around by each kind of search in each round.
+	unsigned rounds;                ///< Number of times each kind of search was done around all of them.
+	unsigned objects;               ///< Number of objects found by enumRange() around all of them.
+	unsigned droids;                ///< Number of droids among those.
+	uint64_t enumMicroseconds;      ///< Time taken, reading the length of what enumRange() returns.
+	uint64_t countMicroseconds;     ///< Time taken, calling countRange().
+	uint64_t filterMicroseconds;    ///< Time taken, filtering the droids out of what enumRange() returns in script.
+	uint64_t typedMicroseconds;     ///< Time taken, calling enumRange() with the DROID type.
+	uint64_t typedCountMicroseconds;  ///< Time taken, calling countRange() with the DROID type.
+	unsigned mismatches;            ///< Number of searches which counted something different from enumRange() or filtering in script.
+};
+/// Times counting the objects and droids within range of positions all over the map in the first loaded script, using
+/// enumRange() and filtering in script, and using countRange() and the type parameter. Then checks they count the same.
+SCRIPT_RANGE_BENCHMARK scriptRangeBenchmark(unsigned rounds);
+
 #endif
@@ -205,6 +205,8 @@ static void fillMainModel(QStandardItemModel &m)
 	KEYVAL("difficultyLevel", difficulty_type.at(getDifficultyLevel()));
 	KEYVAL("loopPieCount", QString::number(loopPieCount));
 	KEYVAL("loopPolyCount", QString::number(loopPolyCount));
+	KEYVAL("loopDrawCallCount", QString::number(loopDrawCallCount));
+	KEYVAL("loopDrawCallsSaved", QString::number(loopDrawCallsSaved));
 	KEYVAL("allowDesign", B2Q(allowDesign));
 	KEYVAL("includeRedundantDesigns", B2Q(includeRedundantDesigns));
 
@@ -31,6 +31,9 @@
 #include "qtscriptfuncs.h"
 #include "lib/ivis_opengl/tex.h"
 
+#include <QtScript/QScriptClass>
+#include <QtScript/QScriptClassPropertyIterator>
+#include <QtScript/QScriptString>
 #include <QtScript/QScriptValue>
 #include <QtCore/QStringList>
 #include <QtCore/QJsonArray>
@@ -73,6 +76,11 @@
 #include "component.h"
 #include "seqdisp.h"
 #include "ai.h"
+#include "objmem.h"
+
+#include <algorithm>
+#include <bitset>
+#include <vector>
 
 #define FAKE_REF_LASSAT 999
 #define ALL_PLAYERS -1
@@ -458,6 +466,141 @@ static bool groupAddObject(BASE_OBJECT *psObj, int groupId, QScriptEngine *engin
 	return true; // inserted
 }
 
+// ----------------------------------------------------------------------------------------
+// Game object properties
+//
+
+/// Properties of the game objects handed to scripts. The lists below give the ones each type of object defines, in
+/// the order they are set.
+enum OBJECT_PROPERTY
+{
+	OBJPROP_ID, OBJPROP_X, OBJPROP_Y, OBJPROP_Z, OBJPROP_PLAYER, OBJPROP_ARMOUR, OBJPROP_THERMAL, OBJPROP_TYPE,
+	OBJPROP_SELECTED, OBJPROP_NAME, OBJPROP_BORN, OBJPROP_GROUP, OBJPROP_IS_CB, OBJPROP_IS_SENSOR, OBJPROP_CAN_HIT_AIR,
+	OBJPROP_CAN_HIT_GROUND, OBJPROP_HAS_INDIRECT, OBJPROP_IS_RADAR_DETECTOR, OBJPROP_RANGE, OBJPROP_STATUS,
+	OBJPROP_HEALTH, OBJPROP_COST, OBJPROP_STATTYPE, OBJPROP_MODULES, OBJPROP_WEAPONS, OBJPROP_DAMAGEABLE,
+	OBJPROP_ACTION, OBJPROP_ORDER, OBJPROP_BODY_SIZE, OBJPROP_CARGO_CAPACITY, OBJPROP_CARGO_LEFT, OBJPROP_CARGO_COUNT,
+	OBJPROP_IS_VTOL, OBJPROP_DROID_TYPE, OBJPROP_EXPERIENCE, OBJPROP_BODY, OBJPROP_PROPULSION, OBJPROP_ARMED,
+	OBJPROP_CARGO_SIZE, OBJPROP_COUNT
+};
+
+static const char *const objectPropertyNames[OBJPROP_COUNT] =
+{
+	"id", "x", "y", "z", "player", "armour", "thermal", "type",
+	"selected", "name", "born", "group", "isCB", "isSensor", "canHitAir",
+	"canHitGround", "hasIndirect", "isRadarDetector", "range", "status",
+	"health", "cost", "stattype", "modules", "weapons", "damageable",
+	"action", "order", "bodySize", "cargoCapacity", "cargoLeft", "cargoCount",
+	"isVTOL", "droidType", "experience", "body", "propulsion", "armed",
+	"cargoSize"
+};
+
+#define BASE_OBJECT_PROPERTIES OBJPROP_ID, OBJPROP_X, OBJPROP_Y, OBJPROP_Z, OBJPROP_PLAYER, OBJPROP_ARMOUR, \
+	OBJPROP_THERMAL, OBJPROP_TYPE, OBJPROP_SELECTED, OBJPROP_NAME, OBJPROP_BORN, OBJPROP_GROUP
+
+static const std::vector<OBJECT_PROPERTY> baseObjectProperties = { BASE_OBJECT_PROPERTIES };
+static const std::vector<OBJECT_PROPERTY> structureProperties =
+{
+	BASE_OBJECT_PROPERTIES, OBJPROP_IS_CB, OBJPROP_IS_SENSOR, OBJPROP_CAN_HIT_AIR, OBJPROP_CAN_HIT_GROUND,
+	OBJPROP_HAS_INDIRECT, OBJPROP_IS_RADAR_DETECTOR, OBJPROP_RANGE, OBJPROP_STATUS, OBJPROP_HEALTH, OBJPROP_COST,
+	OBJPROP_STATTYPE, OBJPROP_MODULES, OBJPROP_WEAPONS
+};
+static const std::vector<OBJECT_PROPERTY> featureProperties =
+{
+	BASE_OBJECT_PROPERTIES, OBJPROP_HEALTH, OBJPROP_DAMAGEABLE, OBJPROP_STATTYPE
+};
+static const std::vector<OBJECT_PROPERTY> droidProperties =
+{
+	BASE_OBJECT_PROPERTIES, OBJPROP_ACTION, OBJPROP_RANGE, OBJPROP_ORDER, OBJPROP_COST, OBJPROP_HAS_INDIRECT,
+	OBJPROP_BODY_SIZE, OBJPROP_CARGO_CAPACITY, OBJPROP_CARGO_LEFT, OBJPROP_CARGO_COUNT, OBJPROP_IS_RADAR_DETECTOR,
+	OBJPROP_IS_CB, OBJPROP_IS_SENSOR, OBJPROP_CAN_HIT_AIR, OBJPROP_CAN_HIT_GROUND, OBJPROP_IS_VTOL, OBJPROP_DROID_TYPE,
+	OBJPROP_EXPERIENCE, OBJPROP_HEALTH, OBJPROP_BODY, OBJPROP_PROPULSION, OBJPROP_ARMED, OBJPROP_WEAPONS,
+	OBJPROP_CARGO_SIZE
+};
+
+#undef BASE_OBJECT_PROPERTIES
+
+static const std::vector<OBJECT_PROPERTY> &objectPropertyList(OBJECT_TYPE type)
+{
+	switch (type)
+	{
+	case OBJ_DROID: return droidProperties;
+	case OBJ_STRUCTURE: return structureProperties;
+	case OBJ_FEATURE: return featureProperties;
+	default: return baseObjectProperties;
+	}
+}
+
+struct WEAPON_SUMMARY
+{
+	bool canHitAir = false;
+	bool canHitGround = false;
+	bool indirect = false;
+	int range = -1;  ///< Longest range of any weapon, or -1 if there are none.
+};
+
+static WEAPON_SUMMARY weaponSummary(const BASE_OBJECT *psObj)
+{
+	WEAPON_SUMMARY summary;
+	for (unsigned i = 0; i < psObj->numWeaps; i++)
+	{
+		if (psObj->asWeaps[i].nStat)
+		{
+			const WEAPON_STATS *psWeap = &asWeaponStats[psObj->asWeaps[i].nStat];
+			summary.canHitAir = summary.canHitAir || psWeap->surfaceToAir & SHOOT_IN_AIR;
+			summary.canHitGround = summary.canHitGround || psWeap->surfaceToAir & SHOOT_ON_GROUND;
+			summary.indirect = summary.indirect || psWeap->movementModel == MM_INDIRECT || psWeap->movementModel == MM_HOMINGINDIRECT;
+			summary.range = MAX((int)psWeap->upgrade[psObj->player].maxRange, summary.range);
+		}
+	}
+	return summary;
+}
+
+/// Whether computing a property needs the weaponSummary() of the object.
+static bool needsWeaponSummary(OBJECT_PROPERTY prop)
+{
+	return prop == OBJPROP_CAN_HIT_AIR || prop == OBJPROP_CAN_HIT_GROUND || prop == OBJPROP_HAS_INDIRECT || prop == OBJPROP_RANGE;
+}
+
+static QScriptValue baseObjectProperty(BASE_OBJECT *psObj, OBJECT_PROPERTY prop, QScriptEngine *engine);
+static QScriptValue structureProperty(STRUCTURE *psStruct, OBJECT_PROPERTY prop, QScriptEngine *engine, const WEAPON_SUMMARY *weapons);
+static QScriptValue featureProperty(FEATURE *psFeature, OBJECT_PROPERTY prop, QScriptEngine *engine);
+static QScriptValue droidProperty(DROID *psDroid, OBJECT_PROPERTY prop, QScriptEngine *engine, const WEAPON_SUMMARY *weapons);
+
+/// Computes a property of a game object. Returns an invalid value if the object does not define it.
+/// weapons is the weaponSummary() of the object, if already known. Otherwise, it is computed if the property needs it.
+static QScriptValue objectProperty(BASE_OBJECT *psObj, OBJECT_PROPERTY prop, QScriptEngine *engine, const WEAPON_SUMMARY *weapons = nullptr)
+{
+	WEAPON_SUMMARY summary;
+	if (weapons == nullptr && needsWeaponSummary(prop))
+	{
+		summary = weaponSummary(psObj);
+		weapons = &summary;
+	}
+	switch (psObj->type)
+	{
+	case OBJ_DROID: return droidProperty((DROID *)psObj, prop, engine, weapons);
+	case OBJ_STRUCTURE: return structureProperty((STRUCTURE *)psObj, prop, engine, weapons);
+	case OBJ_FEATURE: return featureProperty((FEATURE *)psObj, prop, engine);
+	default: return baseObjectProperty(psObj, prop, engine);
+	}
+}
+
+/// Builds a script object with the given properties of a game object filled in.
+static QScriptValue convProperties(BASE_OBJECT *psObj, const std::vector<OBJECT_PROPERTY> &props, QScriptEngine *engine)
+{
+	QScriptValue value = engine->newObject();
+	const WEAPON_SUMMARY weapons = weaponSummary(psObj);  // Shared by all the properties which need it.
+	for (OBJECT_PROPERTY prop : props)
+	{
+		QScriptValue property = objectProperty(psObj, prop, engine, &weapons);
+		if (property.isValid())
+		{
+			value.setProperty(objectPropertyNames[prop], property, property.isNull() ? QScriptValue::KeepExistingFlags : QScriptValue::ReadOnly);
+		}
+	}
+	return value;
+}
+
 //;; ## Research
 //;;
 //;; Describes a research item. The following properties are defined:
@@ -515,78 +658,68 @@ QScriptValue convResearch(RESEARCH *psResearch, QScriptEngine *engine, int playe
 //;; * ```range``` Maximum range of its weapons. (3.2+ only)
 //;; * ```hasIndirect``` One or more of the structure's weapons are indirect. (3.2+ only)
 //;;
-QScriptValue convStructure(STRUCTURE *psStruct, QScriptEngine *engine)
-{
-	bool aa = false;
-	bool ga = false;
-	bool indirect = false;
-	int range = -1;
-	for (int i = 0; i < psStruct->numWeaps; i++)
-	{
-		if (psStruct->asWeaps[i].nStat)
-		{
-			WEAPON_STATS *psWeap = &asWeaponStats[psStruct->asWeaps[i].nStat];
-			aa = aa || psWeap->surfaceToAir & SHOOT_IN_AIR;
-			ga = ga || psWeap->surfaceToAir & SHOOT_ON_GROUND;
-			indirect = indirect || psWeap->movementModel == MM_INDIRECT || psWeap->movementModel == MM_HOMINGINDIRECT;
-			range = MAX((int)psWeap->upgrade[psStruct->player].maxRange, range);
-		}
-	}
-	QScriptValue value = convObj(psStruct, engine);
-	value.setProperty("isCB", structCBSensor(psStruct), QScriptValue::ReadOnly);
-	value.setProperty("isSensor", structStandardSensor(psStruct), QScriptValue::ReadOnly);
-	value.setProperty("canHitAir", aa, QScriptValue::ReadOnly);
-	value.setProperty("canHitGround", ga, QScriptValue::ReadOnly);
-	value.setProperty("hasIndirect", indirect, QScriptValue::ReadOnly);
-	value.setProperty("isRadarDetector", objRadarDetector(psStruct), QScriptValue::ReadOnly);
-	value.setProperty("range", range, QScriptValue::ReadOnly);
-	value.setProperty("status", (int)psStruct->status, QScriptValue::ReadOnly);
-	value.setProperty("health", 100 * psStruct->body / MAX(1, structureBody(psStruct)), QScriptValue::ReadOnly);
-	value.setProperty("cost", psStruct->pStructureType->powerToBuild, QScriptValue::ReadOnly);
-	switch (psStruct->pStructureType->type) // don't bleed our source insanities into the scripting world
-	{
-	case REF_WALL:
-	case REF_WALLCORNER:
-	case REF_GATE:
-		value.setProperty("stattype", (int)REF_WALL, QScriptValue::ReadOnly);
-		break;
-	case REF_GENERIC:
-	case REF_DEFENSE:
-		if (isLasSat(psStruct->pStructureType))
+static QScriptValue structureProperty(STRUCTURE *psStruct, OBJECT_PROPERTY prop, QScriptEngine *engine, const WEAPON_SUMMARY *weapons)
+{
+	switch (prop)
+	{
+	case OBJPROP_IS_CB: return structCBSensor(psStruct);
+	case OBJPROP_IS_SENSOR: return structStandardSensor(psStruct);
+	case OBJPROP_CAN_HIT_AIR: return weapons->canHitAir;
+	case OBJPROP_CAN_HIT_GROUND: return weapons->canHitGround;
+	case OBJPROP_HAS_INDIRECT: return weapons->indirect;
+	case OBJPROP_IS_RADAR_DETECTOR: return objRadarDetector(psStruct);
+	case OBJPROP_RANGE: return weapons->range;
+	case OBJPROP_STATUS: return (int)psStruct->status;
+	case OBJPROP_HEALTH: return 100 * psStruct->body / MAX(1, structureBody(psStruct));
+	case OBJPROP_COST: return psStruct->pStructureType->powerToBuild;
+	case OBJPROP_STATTYPE:
+		switch (psStruct->pStructureType->type) // don't bleed our source insanities into the scripting world
+		{
+		case REF_WALL:
+		case REF_WALLCORNER:
+		case REF_GATE:
+			return (int)REF_WALL;
+		case REF_GENERIC:
+		case REF_DEFENSE:
+			if (isLasSat(psStruct->pStructureType))
+			{
+				return (int)FAKE_REF_LASSAT;
+			}
+			return (int)REF_DEFENSE;
+		default:
+			return (int)psStruct->pStructureType->type;
+		}
+	case OBJPROP_MODULES:
+		if (psStruct->pStructureType->type == REF_FACTORY || psStruct->pStructureType->type == REF_CYBORG_FACTORY
+		    || psStruct->pStructureType->type == REF_VTOL_FACTORY
+		    || psStruct->pStructureType->type == REF_RESEARCH
+		    || psStruct->pStructureType->type == REF_POWER_GEN)
 		{
-			value.setProperty("stattype", (int)FAKE_REF_LASSAT, QScriptValue::ReadOnly);
-			break;
+			return psStruct->capacity;
 		}
-		value.setProperty("stattype", (int)REF_DEFENSE, QScriptValue::ReadOnly);
-		break;
-	default:
-		value.setProperty("stattype", (int)psStruct->pStructureType->type, QScriptValue::ReadOnly);
-		break;
-	}
-	if (psStruct->pStructureType->type == REF_FACTORY || psStruct->pStructureType->type == REF_CYBORG_FACTORY
-	    || psStruct->pStructureType->type == REF_VTOL_FACTORY
-	    || psStruct->pStructureType->type == REF_RESEARCH
-	    || psStruct->pStructureType->type == REF_POWER_GEN)
-	{
-		value.setProperty("modules", psStruct->capacity, QScriptValue::ReadOnly);
-	}
-	else
-	{
-		value.setProperty("modules", QScriptValue::NullValue);
-	}
-	QScriptValue weaponlist = engine->newArray(psStruct->numWeaps);
-	for (int j = 0; j < psStruct->numWeaps; j++)
-	{
-		QScriptValue weapon = engine->newObject();
-		const WEAPON_STATS *psStats = asWeaponStats + psStruct->asWeaps[j].nStat;
-		weapon.setProperty("fullname", psStats->name, QScriptValue::ReadOnly);
-		weapon.setProperty("name", psStats->id, QScriptValue::ReadOnly); // will be changed to contain full name
-		weapon.setProperty("id", psStats->id, QScriptValue::ReadOnly);
-		weapon.setProperty("lastFired", psStruct->asWeaps[j].lastFired, QScriptValue::ReadOnly);
-		weaponlist.setProperty(j, weapon, QScriptValue::ReadOnly);
+		return QScriptValue::NullValue;
+	case OBJPROP_WEAPONS:
+		{
+			QScriptValue weaponlist = engine->newArray(psStruct->numWeaps);
+			for (int j = 0; j < psStruct->numWeaps; j++)
+			{
+				QScriptValue weapon = engine->newObject();
+				const WEAPON_STATS *psStats = asWeaponStats + psStruct->asWeaps[j].nStat;
+				weapon.setProperty("fullname", psStats->name, QScriptValue::ReadOnly);
+				weapon.setProperty("name", psStats->id, QScriptValue::ReadOnly); // will be changed to contain full name
+				weapon.setProperty("id", psStats->id, QScriptValue::ReadOnly);
+				weapon.setProperty("lastFired", psStruct->asWeaps[j].lastFired, QScriptValue::ReadOnly);
+				weaponlist.setProperty(j, weapon, QScriptValue::ReadOnly);
+			}
+			return weaponlist;
+		}
+	default: return baseObjectProperty(psStruct, prop, engine);
 	}
-	value.setProperty("weapons", weaponlist, QScriptValue::ReadOnly);
-	return value;
+}
+
+QScriptValue convStructure(STRUCTURE *psStruct, QScriptEngine *engine)
+{
+	return convProperties(psStruct, structureProperties, engine);
 }
 
 //;; ## Feature
@@ -597,14 +730,21 @@ QScriptValue convStructure(STRUCTURE *psStruct, QScriptEngine *engine)
 //;; * ```stattype``` The type of feature. Defined types are ```OIL_RESOURCE```, ```OIL_DRUM``` and ```ARTIFACT```.
 //;; * ```damageable``` Can this feature be damaged?
 //;;
-QScriptValue convFeature(FEATURE *psFeature, QScriptEngine *engine)
+static QScriptValue featureProperty(FEATURE *psFeature, OBJECT_PROPERTY prop, QScriptEngine *engine)
 {
-	QScriptValue value = convObj(psFeature, engine);
 	const FEATURE_STATS *psStats = psFeature->psStats;
-	value.setProperty("health", 100 * psStats->body / MAX(1, psFeature->body), QScriptValue::ReadOnly);
-	value.setProperty("damageable", psStats->damageable, QScriptValue::ReadOnly);
-	value.setProperty("stattype", psStats->subType, QScriptValue::ReadOnly);
-	return value;
+	switch (prop)
+	{
+	case OBJPROP_HEALTH: return 100 * psStats->body / MAX(1, psFeature->body);
+	case OBJPROP_DAMAGEABLE: return psStats->damageable;
+	case OBJPROP_STATTYPE: return psStats->subType;
+	default: return baseObjectProperty(psFeature, prop, engine);
+	}
+}
+
+QScriptValue convFeature(FEATURE *psFeature, QScriptEngine *engine)
+{
+	return convProperties(psFeature, featureProperties, engine);
 }
 
 //;; ## Droid
@@ -670,87 +810,77 @@ QScriptValue convFeature(FEATURE *psFeature, QScriptEngine *engine)
 //;; * ```cargoCount``` Defined for transporters only: Number of individual \emph{items} in the cargo hold. (3.2+ only)
 //;; * ```cargoSize``` The amount of cargo space the droid will take inside a transport. (3.2+ only)
 //;;
-QScriptValue convDroid(DROID *psDroid, QScriptEngine *engine)
+static QScriptValue droidProperty(DROID *psDroid, OBJECT_PROPERTY prop, QScriptEngine *engine, const WEAPON_SUMMARY *weapons)
 {
-	bool aa = false;
-	bool ga = false;
-	bool indirect = false;
-	int range = -1;
-	const BODY_STATS *psBodyStats = &asBodyStats[psDroid->asBits[COMP_BODY]];
-
-	for (int i = 0; i < psDroid->numWeaps; i++)
+	switch (prop)
 	{
-		if (psDroid->asWeaps[i].nStat)
+	case OBJPROP_ACTION: return (int)psDroid->action;
+	case OBJPROP_RANGE:
 		{
-			WEAPON_STATS *psWeap = &asWeaponStats[psDroid->asWeaps[i].nStat];
-			aa = aa || psWeap->surfaceToAir & SHOOT_IN_AIR;
-			ga = ga || psWeap->surfaceToAir & SHOOT_ON_GROUND;
-			indirect = indirect || psWeap->movementModel == MM_INDIRECT || psWeap->movementModel == MM_HOMINGINDIRECT;
-			range = MAX((int)psWeap->upgrade[psDroid->player].maxRange, range);
+			int range = weapons->range;
+			if (range >= 0)
+			{
+				return range;
+			}
+			return QScriptValue::NullValue;
 		}
+	case OBJPROP_ORDER: return (int)psDroid->order.type;
+	case OBJPROP_COST: return calcDroidPower(psDroid);
+	case OBJPROP_HAS_INDIRECT: return weapons->indirect;
+	case OBJPROP_BODY_SIZE: return asBodyStats[psDroid->asBits[COMP_BODY]].size;
+	case OBJPROP_CARGO_CAPACITY: return isTransporter(psDroid) ? QScriptValue(TRANSPORTER_CAPACITY) : QScriptValue();
+	case OBJPROP_CARGO_LEFT: return isTransporter(psDroid) ? QScriptValue(calcRemainingCapacity(psDroid)) : QScriptValue();
+	case OBJPROP_CARGO_COUNT:
+		if (isTransporter(psDroid))
+		{
+			return psDroid->psGroup != nullptr? psDroid->psGroup->getNumMembers() : 0;
+		}
+		return QScriptValue();
+	case OBJPROP_IS_RADAR_DETECTOR: return objRadarDetector(psDroid);
+	case OBJPROP_IS_CB: return cbSensorDroid(psDroid);
+	case OBJPROP_IS_SENSOR: return standardSensorDroid(psDroid);
+	case OBJPROP_CAN_HIT_AIR: return weapons->canHitAir;
+	case OBJPROP_CAN_HIT_GROUND: return weapons->canHitGround;
+	case OBJPROP_IS_VTOL: return isVtolDroid(psDroid);
+	case OBJPROP_DROID_TYPE:
+		switch (psDroid->droidType) // hide some engine craziness
+		{
+		case DROID_CYBORG_CONSTRUCT: return (int)DROID_CONSTRUCT;
+		case DROID_CYBORG_SUPER: return (int)DROID_CYBORG;
+		case DROID_DEFAULT: return (int)DROID_WEAPON;
+		case DROID_CYBORG_REPAIR: return (int)DROID_REPAIR;
+		default: return (int)psDroid->droidType;
+		}
+	case OBJPROP_EXPERIENCE: return (double)psDroid->experience / 65536.0;
+	case OBJPROP_HEALTH: return 100.0 / (double)psDroid->originalBody * (double)psDroid->body;
+	case OBJPROP_BODY: return asBodyStats[psDroid->asBits[COMP_BODY]].id;
+	case OBJPROP_PROPULSION: return asPropulsionStats[psDroid->asBits[COMP_PROPULSION]].id;
+	case OBJPROP_ARMED: return 0.0; // deprecated!
+	case OBJPROP_WEAPONS:
+		{
+			QScriptValue weaponlist = engine->newArray(psDroid->numWeaps);
+			for (int j = 0; j < psDroid->numWeaps; j++)
+			{
+				int armed = droidReloadBar(psDroid, &psDroid->asWeaps[j], j);
+				QScriptValue weapon = engine->newObject();
+				const WEAPON_STATS *psStats = asWeaponStats + psDroid->asWeaps[j].nStat;
+				weapon.setProperty("fullname", psStats->name, QScriptValue::ReadOnly);
+				weapon.setProperty("id", psStats->id, QScriptValue::ReadOnly); // will be changed to full name
+				weapon.setProperty("name", psStats->id, QScriptValue::ReadOnly);
+				weapon.setProperty("lastFired", psDroid->asWeaps[j].lastFired, QScriptValue::ReadOnly);
+				weapon.setProperty("armed", armed, QScriptValue::ReadOnly);
+				weaponlist.setProperty(j, weapon, QScriptValue::ReadOnly);
+			}
+			return weaponlist;
+		}
+	case OBJPROP_CARGO_SIZE: return transporterSpaceRequired(psDroid);
+	default: return baseObjectProperty(psDroid, prop, engine);
 	}
-	DROID_TYPE type = psDroid->droidType;
-	QScriptValue value = convObj(psDroid, engine);
-	value.setProperty("action", (int)psDroid->action, QScriptValue::ReadOnly);
-	if (range >= 0)
-	{
-		value.setProperty("range", range, QScriptValue::ReadOnly);
-	}
-	else
-	{
-		value.setProperty("range", QScriptValue::NullValue);
-	}
-	value.setProperty("order", (int)psDroid->order.type, QScriptValue::ReadOnly);
-	value.setProperty("cost", calcDroidPower(psDroid), QScriptValue::ReadOnly);
-	value.setProperty("hasIndirect", indirect, QScriptValue::ReadOnly);
-	switch (psDroid->droidType) // hide some engine craziness
-	{
-	case DROID_CYBORG_CONSTRUCT:
-		type = DROID_CONSTRUCT; break;
-	case DROID_CYBORG_SUPER:
-		type = DROID_CYBORG; break;
-	case DROID_DEFAULT:
-		type = DROID_WEAPON; break;
-	case DROID_CYBORG_REPAIR:
-		type = DROID_REPAIR; break;
-	default:
-		break;
-	}
-	value.setProperty("bodySize", psBodyStats->size, QScriptValue::ReadOnly);
-	if (isTransporter(psDroid))
-	{
-		value.setProperty("cargoCapacity", TRANSPORTER_CAPACITY, QScriptValue::ReadOnly);
-		value.setProperty("cargoLeft", calcRemainingCapacity(psDroid), QScriptValue::ReadOnly);
-		value.setProperty("cargoCount", psDroid->psGroup != nullptr? psDroid->psGroup->getNumMembers() : 0, QScriptValue::ReadOnly);
-	}
-	value.setProperty("isRadarDetector", objRadarDetector(psDroid), QScriptValue::ReadOnly);
-	value.setProperty("isCB", cbSensorDroid(psDroid), QScriptValue::ReadOnly);
-	value.setProperty("isSensor", standardSensorDroid(psDroid), QScriptValue::ReadOnly);
-	value.setProperty("canHitAir", aa, QScriptValue::ReadOnly);
-	value.setProperty("canHitGround", ga, QScriptValue::ReadOnly);
-	value.setProperty("isVTOL", isVtolDroid(psDroid), QScriptValue::ReadOnly);
-	value.setProperty("droidType", (int)type, QScriptValue::ReadOnly);
-	value.setProperty("experience", (double)psDroid->experience / 65536.0, QScriptValue::ReadOnly);
-	value.setProperty("health", 100.0 / (double)psDroid->originalBody * (double)psDroid->body, QScriptValue::ReadOnly);
-	value.setProperty("body", asBodyStats[psDroid->asBits[COMP_BODY]].id, QScriptValue::ReadOnly);
-	value.setProperty("propulsion", asPropulsionStats[psDroid->asBits[COMP_PROPULSION]].id, QScriptValue::ReadOnly);
-	value.setProperty("armed", 0.0, QScriptValue::ReadOnly); // deprecated!
-	QScriptValue weaponlist = engine->newArray(psDroid->numWeaps);
-	for (int j = 0; j < psDroid->numWeaps; j++)
-	{
-		int armed = droidReloadBar(psDroid, &psDroid->asWeaps[j], j);
-		QScriptValue weapon = engine->newObject();
-		const WEAPON_STATS *psStats = asWeaponStats + psDroid->asWeaps[j].nStat;
-		weapon.setProperty("fullname", psStats->name, QScriptValue::ReadOnly);
-		weapon.setProperty("id", psStats->id, QScriptValue::ReadOnly); // will be changed to full name
-		weapon.setProperty("name", psStats->id, QScriptValue::ReadOnly);
-		weapon.setProperty("lastFired", psDroid->asWeaps[j].lastFired, QScriptValue::ReadOnly);
-		weapon.setProperty("armed", armed, QScriptValue::ReadOnly);
-		weaponlist.setProperty(j, weapon, QScriptValue::ReadOnly);
-	}
-	value.setProperty("weapons", weaponlist, QScriptValue::ReadOnly);
-	value.setProperty("cargoSize", transporterSpaceRequired(psDroid), QScriptValue::ReadOnly);
-	return value;
+}
+
+QScriptValue convDroid(DROID *psDroid, QScriptEngine *engine)
+{
+	return convProperties(psDroid, droidProperties, engine);
 }
 
 //;; ## Base Object
@@ -773,32 +903,38 @@ QScriptValue convDroid(DROID *psDroid, QScriptEngine *engine)
 //;; * ```thermal``` Amount of thermal protection that protect against heat based weapons.
 //;; * ```born``` The game time at which this object was produced or came into the world. (3.2+ only)
 //;;
+static QScriptValue baseObjectProperty(BASE_OBJECT *psObj, OBJECT_PROPERTY prop, QScriptEngine *engine)
+{
+	switch (prop)
+	{
+	case OBJPROP_ID: return psObj->id;
+	case OBJPROP_X: return map_coord(psObj->pos.x);
+	case OBJPROP_Y: return map_coord(psObj->pos.y);
+	case OBJPROP_Z: return map_coord(psObj->pos.z);
+	case OBJPROP_PLAYER: return psObj->player;
+	case OBJPROP_ARMOUR: return objArmour(psObj, WC_KINETIC);
+	case OBJPROP_THERMAL: return objArmour(psObj, WC_HEAT);
+	case OBJPROP_TYPE: return psObj->type;
+	case OBJPROP_SELECTED: return psObj->selected;
+	case OBJPROP_NAME: return objInfo(psObj);
+	case OBJPROP_BORN: return psObj->born;
+	case OBJPROP_GROUP:
+		{
+			GROUPMAP *psMap = groups.value(engine);
+			if (psMap->contains(psObj))
+			{
+				return psMap->value(psObj);
+			}
+			return QScriptValue::NullValue;
+		}
+	default: return QScriptValue();
+	}
+}
+
 QScriptValue convObj(BASE_OBJECT *psObj, QScriptEngine *engine)
 {
-	QScriptValue value = engine->newObject();
-	ASSERT_OR_RETURN(value, psObj, "No object for conversion");
-	value.setProperty("id", psObj->id, QScriptValue::ReadOnly);
-	value.setProperty("x", map_coord(psObj->pos.x), QScriptValue::ReadOnly);
-	value.setProperty("y", map_coord(psObj->pos.y), QScriptValue::ReadOnly);
-	value.setProperty("z", map_coord(psObj->pos.z), QScriptValue::ReadOnly);
-	value.setProperty("player", psObj->player, QScriptValue::ReadOnly);
-	value.setProperty("armour", objArmour(psObj, WC_KINETIC), QScriptValue::ReadOnly);
-	value.setProperty("thermal", objArmour(psObj, WC_HEAT), QScriptValue::ReadOnly);
-	value.setProperty("type", psObj->type, QScriptValue::ReadOnly);
-	value.setProperty("selected", psObj->selected, QScriptValue::ReadOnly);
-	value.setProperty("name", objInfo(psObj), QScriptValue::ReadOnly);
-	value.setProperty("born", psObj->born, QScriptValue::ReadOnly);
-	GROUPMAP *psMap = groups.value(engine);
-	if (psMap->contains(psObj))
-	{
-		int group = psMap->value(psObj);
-		value.setProperty("group", group, QScriptValue::ReadOnly);
-	}
-	else
-	{
-		value.setProperty("group", QScriptValue::NullValue);
-	}
-	return value;
+	ASSERT_OR_RETURN(engine->newObject(), psObj, "No object for conversion");
+	return convProperties(psObj, baseObjectProperties, engine);
 }
 
 //;; ## Template
@@ -859,6 +995,230 @@ QScriptValue convMax(BASE_OBJECT *psObj, QScriptEngine *engine)
 	}
 }
 
+// ----------------------------------------------------------------------------------------
+// Lazy game objects
+//
+
+/// Script class for game objects whose properties are only computed when read. The script object only holds the
+/// object ID, type and player; everything else is looked up through the ID index. Values are cached for the rest of
+/// the game tick, except for the ones scripts may change within a tick by giving orders or managing groups.
+class ObjectWrapperClass : public QScriptClass
+{
+public:
+	explicit ObjectWrapperClass(QScriptEngine *engine);
+
+	QueryFlags queryProperty(const QScriptValue &object, const QScriptString &name, QueryFlags flags, uint *id) override;
+	QScriptValue property(const QScriptValue &object, const QScriptString &name, uint id) override;
+	QScriptValue::PropertyFlags propertyFlags(const QScriptValue &object, const QScriptString &name, uint id) override;
+	void setProperty(QScriptValue &object, const QScriptString &name, uint id, const QScriptValue &value) override;
+	QScriptClassPropertyIterator *newIterator(const QScriptValue &object) override;
+	QString name() const override;
+
+	/// Script data holding what is needed to find the object again, and what is still known once it is gone.
+	static QScriptValue objectData(const BASE_OBJECT *psObj);
+
+	bool enabled = false;                            ///< Set by the script through setLazyObjects()
+	QScriptString propertyNames[OBJPROP_COUNT];
+
+	/// Forgets the property values read so far in this game tick.
+	void clearCache() { cache.clear(); }
+
+private:
+	struct CACHED_OBJECT
+	{
+		QScriptValue values[OBJPROP_COUNT];      ///< Invalid until computed
+	};
+
+	QHash<QScriptString, uint> propertyIds;
+	std::bitset<OBJPROP_COUNT> definedProperties[OBJ_NUM_TYPES];
+	QHash<uint32_t, CACHED_OBJECT> cache;
+	UDWORD cacheTime = 0;
+};
+
+class ObjectWrapperIterator : public QScriptClassPropertyIterator
+{
+public:
+	ObjectWrapperIterator(const QScriptValue &object, const ObjectWrapperClass *wrapperClass, std::vector<OBJECT_PROPERTY> props)
+		: QScriptClassPropertyIterator(object), wrapperClass(wrapperClass), props(std::move(props)) {}
+
+	bool hasNext() const override { return index < props.size(); }
+	void next() override { last = index++; }
+	bool hasPrevious() const override { return index > 0; }
+	void previous() override { last = --index; }
+	void toFront() override { index = 0; last = -1; }
+	void toBack() override { index = props.size(); last = -1; }
+	QScriptString name() const override { return wrapperClass->propertyNames[props[last]]; }
+	uint id() const override { return props[last]; }
+
+private:
+	const ObjectWrapperClass *wrapperClass;
+	std::vector<OBJECT_PROPERTY> props;
+	size_t index = 0;
+	int last = -1;
+};
+
+static QHash<QScriptEngine *, ObjectWrapperClass *> objectWrappers;
+
+// The object data packs the ID in the low 32 bits, then 8 bits each of type and player, which a script number holds exactly.
+QScriptValue ObjectWrapperClass::objectData(const BASE_OBJECT *psObj)
+{
+	return QScriptValue((qsreal)(psObj->id | (uint64_t)psObj->type << 32 | (uint64_t)psObj->player << 40));
+}
+
+static uint32_t wrappedId(const QScriptValue &data)
+{
+	return (uint64_t)data.toNumber() & 0xffffffff;
+}
+
+static OBJECT_TYPE wrappedType(const QScriptValue &data)
+{
+	return (OBJECT_TYPE)(((uint64_t)data.toNumber() >> 32) & 0xff);
+}
+
+static int wrappedPlayer(const QScriptValue &data)
+{
+	return ((uint64_t)data.toNumber() >> 40) & 0xff;
+}
+
+/// Whether the wrapped object has a property of its type's property list. Only the cargo properties depend on the object
+/// itself, as objectProperty() leaves them out for droids which are not transporters, so only they look the object up.
+static bool wrappedHasProperty(const QScriptValue &data, OBJECT_PROPERTY prop)
+{
+	switch (prop)
+	{
+	case OBJPROP_CARGO_CAPACITY:
+	case OBJPROP_CARGO_LEFT:
+	case OBJPROP_CARGO_COUNT:
+		{
+			const BASE_OBJECT *psObj = findObjectById(wrappedId(data));
+			return psObj != nullptr && psObj->type == OBJ_DROID && isTransporter((const DROID *)psObj);
+		}
+	default: return true;
+	}
+}
+
+ObjectWrapperClass::ObjectWrapperClass(QScriptEngine *engine)
+	: QScriptClass(engine)
+{
+	for (uint i = 0; i < OBJPROP_COUNT; ++i)
+	{
+		propertyNames[i] = engine->toStringHandle(objectPropertyNames[i]);
+		propertyIds.insert(propertyNames[i], i);
+	}
+	for (int type = 0; type < OBJ_NUM_TYPES; ++type)
+	{
+		for (OBJECT_PROPERTY prop : objectPropertyList((OBJECT_TYPE)type))
+		{
+			definedProperties[type].set(prop);
+		}
+	}
+}
+
+ObjectWrapperClass::QueryFlags ObjectWrapperClass::queryProperty(const QScriptValue &object, const QScriptString &name, QueryFlags flags, uint *id)
+{
+	auto it = propertyIds.constFind(name);
+	const QScriptValue data = object.data();
+	if (it == propertyIds.constEnd() || !definedProperties[wrappedType(data)].test(it.value())
+	    || !wrappedHasProperty(data, (OBJECT_PROPERTY)it.value()))
+	{
+		return QueryFlags();  // an ordinary property the script set itself
+	}
+	*id = it.value();
+	return flags;
+}
+
+QScriptValue ObjectWrapperClass::property(const QScriptValue &object, const QScriptString &, uint id)
+{
+	const QScriptValue data = object.data();
+	const uint32_t objId = wrappedId(data);
+	const OBJECT_PROPERTY prop = (OBJECT_PROPERTY)id;
+	switch (prop)
+	{
+	case OBJPROP_ID: return objId;
+	case OBJPROP_TYPE: return wrappedType(data);
+	default: break;
+	}
+	const bool cacheable = prop != OBJPROP_ACTION && prop != OBJPROP_ORDER && prop != OBJPROP_GROUP && prop != OBJPROP_SELECTED;
+	if (cacheTime != gameTime)
+	{
+		cache.clear();
+		cacheTime = gameTime;
+	}
+	if (cacheable)
+	{
+		auto it = cache.constFind(objId);
+		if (it != cache.constEnd() && it->values[prop].isValid())
+		{
+			return it->values[prop];
+		}
+	}
+	BASE_OBJECT *psObj = findObjectById(objId);
+	if (psObj == nullptr || psObj->type != wrappedType(data))
+	{
+		// Gone, so all that is left is what the script object itself knows.
+		return prop == OBJPROP_PLAYER ? QScriptValue(wrappedPlayer(data)) : QScriptValue(QScriptValue::UndefinedValue);
+	}
+	QScriptValue value = objectProperty(psObj, prop, engine());
+	if (!value.isValid())
+	{
+		value = QScriptValue(QScriptValue::UndefinedValue);
+	}
+	if (cacheable)
+	{
+		cache[objId].values[prop] = value;
+	}
+	return value;
+}
+
+QScriptValue::PropertyFlags ObjectWrapperClass::propertyFlags(const QScriptValue &, const QScriptString &, uint)
+{
+	return QScriptValue::ReadOnly;
+}
+
+void ObjectWrapperClass::setProperty(QScriptValue &, const QScriptString &, uint, const QScriptValue &)
+{
+	// read-only, like the properties of fully built objects
+}
+
+QScriptClassPropertyIterator *ObjectWrapperClass::newIterator(const QScriptValue &object)
+{
+	const QScriptValue data = object.data();
+	std::vector<OBJECT_PROPERTY> props;
+	for (OBJECT_PROPERTY prop : objectPropertyList(wrappedType(data)))
+	{
+		if (wrappedHasProperty(data, prop))
+		{
+			props.push_back(prop);
+		}
+	}
+	return new ObjectWrapperIterator(object, this, std::move(props));
+}
+
+QString ObjectWrapperClass::name() const
+{
+	return QString("GameObject");
+}
+
+bool setLazyObjects(QScriptEngine *engine, bool enable)
+{
+	ObjectWrapperClass *wrapperClass = objectWrappers.value(engine);
+	ASSERT_OR_RETURN(false, wrapperClass, "No lazy objects for this engine");
+	const bool wasEnabled = wrapperClass->enabled;
+	wrapperClass->enabled = enable;
+	wrapperClass->clearCache();
+	return wasEnabled;
+}
+
+QScriptValue convLazy(BASE_OBJECT *psObj, QScriptEngine *engine)
+{
+	ObjectWrapperClass *wrapperClass = objectWrappers.value(engine);
+	if (!psObj || !wrapperClass || !wrapperClass->enabled)
+	{
+		return convMax(psObj, engine);
+	}
+	return engine->newObject(wrapperClass, ObjectWrapperClass::objectData(psObj));
+}
+
 BASE_OBJECT *IdToObject(OBJECT_TYPE type, int id, int player)
 {
 	switch (type)
@@ -1426,7 +1786,7 @@ static QScriptValue js_enumGroup(QScriptContext *context, QScriptEngine *engine)
 	for (int i = 0; i < matches.size(); i++)
 	{
 		BASE_OBJECT *psObj = matches.at(i);
-		result.setProperty(i, convMax(psObj, engine));
+		result.setProperty(i, convLazy(psObj, engine));
 	}
 	return result;
 }
@@ -2045,7 +2405,7 @@ static QScriptValue js_enumStruct(QScriptContext *context, QScriptEngine *engine
 	for (int i = 0; i < matches.size(); i++)
 	{
 		STRUCTURE *psStruct = matches.at(i);
-		result.setProperty(i, convStructure(psStruct, engine));
+		result.setProperty(i, convLazy(psStruct, engine));
 	}
 	return result;
 }
@@ -2100,7 +2460,7 @@ static QScriptValue js_enumStructOffWorld(QScriptContext *context, QScriptEngine
 	for (int i = 0; i < matches.size(); i++)
 	{
 		STRUCTURE *psStruct = matches.at(i);
-		result.setProperty(i, convStructure(psStruct, engine));
+		result.setProperty(i, convLazy(psStruct, engine));
 	}
 	return result;
 }
@@ -2134,7 +2494,7 @@ static QScriptValue js_enumFeature(QScriptContext *context, QScriptEngine *engin
 	for (int i = 0; i < matches.size(); i++)
 	{
 		FEATURE *psFeat = matches.at(i);
-		result.setProperty(i, convFeature(psFeat, engine));
+		result.setProperty(i, convLazy(psFeat, engine));
 	}
 	return result;
 }
@@ -2157,7 +2517,7 @@ static QScriptValue js_enumCargo(QScriptContext *context, QScriptEngine *engine)
 	{
 		if (psDroid != psCurr)
 		{
-			result.setProperty(i, convDroid(psCurr, engine));
+			result.setProperty(i, convLazy(psCurr, engine));
 		}
 	}
 	return result;
@@ -2214,7 +2574,7 @@ static QScriptValue js_enumDroid(QScriptContext *context, QScriptEngine *engine)
 	for (int i = 0; i < matches.size(); i++)
 	{
 		DROID *psDroid = matches.at(i);
-		result.setProperty(i, convDroid(psDroid, engine));
+		result.setProperty(i, convLazy(psDroid, engine));
 	}
 	return result;
 }
@@ -3937,69 +4297,65 @@ static QScriptValue js_loadLevel(QScriptContext *context, QScriptEngine *)
 	return QScriptValue();
 }
 
-//-- ## enumRange(x, y, range[, filter[, seen]])
-//--
-//-- Returns an array of game objects seen within range of given position that passes the optional filter
-//-- which can be one of a player index, ALL_PLAYERS, ALLIES or ENEMIES. By default, filter is
-//-- ALL_PLAYERS. Finally an optional parameter can specify whether only visible objects should be
-//-- returned; by default only visible objects are returned. Calling this function is much faster than
-//-- iterating over all game objects using other enum functions. (3.2+ only)
-//--
-static QScriptValue js_enumRange(QScriptContext *context, QScriptEngine *engine)
+/// Scratch space for the searches done by enumRange(), enumArea(), countRange() and countArea(). These do not use
+/// gridStartIterate(), so that they do not share results with searches done by the game.
+static GridSearch scriptGridSearch;
+
+/// Filters the objects in scriptGridSearch by the filter, seen and type parameters starting at argument nextparam,
+/// then returns either the number of objects left or an array of script objects for them.
+static QScriptValue scriptSearchResults(QScriptContext *context, QScriptEngine *engine, int nextparam, bool countOnly)
 {
 	int player = engine->globalObject().property("me").toInt32();
-	int x = world_coord(context->argument(0).toInt32());
-	int y = world_coord(context->argument(1).toInt32());
-	int range = world_coord(context->argument(2).toInt32());
 	int filter = ALL_PLAYERS;
 	bool seen = true;
-	if (context->argumentCount() > 3)
+	int type = OBJ_NUM_TYPES;  // any type
+	if (context->argumentCount() > nextparam)
 	{
-		filter = context->argument(3).toInt32();
+		filter = context->argument(nextparam).toInt32();
 	}
-	if (context->argumentCount() > 4)
+	if (context->argumentCount() > nextparam + 1)
 	{
-		seen = context->argument(4).toBool();
+		seen = context->argument(nextparam + 1).toBool();
 	}
-	static GridList gridList;  // static to avoid allocations.
-	gridList = gridStartIterate(x, y, range);
-	QList<BASE_OBJECT *> list;
-	for (GridIterator gi = gridList.begin(); gi != gridList.end(); ++gi)
+	if (context->argumentCount() > nextparam + 2)
 	{
-		BASE_OBJECT *psObj = *gi;
-		if ((psObj->visible[player] || !seen) && !psObj->died)
+		type = context->argument(nextparam + 2).toInt32();
+		SCRIPT_ASSERT(context, type == OBJ_DROID || type == OBJ_STRUCTURE || type == OBJ_FEATURE, "Bad object type %d", type);
+	}
+	GridList &objects = scriptGridSearch.objects;
+	objects.erase(std::remove_if(objects.begin(), objects.end(), [&](BASE_OBJECT *psObj) {
+		if ((!psObj->visible[player] && seen) || psObj->died || (type != OBJ_NUM_TYPES && psObj->type != type))
 		{
-			if ((filter >= 0 && psObj->player == filter) || filter == ALL_PLAYERS
-			    || (filter == ALLIES && psObj->type != OBJ_FEATURE && aiCheckAlliances(psObj->player, player))
-			    || (filter == ENEMIES && psObj->type != OBJ_FEATURE && !aiCheckAlliances(psObj->player, player)))
-			{
-				list.append(psObj);
-			}
+			return true;
 		}
+		return !((filter >= 0 && psObj->player == filter) || filter == ALL_PLAYERS
+		         || (filter == ALLIES && psObj->type != OBJ_FEATURE && aiCheckAlliances(psObj->player, player))
+		         || (filter == ENEMIES && psObj->type != OBJ_FEATURE && !aiCheckAlliances(psObj->player, player)));
+	}), objects.end());
+	if (countOnly)
+	{
+		return (int)objects.size();
 	}
-	QScriptValue value = engine->newArray(list.size());
-	for (int i = 0; i < list.size(); i++)
+	QScriptValue value = engine->newArray(objects.size());
+	for (unsigned i = 0; i < objects.size(); i++)
 	{
-		value.setProperty(i, convMax(list[i], engine), QScriptValue::ReadOnly);
+		value.setProperty(i, convLazy(objects[i], engine), QScriptValue::ReadOnly);
 	}
 	return value;
 }
 
-//-- ## enumArea(<x1, y1, x2, y2 | label>[, filter[, seen]])
-//--
-//-- Returns an array of game objects seen within the given area that passes the optional filter
-//-- which can be one of a player index, ALL_PLAYERS, ALLIES or ENEMIES. By default, filter is
-//-- ALL_PLAYERS. Finally an optional parameter can specify whether only visible objects should be
-//-- returned; by default only visible objects are returned. The label can either be actual
-//-- positions or a label to an AREA. Calling this function is much faster than iterating over all
-//-- game objects using other enum functions. (3.2+ only)
-//--
-static QScriptValue js_enumArea(QScriptContext *context, QScriptEngine *engine)
+static QScriptValue scriptSearchRange(QScriptContext *context, QScriptEngine *engine, bool countOnly)
+{
+	int x = world_coord(context->argument(0).toInt32());
+	int y = world_coord(context->argument(1).toInt32());
+	int range = world_coord(context->argument(2).toInt32());
+	gridSearch(scriptGridSearch, x, y, range);
+	return scriptSearchResults(context, engine, 3, countOnly);
+}
+
+static QScriptValue scriptSearchArea(QScriptContext *context, QScriptEngine *engine, bool countOnly)
 {
-	int player = engine->globalObject().property("me").toInt32();
 	int x1, y1, x2, y2, nextparam;
-	int filter = ALL_PLAYERS;
-	bool seen = true;
 	if (context->argument(0).isString())
 	{
 		QString label = context->argument(0).toString();
@@ -4020,36 +4376,73 @@ static QScriptValue js_enumArea(QScriptContext *context, QScriptEngine *engine)
 		y2 = world_coord(context->argument(3).toInt32());
 		nextparam = 4;
 	}
-	if (context->argumentCount() > nextparam++)
-	{
-		filter = context->argument(nextparam - 1).toInt32();
-	}
-	if (context->argumentCount() > nextparam++)
-	{
-		seen = context->argument(nextparam - 1).toBool();
-	}
-	static GridList gridList;  // static to avoid allocations.
-	gridList = gridStartIterateArea(x1, y1, x2, y2);
-	QList<BASE_OBJECT *> list;
-	for (GridIterator gi = gridList.begin(); gi != gridList.end(); ++gi)
-	{
-		BASE_OBJECT *psObj = *gi;
-		if ((psObj->visible[player] || !seen) && !psObj->died)
-		{
-			if ((filter >= 0 && psObj->player == filter) || filter == ALL_PLAYERS
-			    || (filter == ALLIES && psObj->type != OBJ_FEATURE && aiCheckAlliances(psObj->player, player))
-			    || (filter == ENEMIES && psObj->type != OBJ_FEATURE && !aiCheckAlliances(psObj->player, player)))
-			{
-				list.append(psObj);
-			}
-		}
-	}
-	QScriptValue value = engine->newArray(list.size());
-	for (int i = 0; i < list.size(); i++)
-	{
-		value.setProperty(i, convMax(list[i], engine), QScriptValue::ReadOnly);
-	}
-	return value;
+	gridSearchArea(scriptGridSearch, x1, y1, x2, y2);
+	return scriptSearchResults(context, engine, nextparam, countOnly);
+}
+
+//-- ## enumRange(x, y, range[, filter[, seen[, type]]])
+//--
+//-- Returns an array of game objects seen within range of given position that passes the optional filter
+//-- which can be one of a player index, ALL_PLAYERS, ALLIES or ENEMIES. By default, filter is
+//-- ALL_PLAYERS. Finally an optional parameter can specify whether only visible objects should be
+//-- returned; by default only visible objects are returned. Calling this function is much faster than
+//-- iterating over all game objects using other enum functions. (3.2+ only)
+//-- The type parameter limits the objects returned to one of DROID, STRUCTURE or FEATURE. (3.3+ only)
+//--
+static QScriptValue js_enumRange(QScriptContext *context, QScriptEngine *engine)
+{
+	return scriptSearchRange(context, engine, false);
+}
+
+//-- ## countRange(x, y, range[, filter[, seen[, type]]])
+//--
+//-- Returns the number of game objects ```enumRange()``` would return for the same parameters, without
+//-- making script objects for them. (3.3+ only)
+//--
+static QScriptValue js_countRange(QScriptContext *context, QScriptEngine *engine)
+{
+	return scriptSearchRange(context, engine, true);
+}
+
+//-- ## enumArea(<x1, y1, x2, y2 | label>[, filter[, seen[, type]]])
+//--
+//-- Returns an array of game objects seen within the given area that passes the optional filter
+//-- which can be one of a player index, ALL_PLAYERS, ALLIES or ENEMIES. By default, filter is
+//-- ALL_PLAYERS. Finally an optional parameter can specify whether only visible objects should be
+//-- returned; by default only visible objects are returned. The label can either be actual
+//-- positions or a label to an AREA. Calling this function is much faster than iterating over all
+//-- game objects using other enum functions. (3.2+ only)
+//-- The type parameter limits the objects returned to one of DROID, STRUCTURE or FEATURE. (3.3+ only)
+//--
+static QScriptValue js_enumArea(QScriptContext *context, QScriptEngine *engine)
+{
+	return scriptSearchArea(context, engine, false);
+}
+
+//-- ## countArea(<x1, y1, x2, y2 | label>[, filter[, seen[, type]]])
+//--
+//-- Returns the number of game objects ```enumArea()``` would return for the same parameters, without
+//-- making script objects for them. (3.3+ only)
+//--
+static QScriptValue js_countArea(QScriptContext *context, QScriptEngine *engine)
+{
+	return scriptSearchArea(context, engine, true);
+}
+
+//-- ## setLazyObjects(enable)
+//--
+//-- Makes ```enumDroid()```, ```enumStruct()```, ```enumStructOffWorld()```, ```enumFeature()```, ```enumCargo()```,
+//-- ```enumGroup()```, ```enumRange()``` and ```enumArea()``` return objects that look up their properties when they are read,
+//-- instead of filling them all in up front. This is much faster for scripts that enumerate many objects but only read
+//-- a few properties of each. The values are those of the object when first read in the current game tick, except
+//-- ```order```, ```action```, ```group``` and ```selected```, which are always current. Once the object is gone,
+//-- only ```id```, ```type``` and ```player``` remain. Call it when the script is loaded, so that it also applies
+//-- after loading a savegame. (3.3+ only)
+//--
+static QScriptValue js_setLazyObjects(QScriptContext *context, QScriptEngine *engine)
+{
+	setLazyObjects(engine, context->argument(0).toBool());
+	return QScriptValue();
 }
 
 //-- ## addBeacon(x, y, target player[, message])
@@ -4822,6 +5215,7 @@ bool unregisterFunctions(QScriptEngine *engine)
 	int num = groups.remove(engine);
 	delete psMap;
 	ASSERT(num == 1, "Number of engines removed from group map is %d!", num);
+	delete objectWrappers.take(engine);
 	labels.clear();
 	labelModel = nullptr;
 	return true;
@@ -5478,6 +5872,7 @@ bool registerFunctions(QScriptEngine *engine, const QString& scriptName)
 	// Create group map
 	GROUPMAP *psMap = new GROUPMAP;
 	groups.insert(engine, psMap);
+	objectWrappers.insert(engine, new ObjectWrapperClass(engine));
 
 	/// Register 'Stats' object. It is a read-only representation of basic game component states.
 	//== * ```Stats``` A sparse, read-only array containing rules information for game entity types.
@@ -5892,7 +6287,10 @@ bool registerFunctions(QScriptEngine *engine, const QString& scriptName)
 	engine->globalObject().setProperty("enumSelected", engine->newFunction(js_enumSelected));
 	engine->globalObject().setProperty("enumResearch", engine->newFunction(js_enumResearch));
 	engine->globalObject().setProperty("enumRange", engine->newFunction(js_enumRange));
+	engine->globalObject().setProperty("countRange", engine->newFunction(js_countRange));
 	engine->globalObject().setProperty("enumArea", engine->newFunction(js_enumArea));
+	engine->globalObject().setProperty("countArea", engine->newFunction(js_countArea));
+	engine->globalObject().setProperty("setLazyObjects", engine->newFunction(js_setLazyObjects));
 	engine->globalObject().setProperty("getResearch", engine->newFunction(js_getResearch));
 	engine->globalObject().setProperty("pursueResearch", engine->newFunction(js_pursueResearch));
 	engine->globalObject().setProperty("findResearch", engine->newFunction(js_findResearch));
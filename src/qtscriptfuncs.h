@@ -62,6 +62,10 @@ QScriptValue convStructure(STRUCTURE *psStruct, QScriptEngine *engine);
 QScriptValue convObj(BASE_OBJECT *psObj, QScriptEngine *engine);
 QScriptValue convFeature(FEATURE *psFeature, QScriptEngine *engine);
 QScriptValue convMax(BASE_OBJECT *psObj, QScriptEngine *engine);
+/// Like convMax(), but returns an object that computes its properties when read if the script called setLazyObjects().
+QScriptValue convLazy(BASE_OBJECT *psObj, QScriptEngine *engine);
+/// Turns lazy objects on or off for the engine, like the script calling setLazyObjects(), and returns whether they were on.
+bool setLazyObjects(QScriptEngine *engine, bool enable);
 QScriptValue convTemplate(DROID_TEMPLATE *psTemplate, QScriptEngine *engine);
 QScriptValue convResearch(RESEARCH *psResearch, QScriptEngine *engine, int player);
 BASE_OBJECT *IdToObject(OBJECT_TYPE type, int id, int player);
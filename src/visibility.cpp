@@ -24,6 +24,8 @@
  */
 #include "lib/framework/frame.h"
 #include "lib/framework/fixedpoint.h"
+#include "lib/framework/math_ext.h"
+#include "lib/framework/wzthreadpool.h"
 
 #include "lib/gamelib/gtime.h"
 #include "lib/sound/audio.h"
@@ -52,6 +54,9 @@
 static const int VIS_LEVEL_INC = 255 * 2;
 static const int VIS_LEVEL_DEC = 50;
 
+// size in world units of the grid cells used for finding radars near radar detectors
+#define RADAR_DETECTOR_CELL_SIZE (TILE_UNITS * 8)
+
 // integer amount to change visibility this turn
 static SDWORD			visLevelInc, visLevelDec;
 
@@ -76,6 +81,21 @@ public:
 };
 static std::vector<SPOTTER *> apsInvisibleViewers;
 
+/// An object seen by a viewer, found by a visibility thread and applied by the main thread.
+struct VisibilitySeen
+{
+	BASE_OBJECT *psObj;
+	int val;
+};
+
+// number of viewers a visibility thread looks around for at a time
+#define VIS_VIEWERS_PER_JOB 16
+
+static std::vector<BASE_OBJECT *> visViewers;                   ///< Objects looking around this tick, in the order they are applied in.
+static std::vector<std::vector<VisibilitySeen>> visViewerSeen;  ///< What each of visViewers saw.
+static std::vector<std::pair<BASE_OBJECT *, BASE_OBJECT *>> visSeenEvents;  ///< Viewers and the objects they saw, for triggerEventSeen.
+static std::vector<GridSearch> visSearches;                      ///< Grid search for each worker, so they don't get in each other's way.
+
 // horrible hack because this code is full of them and I ain't rewriting it all - Per
 #define MAX_SEEN_TILES (29*29 * 355/113)  // Increased hack to support 28 tile sensor radius. - Cyp
 
@@ -90,9 +110,18 @@ bool visInitialise()
 	visLevelInc = 1;
 	visLevelDec = 0;
 
+	// One for each worker thread, and one for the main thread, which looks around too.
+	visSearches.resize(wzThreadPoolSize() + 1);
+
 	return true;
 }
 
+// shutdown the visibility stuff
+void visShutdown()
+{
+	visSearches.clear();
+}
+
 // update the visibility change levels
 void visUpdateLevel()
 {
@@ -612,33 +641,90 @@ static void processVisibilitySelf(BASE_OBJECT *psObj)
 }
 
 // Calculate which objects we can see. Better to call after processVisibilitySelf, since that check is cheaper.
-static void processVisibilityVision(BASE_OBJECT *psViewer)
+// This function may run in a separate thread, so only records what was seen.
+static void processVisibilityVision(BASE_OBJECT *psViewer, std::vector<VisibilitySeen> &seen, GridSearch &search)
 {
+	seen.clear();
 	if (psViewer->type == OBJ_FEATURE)
 	{
 		return;
 	}
 
 	// get all the objects from the grid the droid is in
-	// Will give inconsistent results if hasSharedVision is not an equivalence relation.
-	static GridList gridList;  // static to avoid allocations.
-	gridList = gridStartIterateUnseen(psViewer->pos.x, psViewer->pos.y, objSensorRange(psViewer), psViewer->player);
-	for (GridIterator gi = gridList.begin(); gi != gridList.end(); ++gi)
+	gridSearchUnseen(search, psViewer->pos.x, psViewer->pos.y, objSensorRange(psViewer), psViewer->player);
+	for (BASE_OBJECT *psObj : search.objects)
 	{
-		BASE_OBJECT *psObj = *gi;
-
 		int val = visibleObject(psViewer, psObj, false);
 
 		// If we've got ranged line of sight...
 		if (val > 0)
 		{
-			// Tell system that this side can see this object
-			setSeenBy(psObj, psViewer->player, val);
+			VisibilitySeen obj;
+			obj.psObj = psObj;
+			obj.val = val;
+			seen.push_back(obj);
+		}
+	}
+}
+
+// Looks around for a batch of viewers from visViewers.
+static void processVisibilityVisionJob(unsigned job, unsigned worker)
+{
+	unsigned begin = job * VIS_VIEWERS_PER_JOB;
+	unsigned end = std::min<unsigned>(begin + VIS_VIEWERS_PER_JOB, visViewers.size());
+	for (unsigned i = begin; i < end; ++i)
+	{
+		processVisibilityVision(visViewers[i], visViewerSeen[i], visSearches[worker]);
+	}
+}
+
+// Calculate which objects all droids and structures can see, spread over the worker threads.
+static void processVisibilityVisionAll()
+{
+	visViewers.clear();
+	for (int player = 0; player < MAX_PLAYERS; ++player)
+	{
+		BASE_OBJECT *lists[] = {apsDroidLists[player], apsStructLists[player]};
+		unsigned list;
+		for (list = 0; list < sizeof(lists) / sizeof(*lists); ++list)
+		{
+			for (BASE_OBJECT *psObj = lists[list]; psObj != nullptr; psObj = psObj->psNext)
+			{
+				visViewers.push_back(psObj);
+			}
+		}
+	}
+	if (visViewerSeen.size() < visViewers.size())
+	{
+		visViewerSeen.resize(visViewers.size());
+	}
 
-			// Check if scripting system wants to trigger an event for this
-			triggerEventSeen(psViewer, psObj);
+	// Nothing changes seenThisTick[] until all the viewers have looked around, so they can look in any order.
+	unsigned numJobs = (visViewers.size() + VIS_VIEWERS_PER_JOB - 1) / VIS_VIEWERS_PER_JOB;
+	wzParallelFor(numJobs, processVisibilityVisionJob);
+
+	// Apply what was seen in the same order as if the viewers had looked around one at a time, skipping objects which an
+	// earlier viewer made fully visible to the player. Will give inconsistent results if hasSharedVision is not an equivalence relation.
+	visSeenEvents.clear();
+	for (unsigned i = 0; i < visViewers.size(); ++i)
+	{
+		BASE_OBJECT *psViewer = visViewers[i];
+		for (VisibilitySeen const &seen : visViewerSeen[i])
+		{
+			if (seen.psObj->seenThisTick[psViewer->player] < UINT8_MAX)
+			{
+				// Tell system that this side can see this object
+				setSeenBy(seen.psObj, psViewer->player, seen.val);
+				visSeenEvents.emplace_back(psViewer, seen.psObj);
+			}
 		}
 	}
+
+	// Check if scripting system wants to trigger an event for this, now that the threads are done.
+	for (auto const &event : visSeenEvents)
+	{
+		triggerEventSeen(event.first, event.second);
+	}
 }
 
 /* Find out what can see this object */
@@ -719,48 +805,96 @@ static void processVisibilityLevel(BASE_OBJECT *psObj)
 	}
 }
 
-void processVisibility()
+/// Lets radar detectors see the active radars within range. The radars are sorted into a coarse grid, so each detector only checks the cells in range.
+static void processVisibilityRadarDetectors()
 {
-	updateSpotters();
-	for (int player = 0; player < MAX_PLAYERS; ++player)
+	static std::vector<BASE_OBJECT *> detectors;
+	static std::vector<BASE_OBJECT *> radars;
+	static std::vector<unsigned> cellStart;  // Index in radars of the first radar in each cell, and one past the last radar at the end.
+	static std::vector<unsigned> cellOf;
+	static std::vector<unsigned> next;
+	static std::vector<BASE_OBJECT *> sorted;
+
+	detectors.clear();
+	radars.clear();
+	for (BASE_OBJECT *psObj = apsSensorList[0]; psObj != nullptr; psObj = psObj->psNextFunc)
 	{
-		BASE_OBJECT *lists[] = {apsDroidLists[player], apsStructLists[player], apsFeatureLists[player]};
-		unsigned list;
-		for (list = 0; list < sizeof(lists) / sizeof(*lists); ++list)
+		if (objRadarDetector(psObj))
 		{
-			for (BASE_OBJECT *psObj = lists[list]; psObj != nullptr; psObj = psObj->psNext)
-			{
-				processVisibilitySelf(psObj);
-			}
+			detectors.push_back(psObj);
 		}
-	}
-	for (int player = 0; player < MAX_PLAYERS; ++player)
-	{
-		BASE_OBJECT *lists[] = {apsDroidLists[player], apsStructLists[player]};
-		unsigned list;
-		for (list = 0; list < sizeof(lists) / sizeof(*lists); ++list)
+		if (objActiveRadar(psObj))
 		{
-			for (BASE_OBJECT *psObj = lists[list]; psObj != nullptr; psObj = psObj->psNext)
-			{
-				processVisibilityVision(psObj);
-			}
+			radars.push_back(psObj);
 		}
 	}
-	for (BASE_OBJECT *psObj = apsSensorList[0]; psObj != nullptr; psObj = psObj->psNextFunc)
+	if (detectors.empty() || radars.empty())
 	{
-		if (objRadarDetector(psObj))
+		return;
+	}
+
+	// Counting sort of the radars by cell. Objects slightly off the map go in the edge cells.
+	const int cellWidth = map_coord(RADAR_DETECTOR_CELL_SIZE);
+	const int gridWidth = mapWidth / cellWidth + 1, gridHeight = mapHeight / cellWidth + 1;
+	auto cellX = [&](int x) { return clip(x / RADAR_DETECTOR_CELL_SIZE, 0, gridWidth - 1); };
+	auto cellY = [&](int y) { return clip(y / RADAR_DETECTOR_CELL_SIZE, 0, gridHeight - 1); };
+	cellStart.assign(gridWidth * gridHeight + 1, 0);
+	cellOf.resize(radars.size());
+	for (unsigned i = 0; i < radars.size(); ++i)
+	{
+		cellOf[i] = cellX(radars[i]->pos.x) + cellY(radars[i]->pos.y) * gridWidth;
+		++cellStart[cellOf[i] + 1];
+	}
+	for (unsigned cell = 0; cell < cellStart.size() - 1; ++cell)
+	{
+		cellStart[cell + 1] += cellStart[cell];
+	}
+	sorted.resize(radars.size());
+	next.assign(cellStart.begin(), cellStart.end() - 1);
+	for (unsigned i = 0; i < radars.size(); ++i)
+	{
+		sorted[next[cellOf[i]]++] = radars[i];
+	}
+	radars.swap(sorted);
+
+	// Each detector sets the visibility of radars within range, so the order the pairs are checked in does not matter.
+	for (BASE_OBJECT *psObj : detectors)
+	{
+		const int range = objSensorRange(psObj) * 10;
+		const int x1 = cellX(psObj->pos.x - range), x2 = cellX(psObj->pos.x + range);
+		const int y1 = cellY(psObj->pos.y - range), y2 = cellY(psObj->pos.y + range);
+		for (int y = y1; y <= y2; ++y)
 		{
-			for (BASE_OBJECT *psTarget = apsSensorList[0]; psTarget != nullptr; psTarget = psTarget->psNextFunc)
+			for (unsigned i = cellStart[x1 + y * gridWidth]; i < cellStart[x2 + y * gridWidth + 1]; ++i)
 			{
+				BASE_OBJECT *psTarget = radars[i];
 				if (psObj != psTarget && psTarget->visible[psObj->player] < UBYTE_MAX / 2
-				    && objActiveRadar(psTarget)
-				    && iHypot((psTarget->pos - psObj->pos).xy) < objSensorRange(psObj) * 10)
+				    && iHypot((psTarget->pos - psObj->pos).xy) < range)
 				{
 					psTarget->visible[psObj->player] = UBYTE_MAX / 2;
 				}
 			}
 		}
 	}
+}
+
+void processVisibility()
+{
+	updateSpotters();
+	for (int player = 0; player < MAX_PLAYERS; ++player)
+	{
+		BASE_OBJECT *lists[] = {apsDroidLists[player], apsStructLists[player], apsFeatureLists[player]};
+		unsigned list;
+		for (list = 0; list < sizeof(lists) / sizeof(*lists); ++list)
+		{
+			for (BASE_OBJECT *psObj = lists[list]; psObj != nullptr; psObj = psObj->psNext)
+			{
+				processVisibilitySelf(psObj);
+			}
+		}
+	}
+	processVisibilityVisionAll();
+	processVisibilityRadarDetectors();
 	for (int player = 0; player < MAX_PLAYERS; ++player)
 	{
 		BASE_OBJECT *lists[] = {apsDroidLists[player], apsStructLists[player], apsFeatureLists[player]};
@@ -58,6 +58,7 @@ struct WARZONE_GLOBALS
 	int cameraSpeed = CAMERASPEED_DEFAULT;
 	int scrollEvent = 0; // map/radar zoom
 	bool radarJump = false;
+	int pathThreads = 0; // 0 = one less than the number of CPU cores
 };
 
 static WARZONE_GLOBALS warGlobs;
@@ -307,3 +308,13 @@ void war_SetRadarJump(bool radarJump)
 {
 	warGlobs.radarJump = radarJump;
 }
+
+int war_GetPathThreads()
+{
+	return warGlobs.pathThreads;
+}
+
+void war_SetPathThreads(int pathThreads)
+{
+	warGlobs.pathThreads = MAX(pathThreads, 0);
+}
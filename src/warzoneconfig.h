@@ -89,6 +89,8 @@ int war_GetCameraSpeed();
 void war_SetCameraSpeed(int cameraSpeed);
 int war_GetScrollEvent();
 void war_SetScrollEvent(int scrollEvent);
+int war_GetPathThreads();
+void war_SetPathThreads(int pathThreads);
 int8_t war_GetSPcolor();
 void war_SetSPcolor(int color);
 void war_setMPcolour(int colour);
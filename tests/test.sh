@@ -37,6 +37,17 @@ function skirmish
 	#run "--autogame --loadskirmish=$1" "$1 : Loading and running"
 }
 
+function bench
+{
+	echo
+	echo " ==== $1 : $2 ===="
+	# Runs the self-checking benchmarks a few minutes into an AI game, and quits with a failure if any of them finds a mismatch.
+	if ! src/warzone2100 --window --configdir=tmp --resolution=1024x768 --nosound --skirmish=$1.json --autogame --bench=all; then
+		echo " * Benchmarks failed on $1"
+		exit 1
+	fi
+}
+
 echo
 echo "Running Warzone2100 automated tests"
 echo -n "Time is: "
@@ -51,3 +62,5 @@ cam FASTPLAY "Fastplay"
 skirmish highground "Basic skirmish"
 skirmish miza "All AIs"
 skirmish miza_challenge "Best AI vs 7 old timers"
+
+bench miza "Benchmarks and determinism checks"